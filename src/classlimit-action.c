@@ -0,0 +1,529 @@
+/* classlimit-action.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "classlimit-action.h"
+#include "classlimit-csv.h"
+#include "classlimit-importer.h"
+
+static const char *kind_names[CLASSLIMIT_N_ACTIONS] = {
+	[CLASSLIMIT_ACTION_ADD]               = "add",
+	[CLASSLIMIT_ACTION_REMOVE]            = "remove",
+	[CLASSLIMIT_ACTION_SKIP_INCREMENT]    = "skip-increment",
+	[CLASSLIMIT_ACTION_SKIP_DECREMENT]    = "skip-decrement",
+	[CLASSLIMIT_ACTION_SKIP_RESET]        = "skip-reset",
+	[CLASSLIMIT_ACTION_SET_ATTENDANCE]    = "set-attendance",
+	[CLASSLIMIT_ACTION_SET_WEEKS]         = "set-weeks",
+	[CLASSLIMIT_ACTION_SET_SESSION_HOURS] = "set-session-hours",
+	[CLASSLIMIT_ACTION_CALCULATE]         = "calculate",
+	[CLASSLIMIT_ACTION_IMPORT]            = "import",
+	[CLASSLIMIT_ACTION_RESET_ALL]         = "reset-all",
+	[CLASSLIMIT_ACTION_BULK_ADD_SKIPS]    = "bulk-add-skips",
+	[CLASSLIMIT_ACTION_BULK_RESET_SKIPS]  = "bulk-reset-skips",
+	[CLASSLIMIT_ACTION_BULK_SET_HOURS]    = "bulk-set-hours",
+	[CLASSLIMIT_ACTION_BULK_REMOVE]       = "bulk-remove",
+	[CLASSLIMIT_ACTION_SET_POLICIES]      = "set-policies",
+	[CLASSLIMIT_ACTION_PASTE]             = "paste",
+	[CLASSLIMIT_ACTION_IMPORT_FOLDER]     = "import-folder",
+	[CLASSLIMIT_ACTION_IMPORT_CSV]        = "import-csv",
+};
+
+const char *
+classlimit_action_kind_to_string (ClasslimitActionKind kind)
+{
+	g_return_val_if_fail (kind < CLASSLIMIT_N_ACTIONS, NULL);
+
+	return kind_names[kind];
+}
+
+/* Positions as runs, "0-4999,5001", so selecting everything stays short */
+static void
+append_positions (GString      *str,
+                  const GArray *positions)
+{
+	guint i = 0;
+
+	while (positions && i < positions->len) {
+		guint first = g_array_index (positions, guint, i);
+		guint last = first;
+
+		while (i + 1 < positions->len && g_array_index (positions, guint, i + 1) == last + 1)
+			last = g_array_index (positions, guint, ++i);
+		i++;
+
+		if (str->len > 0 && str->str[str->len - 1] != ' ')
+			g_string_append_c (str, ',');
+		if (first == last)
+			g_string_append_printf (str, "%u", first);
+		else
+			g_string_append_printf (str, "%u-%u", first, last);
+	}
+}
+
+/* Runs must ascend and stay below @n_subjects, which is checked before
+ * a range is expanded, so "0-4000000000" is refused instead of filling
+ * memory and the result never outgrows the roster.
+ */
+static gboolean
+parse_positions (const char  *p,
+                 guint        n_subjects,
+                 GArray     **positions)
+{
+	g_autoptr(GArray) result = g_array_new (FALSE, FALSE, sizeof (guint));
+	char *end;
+
+	while (*p != '\0') {
+		guint64 first = g_ascii_strtoull (p, &end, 10);
+		guint64 last = first;
+		guint i;
+
+		if (end == p || first >= n_subjects)
+			return FALSE;
+		p = end;
+		if (*p == '-') {
+			last = g_ascii_strtoull (++p, &end, 10);
+			if (end == p || last < first || last >= n_subjects)
+				return FALSE;
+			p = end;
+		}
+		if (result->len > 0 && first <= g_array_index (result, guint, result->len - 1))
+			return FALSE;
+		for (i = first; i <= last; i++)
+			g_array_append_val (result, i);
+
+		if (*p == ',')
+			p++;
+		else if (*p != '\0')
+			return FALSE;
+	}
+
+	*positions = g_steal_pointer (&result);
+
+	return TRUE;
+}
+
+/* One action per line: "<usec> <kind> [args]". Names and paths go last
+ * and are escaped, so they may contain spaces or newlines.
+ */
+char *
+classlimit_action_to_string (const ClasslimitAction *action)
+{
+	g_autofree char *escaped = NULL;
+
+	g_return_val_if_fail (action != NULL, NULL);
+	g_return_val_if_fail (action->kind < CLASSLIMIT_N_ACTIONS, NULL);
+
+	switch (action->kind) {
+	case CLASSLIMIT_ACTION_ADD:
+	case CLASSLIMIT_ACTION_IMPORT_CSV:
+		escaped = g_strescape (action->text ? action->text : "", NULL);
+		return g_strdup_printf ("%" G_GINT64_FORMAT " %s %d %s", action->time,
+		                        kind_names[action->kind], action->value, escaped);
+	case CLASSLIMIT_ACTION_REMOVE:
+	case CLASSLIMIT_ACTION_SKIP_INCREMENT:
+	case CLASSLIMIT_ACTION_SKIP_DECREMENT:
+	case CLASSLIMIT_ACTION_SKIP_RESET:
+		return g_strdup_printf ("%" G_GINT64_FORMAT " %s %u", action->time,
+		                        kind_names[action->kind], action->position);
+	case CLASSLIMIT_ACTION_SET_ATTENDANCE:
+	case CLASSLIMIT_ACTION_SET_WEEKS:
+	case CLASSLIMIT_ACTION_SET_SESSION_HOURS:
+		return g_strdup_printf ("%" G_GINT64_FORMAT " %s %d", action->time,
+		                        kind_names[action->kind], action->value);
+	case CLASSLIMIT_ACTION_IMPORT:
+	case CLASSLIMIT_ACTION_SET_POLICIES:
+	case CLASSLIMIT_ACTION_PASTE:
+	case CLASSLIMIT_ACTION_IMPORT_FOLDER:
+	case CLASSLIMIT_ACTION_MERGE:
+		escaped = g_strescape (action->text ? action->text : "", NULL);
+		return g_strdup_printf ("%" G_GINT64_FORMAT " %s %s", action->time,
+		                        kind_names[action->kind], escaped);
+	case CLASSLIMIT_ACTION_BULK_ADD_SKIPS:
+	case CLASSLIMIT_ACTION_BULK_RESET_SKIPS:
+	case CLASSLIMIT_ACTION_BULK_SET_HOURS:
+	case CLASSLIMIT_ACTION_BULK_REMOVE:
+		{
+			GString *str = g_string_new (NULL);
+
+			g_string_printf (str, "%" G_GINT64_FORMAT " %s %d ", action->time,
+			                 kind_names[action->kind], action->value);
+			append_positions (str, action->positions);
+			return g_string_free (str, FALSE);
+		}
+	case CLASSLIMIT_ACTION_CALCULATE:
+	case CLASSLIMIT_ACTION_RESET_ALL:
+	case CLASSLIMIT_N_ACTIONS:
+	default:
+		return g_strdup_printf ("%" G_GINT64_FORMAT " %s", action->time,
+		                        kind_names[action->kind]);
+	}
+}
+
+/* Bulk positions are expanded one by one, so @n_subjects, the size of
+ * the roster the action will be applied to, bounds them while parsing.
+ */
+gboolean
+classlimit_action_parse (ClasslimitAction  *action,
+                         const char        *line,
+                         guint              n_subjects,
+                         GError           **error)
+{
+	const char *p = line;
+	char *end;
+	gsize kind_len;
+	guint kind;
+
+	g_return_val_if_fail (action != NULL, FALSE);
+	g_return_val_if_fail (line != NULL, FALSE);
+
+	memset (action, 0, sizeof *action);
+
+	action->time = g_ascii_strtoll (p, &end, 10);
+	if (end == p || *end != ' ')
+		goto invalid;
+	p = end + 1;
+
+	kind_len = strcspn (p, " ");
+	for (kind = 0; kind < CLASSLIMIT_N_ACTIONS; kind++) {
+		if (strlen (kind_names[kind]) == kind_len && strncmp (p, kind_names[kind], kind_len) == 0)
+			break;
+	}
+	if (kind == CLASSLIMIT_N_ACTIONS)
+		goto invalid;
+	action->kind = kind;
+	p += kind_len;
+	if (*p == ' ')
+		p++;
+
+	switch (action->kind) {
+	case CLASSLIMIT_ACTION_ADD:
+	case CLASSLIMIT_ACTION_IMPORT_CSV:
+		action->value = g_ascii_strtoll (p, &end, 10);
+		if (end == p || *end != ' ')
+			goto invalid;
+		action->text = g_strcompress (end + 1);
+		break;
+	case CLASSLIMIT_ACTION_REMOVE:
+	case CLASSLIMIT_ACTION_SKIP_INCREMENT:
+	case CLASSLIMIT_ACTION_SKIP_DECREMENT:
+	case CLASSLIMIT_ACTION_SKIP_RESET:
+		action->position = g_ascii_strtoull (p, &end, 10);
+		if (end == p)
+			goto invalid;
+		break;
+	case CLASSLIMIT_ACTION_SET_ATTENDANCE:
+	case CLASSLIMIT_ACTION_SET_WEEKS:
+	case CLASSLIMIT_ACTION_SET_SESSION_HOURS:
+		action->value = g_ascii_strtoll (p, &end, 10);
+		if (end == p)
+			goto invalid;
+		break;
+	case CLASSLIMIT_ACTION_IMPORT:
+	case CLASSLIMIT_ACTION_SET_POLICIES:
+	case CLASSLIMIT_ACTION_PASTE:
+	case CLASSLIMIT_ACTION_IMPORT_FOLDER:
+	case CLASSLIMIT_ACTION_MERGE:
+		if (*p == '\0')
+			goto invalid;
+		action->text = g_strcompress (p);
+		break;
+	case CLASSLIMIT_ACTION_BULK_ADD_SKIPS:
+	case CLASSLIMIT_ACTION_BULK_RESET_SKIPS:
+	case CLASSLIMIT_ACTION_BULK_SET_HOURS:
+	case CLASSLIMIT_ACTION_BULK_REMOVE:
+		action->value = g_ascii_strtoll (p, &end, 10);
+		if (end == p || *end != ' ' || !parse_positions (end + 1, n_subjects, &action->positions))
+			goto invalid;
+		break;
+	case CLASSLIMIT_ACTION_CALCULATE:
+	case CLASSLIMIT_ACTION_RESET_ALL:
+		break;
+	case CLASSLIMIT_N_ACTIONS:
+	default:
+		g_assert_not_reached ();
+	}
+
+	return TRUE;
+
+invalid:
+	g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+	             "Malformed action line: %s", line);
+	return FALSE;
+}
+
+void
+classlimit_action_clear (ClasslimitAction *action)
+{
+	g_return_if_fail (action != NULL);
+
+	g_clear_pointer (&action->text, g_free);
+	g_clear_pointer (&action->positions, g_array_unref);
+}
+
+static ClasslimitSubject *
+get_subject (ClasslimitRoster        *roster,
+             const ClasslimitAction  *action,
+             GError                 **error)
+{
+	ClasslimitSubject *s = classlimit_roster_get_subject (roster, action->position);
+
+	if (s == NULL)
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		             "No subject at position %u", action->position);
+
+	return s;
+}
+
+static gboolean
+check_positions (ClasslimitRoster        *roster,
+                 const ClasslimitAction  *action,
+                 GError                 **error)
+{
+	guint n_items = g_list_model_get_n_items (G_LIST_MODEL (roster));
+	guint i;
+
+	if (action->positions == NULL || action->positions->len == 0) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		                     "No subjects selected");
+		return FALSE;
+	}
+
+	for (i = 0; i < action->positions->len; i++) {
+		guint position = g_array_index (action->positions, guint, i);
+
+		if (position >= n_items || (i > 0 && position <= g_array_index (action->positions, guint, i - 1))) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+			             "No subject at position %u", position);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* The model side of every action; the window and the replayer both go
+ * through here so recorded sessions exercise the same code. Each action
+ * is one roster transaction, so it is saved and announced exactly once.
+ */
+gboolean
+classlimit_action_apply (const ClasslimitAction  *action,
+                         ClasslimitRoster        *roster,
+                         ClasslimitTotals        *totals,
+                         GError                 **error)
+{
+	g_autoptr(ClasslimitSubject) added = NULL;
+	g_autoptr(GVariant) policies = NULL;
+	g_autoptr(GVariant) change = NULL;
+	g_autoptr(GPtrArray) pasted = NULL;
+	g_autoptr(GPtrArray) loaded = NULL;
+	g_autofree char *contents = NULL;
+	gsize length;
+
+	g_return_val_if_fail (action != NULL, FALSE);
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (roster), FALSE);
+
+	/* Validate first so a failed action never opens a transaction */
+	switch (action->kind) {
+	case CLASSLIMIT_ACTION_ADD:
+		if (action->text == NULL || action->value <= 0) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+			                     "A subject needs a name and weekly hours");
+			return FALSE;
+		}
+		break;
+	case CLASSLIMIT_ACTION_REMOVE:
+	case CLASSLIMIT_ACTION_SKIP_INCREMENT:
+	case CLASSLIMIT_ACTION_SKIP_DECREMENT:
+	case CLASSLIMIT_ACTION_SKIP_RESET:
+		if (!get_subject (roster, action, error))
+			return FALSE;
+		break;
+	case CLASSLIMIT_ACTION_IMPORT:
+		{
+			g_autoptr(GFile) file = g_file_new_for_commandline_arg (action->text);
+
+			if (!g_file_load_contents (file, NULL, &contents, &length, NULL, error))
+				return FALSE;
+		}
+		break;
+	case CLASSLIMIT_ACTION_SET_POLICIES:
+		policies = g_variant_parse (G_VARIANT_TYPE ("a(ssiii)"), action->text ? action->text : "",
+		                            NULL, NULL, error);
+		if (policies == NULL)
+			return FALSE;
+		break;
+	case CLASSLIMIT_ACTION_PASTE:
+		pasted = classlimit_csv_parse_pasted (action->text ? action->text : "", -1, NULL);
+		if (pasted->len == 0) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			                     "No subjects with weekly hours in the pasted text");
+			return FALSE;
+		}
+		break;
+	case CLASSLIMIT_ACTION_MERGE:
+		change = g_variant_parse (G_VARIANT_TYPE ("(iiima(siii)ma(ssiii))"), action->text ? action->text : "",
+		                          NULL, NULL, error);
+		if (change == NULL)
+			return FALSE;
+		break;
+	case CLASSLIMIT_ACTION_IMPORT_FOLDER:
+		{
+			g_autoptr(GFile) folder = g_file_new_for_commandline_arg (action->text ? action->text : "");
+			g_autoptr(ClasslimitImporter) importer = classlimit_importer_new (roster, folder);
+
+			/* Merges in transactions of its own as files are parsed */
+			return classlimit_importer_run (importer, NULL, error);
+		}
+	case CLASSLIMIT_ACTION_IMPORT_CSV:
+		/* Loads in place for the replayer; the window reads the file on
+		 * a worker thread and applies the same transaction when done.
+		 */
+		{
+			g_autoptr(GVariant) spec = NULL;
+			g_auto(ClasslimitCsvColumns) columns = { NULL, };
+			g_autoptr(GFile) file = NULL;
+			g_autofree char *location = NULL;
+
+			spec = g_variant_parse (G_VARIANT_TYPE ("(ssss)"), action->text ? action->text : "",
+			                        NULL, NULL, error);
+			if (spec == NULL)
+				return FALSE;
+			if (!classlimit_csv_delimiter_is_valid (action->value)) {
+				g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+				             "Unusable CSV delimiter %d", action->value);
+				return FALSE;
+			}
+
+			g_variant_get (spec, "(ssss)", &location, &columns.name,
+			               &columns.weekly_hours, &columns.current_skips);
+			columns.delimiter = action->value;
+			file = g_file_new_for_commandline_arg (location);
+			loaded = classlimit_csv_load (file, &columns, NULL, error);
+			if (loaded == NULL)
+				return FALSE;
+		}
+		break;
+	case CLASSLIMIT_ACTION_CALCULATE:
+		classlimit_roster_calculate (roster, totals);
+		classlimit_roster_save_results (roster);
+		return TRUE;
+	case CLASSLIMIT_ACTION_SET_ATTENDANCE:
+	case CLASSLIMIT_ACTION_SET_WEEKS:
+	case CLASSLIMIT_ACTION_SET_SESSION_HOURS:
+	case CLASSLIMIT_ACTION_RESET_ALL:
+		break;
+	case CLASSLIMIT_ACTION_BULK_ADD_SKIPS:
+	case CLASSLIMIT_ACTION_BULK_RESET_SKIPS:
+	case CLASSLIMIT_ACTION_BULK_SET_HOURS:
+	case CLASSLIMIT_ACTION_BULK_REMOVE:
+		if (!check_positions (roster, action, error))
+			return FALSE;
+		if (action->kind == CLASSLIMIT_ACTION_BULK_SET_HOURS && action->value <= 0) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+			                     "Weekly hours must be positive");
+			return FALSE;
+		}
+		break;
+	case CLASSLIMIT_N_ACTIONS:
+	default:
+		g_return_val_if_reached (FALSE);
+	}
+
+	classlimit_roster_begin (roster);
+
+	switch (action->kind) {
+	case CLASSLIMIT_ACTION_ADD:
+		added = classlimit_subject_new (action->text, action->value);
+		classlimit_roster_append (roster, added);
+		break;
+	case CLASSLIMIT_ACTION_REMOVE:
+		classlimit_roster_remove (roster, action->position);
+		break;
+	/* Through the roster, so sorted views move just this subject */
+	case CLASSLIMIT_ACTION_SKIP_INCREMENT:
+		classlimit_roster_add_skips (roster, &action->position, 1, 1);
+		break;
+	case CLASSLIMIT_ACTION_SKIP_DECREMENT:
+		classlimit_roster_add_skips (roster, &action->position, 1, -1);
+		break;
+	case CLASSLIMIT_ACTION_SKIP_RESET:
+		classlimit_roster_reset_skips (roster, &action->position, 1);
+		break;
+	case CLASSLIMIT_ACTION_SET_ATTENDANCE:
+		classlimit_roster_set_required_attendance (roster, action->value);
+		break;
+	case CLASSLIMIT_ACTION_SET_WEEKS:
+		classlimit_roster_set_total_weeks (roster, action->value);
+		break;
+	case CLASSLIMIT_ACTION_SET_SESSION_HOURS:
+		classlimit_roster_set_session_hours (roster, action->value);
+		break;
+	case CLASSLIMIT_ACTION_IMPORT:
+		/* Leaves the roster untouched on error, so committing is harmless */
+		if (!classlimit_roster_import_json (roster, contents, length, error)) {
+			classlimit_roster_commit (roster);
+			return FALSE;
+		}
+		break;
+	case CLASSLIMIT_ACTION_RESET_ALL:
+		classlimit_roster_reset (roster);
+		break;
+	case CLASSLIMIT_ACTION_BULK_ADD_SKIPS:
+		classlimit_roster_add_skips (roster, (const guint *) (gpointer) action->positions->data,
+		                             action->positions->len, action->value);
+		break;
+	case CLASSLIMIT_ACTION_BULK_RESET_SKIPS:
+		classlimit_roster_reset_skips (roster, (const guint *) (gpointer) action->positions->data,
+		                               action->positions->len);
+		break;
+	case CLASSLIMIT_ACTION_BULK_SET_HOURS:
+		classlimit_roster_set_weekly_hours (roster, (const guint *) (gpointer) action->positions->data,
+		                                    action->positions->len, action->value);
+		break;
+	case CLASSLIMIT_ACTION_BULK_REMOVE:
+		classlimit_roster_remove_many (roster, (const guint *) (gpointer) action->positions->data,
+		                               action->positions->len);
+		break;
+	case CLASSLIMIT_ACTION_SET_POLICIES:
+		classlimit_roster_set_policies (roster, policies);
+		break;
+	case CLASSLIMIT_ACTION_PASTE:
+		/* One splice, however many lines were pasted */
+		classlimit_roster_append_many (roster, (ClasslimitSubject **) pasted->pdata, pasted->len);
+		break;
+	case CLASSLIMIT_ACTION_IMPORT_CSV:
+		/* Replaces the subjects, keeping the semester settings */
+		classlimit_roster_set_subjects (roster, (ClasslimitSubject **) loaded->pdata, loaded->len);
+		break;
+	case CLASSLIMIT_ACTION_MERGE:
+		/* What a linked file or another process changed while recording */
+		classlimit_roster_merge (roster, change);
+		break;
+	case CLASSLIMIT_ACTION_CALCULATE:
+	case CLASSLIMIT_N_ACTIONS:
+	default:
+		g_assert_not_reached ();
+	}
+
+	classlimit_roster_commit (roster);
+
+	return TRUE;
+}
@@ -0,0 +1,81 @@
+/* classlimit-action.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "classlimit-roster.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+	CLASSLIMIT_ACTION_ADD,
+	CLASSLIMIT_ACTION_REMOVE,
+	CLASSLIMIT_ACTION_SKIP_INCREMENT,
+	CLASSLIMIT_ACTION_SKIP_DECREMENT,
+	CLASSLIMIT_ACTION_SKIP_RESET,
+	CLASSLIMIT_ACTION_SET_ATTENDANCE,
+	CLASSLIMIT_ACTION_SET_WEEKS,
+	CLASSLIMIT_ACTION_SET_SESSION_HOURS,
+	CLASSLIMIT_ACTION_CALCULATE,
+	CLASSLIMIT_ACTION_IMPORT,
+	CLASSLIMIT_ACTION_RESET_ALL,
+	CLASSLIMIT_ACTION_BULK_ADD_SKIPS,
+	CLASSLIMIT_ACTION_BULK_RESET_SKIPS,
+	CLASSLIMIT_ACTION_BULK_SET_HOURS,
+	CLASSLIMIT_ACTION_BULK_REMOVE,
+	CLASSLIMIT_ACTION_SET_POLICIES,
+	CLASSLIMIT_ACTION_PASTE,
+	CLASSLIMIT_ACTION_IMPORT_FOLDER,
+	CLASSLIMIT_ACTION_IMPORT_CSV,
+	CLASSLIMIT_ACTION_MERGE,
+	CLASSLIMIT_N_ACTIONS
+} ClasslimitActionKind;
+
+/* A high-level user action. position is a roster index, value is the
+ * weekly hours, skip count, parameter value or CSV delimiter and text the
+ * subject name, import location, printed `a(ssiii)` policies, pasted
+ * lines, printed `(ssss)` CSV location and columns or printed
+ * `(iiima(siii)ma(ssiii))` outside change, depending on the kind. Bulk actions apply to the
+ * ascending roster indices in positions instead of position.
+ */
+typedef struct {
+	ClasslimitActionKind  kind;
+	gint64                time;
+	guint                 position;
+	int                   value;
+	char                 *text;
+	GArray               *positions;
+} ClasslimitAction;
+
+const char *classlimit_action_kind_to_string (ClasslimitActionKind    kind);
+char       *classlimit_action_to_string      (const ClasslimitAction *action);
+gboolean    classlimit_action_parse          (ClasslimitAction       *action,
+                                              const char             *line,
+                                              guint                   n_subjects,
+                                              GError                **error);
+void        classlimit_action_clear          (ClasslimitAction       *action);
+gboolean    classlimit_action_apply          (const ClasslimitAction *action,
+                                              ClasslimitRoster       *roster,
+                                              ClasslimitTotals       *totals,
+                                              GError                **error);
+
+G_END_DECLS
@@ -22,11 +22,34 @@
 #include <glib/gi18n.h>
 
 #include "classlimit-application.h"
+#include "classlimit-archive.h"
+#include "classlimit-link.h"
+#include "classlimit-profiler.h"
+#include "classlimit-search-provider.h"
+#include "classlimit-subject-row.h"
 #include "classlimit-window.h"
 
 struct _ClasslimitApplication
 {
 	AdwApplication parent_instance;
+
+	/* Shared by every window */
+	GSettings         *settings;
+	ClasslimitRoster  *roster;
+	ClasslimitHistory *history;
+	ClasslimitLink    *link;
+	ClasslimitArchive *archive;
+
+	/* Opt-in action log, see CLASSLIMIT_RECORD */
+	ClasslimitRecorder *recorder;
+
+	/* Exported next to the application on the session bus */
+	ClasslimitSearchProvider *search_provider;
+
+	/* Resident service mode, see classlimit_application_startup() */
+	GMemoryMonitor   *memory_monitor;
+	gboolean          resident;
+	guint             warm_id;
 };
 
 G_DEFINE_FINAL_TYPE (ClasslimitApplication, classlimit_application, ADW_TYPE_APPLICATION)
@@ -44,41 +67,334 @@ classlimit_application_new (const char        *application_id,
 	                     NULL);
 }
 
+/* Follows the "linked-file" setting, for as long as the roster is loaded */
+static void
+update_link (ClasslimitApplication *self)
+{
+	g_autofree char *uri = g_settings_get_string (self->settings, "linked-file");
+
+	if (self->link) {
+		g_autofree char *current = g_file_get_uri (classlimit_link_get_file (self->link));
+
+		if (g_strcmp0 (uri, current) == 0)
+			return;
+		classlimit_link_close (self->link);
+		g_clear_object (&self->link);
+	}
+
+	if (self->roster && *uri != '\0') {
+		g_autoptr(GFile) file = g_file_new_for_uri (uri);
+
+		self->link = classlimit_link_new (self->roster, file);
+	}
+}
+
+/* Changes from a linked file or from other processes go in the action
+ * log too, so a replay ends up with the same roster.
+ */
+static void
+on_roster_merged (ClasslimitApplication *self,
+                  GVariant              *change)
+{
+	ClasslimitAction action = { .kind = CLASSLIMIT_ACTION_MERGE };
+
+	if (self->recorder == NULL)
+		return;
+
+	action.text = g_variant_print (change, FALSE);
+	classlimit_recorder_log (self->recorder, &action);
+	classlimit_action_clear (&action);
+}
+
+/* One model for all windows, so extra windows are only extra views.
+ * It is loaded on first use and may be dropped under memory pressure.
+ */
+static ClasslimitRoster *
+ensure_roster (ClasslimitApplication *self)
+{
+	g_autofree char *path = NULL;
+	g_autoptr(GError) error = NULL;
+	gint64 begin;
+
+	if (self->roster)
+		return self->roster;
+
+	begin = classlimit_profiler_begin ();
+	self->roster = classlimit_roster_new ();
+	classlimit_roster_load (self->roster, self->settings);
+	classlimit_profiler_end (CLASSLIMIT_PROBE_LOAD, begin,
+		g_list_model_get_n_items (G_LIST_MODEL (self->roster)));
+	g_signal_connect_object (self->roster, "merged",
+		G_CALLBACK (on_roster_merged), self, G_CONNECT_SWAPPED);
+
+	/* Follows the roster from here on, whether or not a window is open */
+	self->history = classlimit_history_new ();
+	path = classlimit_history_get_default_path ();
+	if (!classlimit_history_load (self->history, path, &error))
+		g_warning ("Failed to open attendance history: %s", error->message);
+	classlimit_history_track (self->history, self->roster);
+
+	update_link (self);
+
+	return self->roster;
+}
+
+/* Does the work of a cold start ahead of time, so activating the
+ * service only has to build the window itself.
+ */
+static void
+warm_up_cb (gpointer user_data)
+{
+	ClasslimitApplication *self = CLASSLIMIT_APPLICATION (user_data);
+	GdkDisplay *display = gdk_display_get_default ();
+
+	self->warm_id = 0;
+
+	ensure_roster (self);
+	if (self->search_provider)
+		classlimit_search_provider_warm (self->search_provider);
+
+	/* Parses the window template and resolves the row icons once */
+	g_type_class_unref (g_type_class_ref (CLASSLIMIT_TYPE_WINDOW));
+	g_type_class_unref (g_type_class_ref (CLASSLIMIT_TYPE_SUBJECT_ROW));
+	if (display) {
+		GtkIconTheme *theme = gtk_icon_theme_get_for_display (display);
+		const char *icons[] = { "list-add-symbolic", "list-remove-symbolic", "edit-clear-all-symbolic",
+		                        "user-trash-symbolic", "emblem-ok-symbolic", "dialog-warning-symbolic",
+		                        "dialog-error-symbolic", "view-statistics-symbolic" };
+		guint i;
+
+		for (i = 0; i < G_N_ELEMENTS (icons); i++)
+			g_object_unref (gtk_icon_theme_lookup_icon (theme, icons[i], NULL, 16, 1, GTK_TEXT_DIR_NONE, 0));
+	}
+}
+
+static void
+on_low_memory_warning (GMemoryMonitor                  *monitor,
+                       GMemoryMonitorWarningLevel       level,
+                       ClasslimitApplication           *self)
+{
+	/* Open windows still need their model */
+	if (gtk_application_get_windows (GTK_APPLICATION (self)) != NULL)
+		return;
+
+	g_clear_handle_id (&self->warm_id, g_source_remove);
+	if (self->search_provider)
+		classlimit_search_provider_release (self->search_provider);
+	g_clear_object (&self->history);
+	g_clear_object (&self->link);
+	g_clear_object (&self->roster);
+
+	/* Stop being resident altogether and exit once idle */
+	if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL && self->resident) {
+		self->resident = FALSE;
+		g_application_release (G_APPLICATION (self));
+	}
+}
+
+static void
+classlimit_application_startup (GApplication *app)
+{
+	ClasslimitApplication *self = CLASSLIMIT_APPLICATION (app);
+	const char *record_path = g_getenv ("CLASSLIMIT_RECORD");
+
+	/* AdwApplication also loads style.css from the resource base path,
+	 * once for the whole process.
+	 */
+	G_APPLICATION_CLASS (classlimit_application_parent_class)->startup (app);
+
+	self->settings = g_settings_new ("com.tomasps.classlimit");
+	g_signal_connect_object (self->settings, "changed::linked-file",
+		G_CALLBACK (update_link), self, G_CONNECT_SWAPPED);
+
+	/* Action log for classlimit-replay. Every window writes to the one
+	 * log, just as they all change the one roster.
+	 */
+	if (record_path && *record_path) {
+		g_autoptr(GError) error = NULL;
+
+		self->recorder = classlimit_recorder_new (record_path, &error);
+		if (!self->recorder)
+			g_warning ("Failed to start recording actions: %s", error->message);
+	}
+
+	/* Started with --gapplication-service, by D-Bus activation or at
+	 * login: stay around without a window, with everything warm.
+	 */
+	if (g_application_get_flags (app) & G_APPLICATION_IS_SERVICE) {
+		self->resident = TRUE;
+		g_application_hold (app);
+		g_application_set_inactivity_timeout (app, 10000);
+
+		self->memory_monitor = g_memory_monitor_dup_default ();
+		g_signal_connect_object (self->memory_monitor, "low-memory-warning",
+			G_CALLBACK (on_low_memory_warning), self, 0);
+		self->warm_id = g_idle_add_once (warm_up_cb, self);
+	}
+}
+
+static gboolean
+classlimit_application_dbus_register (GApplication     *app,
+                                      GDBusConnection  *connection,
+                                      const char       *object_path,
+                                      GError          **error)
+{
+	ClasslimitApplication *self = CLASSLIMIT_APPLICATION (app);
+	g_autofree char *search_path = NULL;
+
+	if (!G_APPLICATION_CLASS (classlimit_application_parent_class)->dbus_register (app, connection, object_path, error))
+		return FALSE;
+
+	search_path = g_strconcat (object_path, "/SearchProvider", NULL);
+	self->search_provider = classlimit_search_provider_new (app, NULL);
+	if (!classlimit_search_provider_register (self->search_provider, connection, search_path, error)) {
+		g_clear_object (&self->search_provider);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+classlimit_application_dbus_unregister (GApplication    *app,
+                                        GDBusConnection *connection,
+                                        const char      *object_path)
+{
+	ClasslimitApplication *self = CLASSLIMIT_APPLICATION (app);
+
+	if (self->search_provider) {
+		classlimit_search_provider_unregister (self->search_provider);
+		g_clear_object (&self->search_provider);
+	}
+
+	G_APPLICATION_CLASS (classlimit_application_parent_class)->dbus_unregister (app, connection, object_path);
+}
+
+static GtkWindow *
+classlimit_application_create_window (ClasslimitApplication *self)
+{
+	return g_object_new (CLASSLIMIT_TYPE_WINDOW,
+	                     "application", self,
+	                     "roster", ensure_roster (self),
+	                     NULL);
+}
+
 static void
 classlimit_application_activate (GApplication *app)
 {
 	GtkWindow *window;
-	GtkCssProvider *css_provider;
 
 	g_assert (CLASSLIMIT_IS_APPLICATION (app));
 
 	window = gtk_application_get_active_window (GTK_APPLICATION (app));
 
-	if (window == NULL) {
-		window = g_object_new (CLASSLIMIT_TYPE_WINDOW,
-		                       "application", app,
-		                       NULL);
-		
-		/* Load custom CSS */
-		css_provider = gtk_css_provider_new ();
-		gtk_css_provider_load_from_resource (css_provider, "/com/tomasps/classlimit/style.css");
-		gtk_style_context_add_provider_for_display (gtk_widget_get_display (GTK_WIDGET (window)),
-		                                             GTK_STYLE_PROVIDER (css_provider),
-		                                             GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
-		g_object_unref (css_provider);
-	}
+	/* Windows are created on demand; everything else is already loaded */
+	if (window == NULL)
+		window = classlimit_application_create_window (CLASSLIMIT_APPLICATION (app));
 
 	gtk_window_present (window);
 }
 
+static void
+classlimit_application_finalize (GObject *object)
+{
+	ClasslimitApplication *self = CLASSLIMIT_APPLICATION (object);
+
+	g_clear_handle_id (&self->warm_id, g_source_remove);
+	g_clear_object (&self->memory_monitor);
+	g_clear_object (&self->search_provider);
+	g_clear_object (&self->history);
+	g_clear_object (&self->link);
+	g_clear_object (&self->roster);
+	g_clear_object (&self->archive);
+	g_clear_pointer (&self->recorder, classlimit_recorder_free);
+	g_clear_object (&self->settings);
+
+	G_OBJECT_CLASS (classlimit_application_parent_class)->finalize (object);
+}
+
 static void
 classlimit_application_class_init (ClasslimitApplicationClass *klass)
 {
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	GApplicationClass *app_class = G_APPLICATION_CLASS (klass);
 
+	object_class->finalize = classlimit_application_finalize;
+
+	app_class->dbus_register = classlimit_application_dbus_register;
+	app_class->dbus_unregister = classlimit_application_dbus_unregister;
+	app_class->startup = classlimit_application_startup;
 	app_class->activate = classlimit_application_activate;
 }
 
+GSettings *
+classlimit_application_get_settings (ClasslimitApplication *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_APPLICATION (self), NULL);
+
+	return self->settings;
+}
+
+ClasslimitRoster *
+classlimit_application_get_roster (ClasslimitApplication *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_APPLICATION (self), NULL);
+
+	return ensure_roster (self);
+}
+
+ClasslimitHistory *
+classlimit_application_get_history (ClasslimitApplication *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_APPLICATION (self), NULL);
+
+	ensure_roster (self);
+
+	return self->history;
+}
+
+/**
+ * classlimit_application_get_archive:
+ * @self: a #ClasslimitApplication
+ *
+ * Gets the archive of past semesters, reading its index on first use.
+ *
+ * Returns: (transfer none): the semester archive
+ */
+ClasslimitArchive *
+classlimit_application_get_archive (ClasslimitApplication *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_APPLICATION (self), NULL);
+
+	if (self->archive == NULL) {
+		g_autofree char *path = classlimit_archive_get_default_path ();
+		g_autoptr(GError) error = NULL;
+
+		self->archive = classlimit_archive_new ();
+		if (!classlimit_archive_load (self->archive, path, &error))
+			g_warning ("Failed to open semester archive: %s", error->message);
+	}
+
+	return self->archive;
+}
+
+/**
+ * classlimit_application_get_recorder:
+ * @self: a #ClasslimitApplication
+ *
+ * Gets the action log all windows record into.
+ *
+ * Returns: (transfer none) (nullable): the recorder, or %NULL unless
+ *   CLASSLIMIT_RECORD is set
+ */
+ClasslimitRecorder *
+classlimit_application_get_recorder (ClasslimitApplication *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_APPLICATION (self), NULL);
+
+	return self->recorder;
+}
+
 static void classlimit_application_shortcuts_action (GSimpleAction *action,
 													 GVariant      *parameter,
 													 gpointer       user_data);
@@ -119,8 +435,40 @@ classlimit_application_quit_action (GSimpleAction *action,
 	g_application_quit (G_APPLICATION (self));
 }
 
+static void
+classlimit_application_new_window_action (GSimpleAction *action,
+                                          GVariant      *parameter,
+                                          gpointer       user_data)
+{
+	ClasslimitApplication *self = user_data;
+
+	g_assert (CLASSLIMIT_IS_APPLICATION (self));
+
+	gtk_window_present (classlimit_application_create_window (self));
+}
+
+/* Opened from a search result, with the subject's roster position */
+static void
+classlimit_application_show_subject_action (GSimpleAction *action,
+                                            GVariant      *parameter,
+                                            gpointer       user_data)
+{
+	ClasslimitApplication *self = user_data;
+	GtkWindow *window;
+
+	g_assert (CLASSLIMIT_IS_APPLICATION (self));
+
+	g_application_activate (G_APPLICATION (self));
+
+	window = gtk_application_get_active_window (GTK_APPLICATION (self));
+	if (window)
+		g_action_group_activate_action (G_ACTION_GROUP (window), "show-subject", parameter);
+}
+
 static const GActionEntry app_actions[] = {
 	{ "quit", classlimit_application_quit_action },
+	{ "new-window", classlimit_application_new_window_action },
+	{ "show-subject", classlimit_application_show_subject_action, "u" },
 	{ "about", classlimit_application_about_action },
 };
 
@@ -136,6 +484,15 @@ classlimit_application_init (ClasslimitApplication *self)
 	gtk_application_set_accels_for_action (GTK_APPLICATION (self),
 	                                       "app.quit",
 	                                       (const char *[]) { "<control>q", NULL });
+	gtk_application_set_accels_for_action (GTK_APPLICATION (self),
+	                                       "app.new-window",
+	                                       (const char *[]) { "<control>n", NULL });
+	gtk_application_set_accels_for_action (GTK_APPLICATION (self),
+	                                       "win.paste-subjects",
+	                                       (const char *[]) { "<control><shift>v", NULL });
+	gtk_application_set_accels_for_action (GTK_APPLICATION (self),
+	                                       "win.toggle-debug",
+	                                       (const char *[]) { "<control><shift>d", NULL });
 
 	/* shortcuts action will build dialog on demand */
 	shortcuts_action = g_simple_action_new ("shortcuts", NULL);
@@ -22,13 +22,23 @@
 
 #include <adwaita.h>
 
+#include "classlimit-archive.h"
+#include "classlimit-history.h"
+#include "classlimit-recorder.h"
+#include "classlimit-roster.h"
+
 G_BEGIN_DECLS
 
 #define CLASSLIMIT_TYPE_APPLICATION (classlimit_application_get_type())
 
 G_DECLARE_FINAL_TYPE (ClasslimitApplication, classlimit_application, CLASSLIMIT, APPLICATION, AdwApplication)
 
-ClasslimitApplication *classlimit_application_new (const char        *application_id,
-                                                   GApplicationFlags  flags);
+ClasslimitApplication *classlimit_application_new          (const char            *application_id,
+                                                            GApplicationFlags      flags);
+GSettings             *classlimit_application_get_settings (ClasslimitApplication *self);
+ClasslimitRoster      *classlimit_application_get_roster   (ClasslimitApplication *self);
+ClasslimitHistory     *classlimit_application_get_history  (ClasslimitApplication *self);
+ClasslimitArchive     *classlimit_application_get_archive  (ClasslimitApplication *self);
+ClasslimitRecorder    *classlimit_application_get_recorder (ClasslimitApplication *self);
 
 G_END_DECLS
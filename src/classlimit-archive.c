@@ -0,0 +1,831 @@
+/* classlimit-archive.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "classlimit-archive.h"
+
+/* Past semesters, appended to one file that is never rewritten:
+ *
+ *   "CLARCH01"
+ *   "DATA" <u32 length> <zlib compressed (a(siii)a(ssiii)a(sa(xii)))>
+ *   "INDX" <u32 length> <(sxiiituuuasa(uiii))>
+ *   ...
+ *
+ * Each semester is a data block with its subjects, policies and skip
+ * history, followed by an index entry holding its name, time,
+ * parameters, the offset and sizes of the block, and one aggregate per
+ * subject name: total weekly hours, total skips and the most skips of
+ * any subject by that name. Names are numbered across the archive in
+ * the order they first appear, and an entry only spells out the names
+ * no earlier entry used. Opening the archive reads the index entries
+ * and seeks over the blocks, and questions about subjects across
+ * semesters are answered from the index alone. A block is only read
+ * and inflated when a semester is looked at in detail. Lengths and
+ * variants are little-endian, and a record torn by a crash is dropped
+ * and overwritten by the next one.
+ */
+
+#define ARCHIVE_MAGIC "CLARCH01"
+#define MAGIC_LENGTH  8
+#define HEADER_LENGTH 8
+
+#define DATA_TAG  "DATA"
+#define INDEX_TAG "INDX"
+
+#define DATA_TYPE  "(a(siii)a(ssiii)a(sa(xii)))"
+#define INDEX_TYPE "(sxiiituuuasa(uiii))"
+
+/* Index entry fields */
+enum {
+	ENTRY_NAME,
+	ENTRY_TIME,
+	ENTRY_REQUIRED_ATTENDANCE,
+	ENTRY_TOTAL_WEEKS,
+	ENTRY_SESSION_HOURS,
+	ENTRY_OFFSET,
+	ENTRY_COMPRESSED_LENGTH,
+	ENTRY_LENGTH,
+	ENTRY_N_SUBJECTS,
+	ENTRY_NEW_NAMES,
+	ENTRY_AGGREGATES,
+};
+
+typedef struct {
+	/* Snapshot taken on the main thread */
+	char     *name;
+	gint64    time;
+	int       required_attendance;
+	int       total_weeks;
+	int       session_hours;
+	guint     n_subjects;
+	GVariant *new_names;
+	GVariant *aggregates;
+	GVariant *data;
+
+	/* Where it went */
+	guint64   end;
+	GVariant *entry;
+} Append;
+
+struct _ClasslimitArchive
+{
+	GObject    parent_instance;
+
+	GFile     *file;
+	GPtrArray *entries;
+
+	/* Subject names by id, and ids by name */
+	GPtrArray  *names;
+	GHashTable *name_ids;
+
+	/* End of the last complete record */
+	guint64    end;
+	gboolean   loaded;
+	gboolean   appending;
+};
+
+G_DEFINE_FINAL_TYPE (ClasslimitArchive, classlimit_archive, G_TYPE_OBJECT)
+
+static void
+append_free (gpointer data)
+{
+	Append *append = data;
+
+	g_free (append->name);
+	g_clear_pointer (&append->new_names, g_variant_unref);
+	g_clear_pointer (&append->aggregates, g_variant_unref);
+	g_clear_pointer (&append->data, g_variant_unref);
+	g_clear_pointer (&append->entry, g_variant_unref);
+	g_free (append);
+}
+
+static void
+summary_clear (gpointer data)
+{
+	ClasslimitArchiveSummary *summary = data;
+
+	g_free (summary->name);
+}
+
+static GBytes *
+serialize (GVariant *value)
+{
+	g_autoptr(GVariant) normal = g_variant_get_normal_form (value);
+
+	if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+		g_autoptr(GVariant) swapped = g_variant_byteswap (normal);
+
+		return g_variant_get_data_as_bytes (swapped);
+	}
+
+	return g_variant_get_data_as_bytes (normal);
+}
+
+static GVariant *
+deserialize (const GVariantType *type,
+             GBytes             *bytes)
+{
+	g_autoptr(GVariant) value = g_variant_ref_sink (g_variant_new_from_bytes (type, bytes, FALSE));
+
+	if (G_BYTE_ORDER == G_BIG_ENDIAN)
+		return g_variant_byteswap (value);
+
+	return g_steal_pointer (&value);
+}
+
+/* Runs @converter over all of @data, growing the output as needed */
+static GBytes *
+convert (GConverter    *converter,
+         const guint8  *data,
+         gsize          length,
+         gsize          size_hint,
+         GError       **error)
+{
+	gsize capacity = MAX (size_hint, 256);
+	g_autofree guint8 *out = g_malloc (capacity);
+	gsize n_in = 0;
+	gsize n_out = 0;
+
+	for (;;) {
+		g_autoptr(GError) local_error = NULL;
+		GConverterResult result;
+		gsize bytes_read, bytes_written;
+
+		if (n_out == capacity) {
+			capacity *= 2;
+			out = g_realloc (out, capacity);
+		}
+
+		result = g_converter_convert (converter, data + n_in, length - n_in,
+		                              out + n_out, capacity - n_out, G_CONVERTER_INPUT_AT_END,
+		                              &bytes_read, &bytes_written, &local_error);
+		if (result == G_CONVERTER_ERROR) {
+			if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_NO_SPACE)) {
+				g_propagate_error (error, g_steal_pointer (&local_error));
+				return NULL;
+			}
+			capacity *= 2;
+			out = g_realloc (out, capacity);
+			continue;
+		}
+
+		n_in += bytes_read;
+		n_out += bytes_written;
+		if (result == G_CONVERTER_FINISHED)
+			break;
+	}
+
+	return g_bytes_new_take (g_steal_pointer (&out), n_out);
+}
+
+static gboolean
+write_record (GOutputStream  *stream,
+              const char     *tag,
+              GBytes         *payload,
+              GError        **error)
+{
+	guint8 header[HEADER_LENGTH];
+	guint32 length = GUINT32_TO_LE ((guint32) g_bytes_get_size (payload));
+
+	memcpy (header, tag, 4);
+	memcpy (header + 4, &length, 4);
+
+	return g_output_stream_write_all (stream, header, sizeof header, NULL, NULL, error) &&
+	       g_output_stream_write_all (stream, g_bytes_get_data (payload, NULL),
+	                                  g_bytes_get_size (payload), NULL, NULL, error);
+}
+
+static void
+classlimit_archive_finalize (GObject *object)
+{
+	ClasslimitArchive *self = (ClasslimitArchive *)object;
+
+	g_clear_object (&self->file);
+	g_clear_pointer (&self->entries, g_ptr_array_unref);
+	g_clear_pointer (&self->name_ids, g_hash_table_unref);
+	g_clear_pointer (&self->names, g_ptr_array_unref);
+
+	G_OBJECT_CLASS (classlimit_archive_parent_class)->finalize (object);
+}
+
+static void
+classlimit_archive_class_init (ClasslimitArchiveClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = classlimit_archive_finalize;
+}
+
+static void
+classlimit_archive_init (ClasslimitArchive *self)
+{
+	self->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+	self->names = g_ptr_array_new_with_free_func (g_free);
+	self->name_ids = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+/* Numbers the names first spelled out by @entry after the earlier ones */
+static void
+add_entry (ClasslimitArchive *self,
+           GVariant          *entry)
+{
+	g_autoptr(GVariant) new_names = g_variant_get_child_value (entry, ENTRY_NEW_NAMES);
+	gsize n_names = g_variant_n_children (new_names);
+	gsize i;
+
+	for (i = 0; i < n_names; i++) {
+		char *name;
+
+		g_variant_get_child (new_names, i, "s", &name);
+		g_hash_table_insert (self->name_ids, name, GUINT_TO_POINTER (self->names->len));
+		g_ptr_array_add (self->names, name);
+	}
+
+	g_ptr_array_add (self->entries, entry);
+}
+
+ClasslimitArchive *
+classlimit_archive_new (void)
+{
+	return g_object_new (CLASSLIMIT_TYPE_ARCHIVE, NULL);
+}
+
+char *
+classlimit_archive_get_default_path (void)
+{
+	return g_build_filename (g_get_user_data_dir (), "classlimit", "archive", NULL);
+}
+
+/**
+ * classlimit_archive_load:
+ * @self: a #ClasslimitArchive
+ * @path: the archive file
+ * @error: return location for a #GError
+ *
+ * Reads the index of @path, which need not exist yet. Only the index
+ * entries are read; the compressed blocks are skipped over.
+ *
+ * Returns: %TRUE if the archive could be read
+ */
+gboolean
+classlimit_archive_load (ClasslimitArchive  *self,
+                         const char         *path,
+                         GError            **error)
+{
+	g_autoptr(GFileInputStream) stream = NULL;
+	g_autoptr(GFileInfo) info = NULL;
+	g_autoptr(GError) local_error = NULL;
+	char magic[MAGIC_LENGTH];
+	guint64 size;
+	gsize n_read;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ARCHIVE (self), FALSE);
+	g_return_val_if_fail (path != NULL, FALSE);
+	g_return_val_if_fail (self->file == NULL, FALSE);
+
+	self->file = g_file_new_for_path (path);
+
+	stream = g_file_read (self->file, NULL, &local_error);
+	if (stream == NULL && g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+		self->loaded = TRUE;
+		return TRUE;
+	} else if (stream == NULL) {
+		g_propagate_error (error, g_steal_pointer (&local_error));
+		return FALSE;
+	}
+
+	info = g_file_input_stream_query_info (stream, G_FILE_ATTRIBUTE_STANDARD_SIZE, NULL, error);
+	if (info == NULL)
+		return FALSE;
+	size = g_file_info_get_size (info);
+
+	/* An empty file is an empty archive */
+	if (size == 0) {
+		self->loaded = TRUE;
+		return TRUE;
+	}
+
+	if (!g_input_stream_read_all (G_INPUT_STREAM (stream), magic, sizeof magic, &n_read, NULL, error))
+		return FALSE;
+	if (n_read < sizeof magic || memcmp (magic, ARCHIVE_MAGIC, MAGIC_LENGTH) != 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		             "%s is not a semester archive", path);
+		return FALSE;
+	}
+	self->end = MAGIC_LENGTH;
+
+	while (self->end + HEADER_LENGTH <= size) {
+		guint8 header[HEADER_LENGTH];
+		guint32 length;
+
+		if (!g_input_stream_read_all (G_INPUT_STREAM (stream), header, sizeof header, &n_read, NULL, error))
+			return FALSE;
+		memcpy (&length, header + 4, 4);
+		length = GUINT32_FROM_LE (length);
+
+		/* Torn by a crash while appending */
+		if (n_read < sizeof header || self->end + HEADER_LENGTH + length > size)
+			break;
+
+		if (memcmp (header, INDEX_TAG, 4) == 0) {
+			g_autoptr(GBytes) payload = NULL;
+
+			payload = g_input_stream_read_bytes (G_INPUT_STREAM (stream), length, NULL, error);
+			if (payload == NULL)
+				return FALSE;
+			add_entry (self, deserialize (G_VARIANT_TYPE (INDEX_TYPE), payload));
+		} else if (!g_seekable_seek (G_SEEKABLE (stream), length, G_SEEK_CUR, NULL, error)) {
+			return FALSE;
+		}
+
+		self->end += HEADER_LENGTH + length;
+	}
+
+	self->loaded = TRUE;
+
+	return TRUE;
+}
+
+guint
+classlimit_archive_get_n_semesters (ClasslimitArchive *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_ARCHIVE (self), 0);
+
+	return self->entries->len;
+}
+
+const char *
+classlimit_archive_get_name (ClasslimitArchive *self,
+                             guint              semester)
+{
+	const char *name;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ARCHIVE (self), NULL);
+	g_return_val_if_fail (semester < self->entries->len, NULL);
+
+	g_variant_get_child (g_ptr_array_index (self->entries, semester), ENTRY_NAME, "&s", &name);
+
+	return name;
+}
+
+gint64
+classlimit_archive_get_time (ClasslimitArchive *self,
+                             guint              semester)
+{
+	gint64 time;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ARCHIVE (self), 0);
+	g_return_val_if_fail (semester < self->entries->len, 0);
+
+	g_variant_get_child (g_ptr_array_index (self->entries, semester), ENTRY_TIME, "x", &time);
+
+	return time;
+}
+
+guint
+classlimit_archive_get_n_subjects (ClasslimitArchive *self,
+                                   guint              semester)
+{
+	guint n_subjects;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ARCHIVE (self), 0);
+	g_return_val_if_fail (semester < self->entries->len, 0);
+
+	g_variant_get_child (g_ptr_array_index (self->entries, semester), ENTRY_N_SUBJECTS, "u", &n_subjects);
+
+	return n_subjects;
+}
+
+/**
+ * classlimit_archive_read:
+ * @self: a #ClasslimitArchive
+ * @semester: a semester index, oldest first
+ * @error: return location for a #GError
+ *
+ * Reads and inflates the block of @semester, and nothing else.
+ *
+ * Returns: (transfer full): the subjects, policies and skip history
+ *   of @semester as `(a(siii)a(ssiii)a(sa(xii)))`, subjects as stored
+ *   in GSettings and history series by subject name with the total
+ *   under the empty name, or %NULL on error
+ */
+GVariant *
+classlimit_archive_read (ClasslimitArchive  *self,
+                         guint               semester,
+                         GError            **error)
+{
+	g_autoptr(GFileInputStream) stream = NULL;
+	g_autoptr(GZlibDecompressor) decompressor = NULL;
+	g_autoptr(GBytes) compressed = NULL;
+	g_autoptr(GBytes) data = NULL;
+	guint64 offset;
+	guint32 compressed_length, length;
+	GVariant *entry;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ARCHIVE (self), NULL);
+	g_return_val_if_fail (semester < self->entries->len, NULL);
+
+	entry = g_ptr_array_index (self->entries, semester);
+	g_variant_get_child (entry, ENTRY_OFFSET, "t", &offset);
+	g_variant_get_child (entry, ENTRY_COMPRESSED_LENGTH, "u", &compressed_length);
+	g_variant_get_child (entry, ENTRY_LENGTH, "u", &length);
+
+	stream = g_file_read (self->file, NULL, error);
+	if (stream == NULL ||
+	    !g_seekable_seek (G_SEEKABLE (stream), offset, G_SEEK_SET, NULL, error))
+		return NULL;
+
+	compressed = g_input_stream_read_bytes (G_INPUT_STREAM (stream), compressed_length, NULL, error);
+	if (compressed == NULL)
+		return NULL;
+	if (g_bytes_get_size (compressed) < compressed_length) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		             "Semester %u is truncated", semester);
+		return NULL;
+	}
+
+	decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB);
+	data = convert (G_CONVERTER (decompressor), g_bytes_get_data (compressed, NULL),
+	                compressed_length, length, error);
+	if (data == NULL)
+		return NULL;
+
+	return deserialize (G_VARIANT_TYPE (DATA_TYPE), data);
+}
+
+/* One subject name within a semester */
+typedef struct {
+	guint id;
+	int   weekly_hours;
+	int   skips;
+	int   max_skips;
+} Aggregate;
+
+/* Running sums behind a summary */
+typedef struct {
+	guint  n_semesters;
+	gint64 skips;
+	gint64 weekly_hours;
+	int    max_skips;
+} Totals;
+
+static int
+compare_summaries (gconstpointer a,
+                   gconstpointer b)
+{
+	const ClasslimitArchiveSummary *sa = a;
+	const ClasslimitArchiveSummary *sb = b;
+
+	return g_utf8_collate (sa->name, sb->name);
+}
+
+/**
+ * classlimit_archive_summarize:
+ * @self: a #ClasslimitArchive
+ * @n_recent: how many of the latest semesters to look at, or 0 for all
+ *
+ * Averages skips and weekly hours per subject name over the latest
+ * @n_recent semesters, from the index alone. A subject counts once
+ * per semester it was taken in.
+ *
+ * Returns: (transfer full) (element-type ClasslimitArchiveSummary): the
+ *   summaries, sorted by name
+ */
+GArray *
+classlimit_archive_summarize (ClasslimitArchive *self,
+                              guint              n_recent)
+{
+	g_autoptr(GArray) totals = NULL;
+	GArray *summaries;
+	guint first;
+	guint i, j;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ARCHIVE (self), NULL);
+
+	summaries = g_array_new (FALSE, FALSE, sizeof (ClasslimitArchiveSummary));
+	g_array_set_clear_func (summaries, summary_clear);
+	totals = g_array_sized_new (FALSE, TRUE, sizeof (Totals), self->names->len);
+	g_array_set_size (totals, self->names->len);
+
+	first = n_recent > 0 && n_recent < self->entries->len ? self->entries->len - n_recent : 0;
+	for (i = first; i < self->entries->len; i++) {
+		g_autoptr(GVariant) aggregates = g_variant_get_child_value (g_ptr_array_index (self->entries, i), ENTRY_AGGREGATES);
+		gsize n_aggregates = g_variant_n_children (aggregates);
+
+		for (j = 0; j < n_aggregates; j++) {
+			Totals *total;
+			guint id;
+			int weekly_hours, skips, max_skips;
+
+			g_variant_get_child (aggregates, j, "(uiii)", &id, &weekly_hours, &skips, &max_skips);
+			if (id >= totals->len)
+				continue;
+
+			total = &g_array_index (totals, Totals, id);
+			total->n_semesters++;
+			total->skips += skips;
+			total->weekly_hours += weekly_hours;
+			total->max_skips = MAX (total->max_skips, max_skips);
+		}
+	}
+
+	for (i = 0; i < totals->len; i++) {
+		const Totals *total = &g_array_index (totals, Totals, i);
+		ClasslimitArchiveSummary summary;
+
+		if (total->n_semesters == 0)
+			continue;
+
+		summary.name = g_strdup (g_ptr_array_index (self->names, i));
+		summary.n_semesters = total->n_semesters;
+		summary.average_skips = (double) total->skips / total->n_semesters;
+		summary.average_weekly_hours = (double) total->weekly_hours / total->n_semesters;
+		summary.max_skips = total->max_skips;
+		g_array_append_val (summaries, summary);
+	}
+
+	g_array_sort (summaries, compare_summaries);
+
+	return summaries;
+}
+
+static void
+append_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+	ClasslimitArchive *self = source_object;
+	Append *append = task_data;
+	g_autoptr(GZlibCompressor) compressor = NULL;
+	g_autoptr(GFileIOStream) io = NULL;
+	g_autoptr(GFile) dir = NULL;
+	g_autoptr(GBytes) data = NULL;
+	g_autoptr(GBytes) compressed = NULL;
+	g_autoptr(GBytes) entry = NULL;
+	g_autoptr(GError) error = NULL;
+	GOutputStream *out;
+	guint64 offset;
+
+	data = serialize (append->data);
+	compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB, 9);
+	compressed = convert (G_CONVERTER (compressor), g_bytes_get_data (data, NULL), g_bytes_get_size (data),
+	                      g_bytes_get_size (data) / 4, &error);
+	if (compressed == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	dir = g_file_get_parent (self->file);
+	if (!g_file_make_directory_with_parents (dir, cancellable, &error) &&
+	    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	g_clear_error (&error);
+
+	io = g_file_open_readwrite (self->file, cancellable, &error);
+	if (io == NULL && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+		g_clear_error (&error);
+		io = g_file_create_readwrite (self->file, G_FILE_CREATE_PRIVATE, cancellable, &error);
+	}
+	if (io == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	out = g_io_stream_get_output_stream (G_IO_STREAM (io));
+
+	/* Anything past the last complete record was torn by a crash */
+	if (!g_seekable_truncate (G_SEEKABLE (io), append->end, cancellable, &error) ||
+	    !g_seekable_seek (G_SEEKABLE (io), append->end, G_SEEK_SET, cancellable, &error) ||
+	    (append->end == 0 &&
+	     !g_output_stream_write_all (out, ARCHIVE_MAGIC, MAGIC_LENGTH, NULL, cancellable, &error))) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	append->end = MAX (append->end, MAGIC_LENGTH);
+
+	offset = append->end + HEADER_LENGTH;
+	append->entry = g_variant_ref_sink (g_variant_new ("(sxiiituuu@as@a(uiii))",
+		append->name, append->time,
+		append->required_attendance, append->total_weeks, append->session_hours,
+		offset, (guint32) g_bytes_get_size (compressed), (guint32) g_bytes_get_size (data),
+		append->n_subjects, append->new_names, append->aggregates));
+	entry = serialize (append->entry);
+
+	/* The block first, so an index entry never points past the end */
+	if (!write_record (out, DATA_TAG, compressed, &error) ||
+	    !write_record (out, INDEX_TAG, entry, &error) ||
+	    !g_io_stream_close (G_IO_STREAM (io), cancellable, &error)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	append->end = offset + g_bytes_get_size (compressed) + HEADER_LENGTH + g_bytes_get_size (entry);
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * classlimit_archive_append_async:
+ * @self: a #ClasslimitArchive
+ * @name: a name for the semester, like "Spring 2026"
+ * @roster: the roster to archive
+ * @history: (nullable): the skip history of @roster
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the semester has been written
+ * @user_data: data for @callback
+ *
+ * Appends the subjects, parameters and policies of @roster as a new
+ * semester, with the samples @history recorded since the previous
+ * semester was archived. The roster is read right away, so it may be
+ * changed or reset before @callback runs; compressing and writing
+ * happen on a worker thread. Only one append may be in flight.
+ */
+void
+classlimit_archive_append_async (ClasslimitArchive   *self,
+                                 const char          *name,
+                                 ClasslimitRoster    *roster,
+                                 ClasslimitHistory   *history,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(GHashTable) by_name = NULL;
+	g_autoptr(GArray) aggregates = NULL;
+	GVariantBuilder subjects;
+	GVariantBuilder new_names;
+	GVariantBuilder aggregate_builder;
+	GVariantBuilder series;
+	Append *append;
+	gint64 since = G_MININT64;
+	guint n_new_names = 0;
+	guint n_items;
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_ARCHIVE (self));
+	g_return_if_fail (name != NULL);
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (roster));
+	g_return_if_fail (history == NULL || CLASSLIMIT_IS_HISTORY (history));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, classlimit_archive_append_async);
+
+	/* Writing after a file we could not read would lose it */
+	if (!self->loaded) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+		                         "The archive could not be opened");
+		return;
+	}
+	if (self->appending) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_PENDING,
+		                         "A semester is already being archived");
+		return;
+	}
+
+	/* Subjects go in the block; the index gets one aggregate per name */
+	g_variant_builder_init (&subjects, G_VARIANT_TYPE ("a(siii)"));
+	g_variant_builder_init (&new_names, G_VARIANT_TYPE ("as"));
+	aggregates = g_array_new (FALSE, FALSE, sizeof (Aggregate));
+	by_name = g_hash_table_new (g_str_hash, g_str_equal);
+	n_items = g_list_model_get_n_items (G_LIST_MODEL (roster));
+	for (i = 0; i < n_items; i++) {
+		ClasslimitSubject *s = classlimit_roster_get_subject (roster, i);
+		const char *subject_name = classlimit_subject_get_name (s);
+		int weekly_hours = classlimit_subject_get_weekly_hours (s);
+		int current_skips = classlimit_subject_get_current_skips (s);
+		Aggregate *aggregate;
+		gpointer index;
+
+		g_variant_builder_add (&subjects, "(siii)", subject_name, weekly_hours, current_skips,
+		                       classlimit_subject_get_allowed_skips (s));
+
+		if (!g_hash_table_lookup_extended (by_name, subject_name, NULL, &index)) {
+			Aggregate empty = { self->names->len + n_new_names, 0, 0, 0 };
+			gpointer id;
+
+			if (g_hash_table_lookup_extended (self->name_ids, subject_name, NULL, &id)) {
+				empty.id = GPOINTER_TO_UINT (id);
+			} else {
+				g_variant_builder_add (&new_names, "s", subject_name);
+				n_new_names++;
+			}
+
+			index = GUINT_TO_POINTER (aggregates->len);
+			g_array_append_val (aggregates, empty);
+			g_hash_table_insert (by_name, (gpointer) subject_name, index);
+		}
+
+		aggregate = &g_array_index (aggregates, Aggregate, GPOINTER_TO_UINT (index));
+		aggregate->weekly_hours += weekly_hours;
+		aggregate->skips += current_skips;
+		aggregate->max_skips = MAX (aggregate->max_skips, current_skips);
+	}
+
+	g_variant_builder_init (&aggregate_builder, G_VARIANT_TYPE ("a(uiii)"));
+	for (i = 0; i < aggregates->len; i++) {
+		const Aggregate *aggregate = &g_array_index (aggregates, Aggregate, i);
+
+		g_variant_builder_add (&aggregate_builder, "(uiii)", aggregate->id,
+		                       aggregate->weekly_hours, aggregate->skips, aggregate->max_skips);
+	}
+
+	if (self->entries->len > 0)
+		since = classlimit_archive_get_time (self, self->entries->len - 1);
+
+	g_variant_builder_init (&series, G_VARIANT_TYPE ("a(sa(xii))"));
+	for (i = 0; history && i < classlimit_history_get_n_series (history); i++) {
+		const ClasslimitHistorySample *samples;
+		guint n_samples, lo, hi;
+
+		/* Samples are in time order, so find this semester's first one */
+		samples = classlimit_history_get_samples (history, i, &n_samples);
+		lo = 0;
+		hi = n_samples;
+		while (lo < hi) {
+			guint mid = lo + (hi - lo) / 2;
+
+			if (samples[mid].time <= since)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo == n_samples)
+			continue;
+
+		g_variant_builder_open (&series, G_VARIANT_TYPE ("(sa(xii))"));
+		g_variant_builder_add (&series, "s", classlimit_history_get_series_name (history, i));
+		g_variant_builder_open (&series, G_VARIANT_TYPE ("a(xii)"));
+		for (; lo < n_samples; lo++)
+			g_variant_builder_add (&series, "(xii)", samples[lo].time, samples[lo].skips, samples[lo].remaining);
+		g_variant_builder_close (&series);
+		g_variant_builder_close (&series);
+	}
+
+	append = g_new0 (Append, 1);
+	append->name = g_strdup (name);
+	append->time = MAX (g_get_real_time (), since + 1);
+	append->required_attendance = classlimit_roster_get_required_attendance (roster);
+	append->total_weeks = classlimit_roster_get_total_weeks (roster);
+	append->session_hours = classlimit_roster_get_session_hours (roster);
+	append->n_subjects = n_items;
+	append->new_names = g_variant_ref_sink (g_variant_builder_end (&new_names));
+	append->aggregates = g_variant_ref_sink (g_variant_builder_end (&aggregate_builder));
+	append->data = g_variant_ref_sink (g_variant_new ("(@a(siii)@a(ssiii)@a(sa(xii)))",
+		g_variant_builder_end (&subjects), classlimit_roster_get_policies (roster),
+		g_variant_builder_end (&series)));
+	append->end = self->end;
+
+	self->appending = TRUE;
+	g_task_set_task_data (task, append, append_free);
+	g_task_run_in_thread (task, append_thread);
+}
+
+gboolean
+classlimit_archive_append_finish (ClasslimitArchive  *self,
+                                  GAsyncResult       *result,
+                                  GError            **error)
+{
+	Append *append;
+	gboolean success;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ARCHIVE (self), FALSE);
+	g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+	append = g_task_get_task_data (G_TASK (result));
+	success = g_task_propagate_boolean (G_TASK (result), error);
+
+	/* Refused before anything was written */
+	if (append == NULL)
+		return success;
+
+	self->appending = FALSE;
+	if (!success)
+		return FALSE;
+
+	add_entry (self, g_steal_pointer (&append->entry));
+	self->end = append->end;
+
+	return TRUE;
+}
@@ -0,0 +1,71 @@
+/* classlimit-archive.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "classlimit-history.h"
+#include "classlimit-roster.h"
+
+G_BEGIN_DECLS
+
+#define CLASSLIMIT_TYPE_ARCHIVE (classlimit_archive_get_type())
+
+G_DECLARE_FINAL_TYPE (ClasslimitArchive, classlimit_archive, CLASSLIMIT, ARCHIVE, GObject)
+
+/* One subject name over several archived semesters */
+typedef struct {
+	char   *name;
+	guint   n_semesters;
+	double  average_skips;
+	double  average_weekly_hours;
+	int     max_skips;
+} ClasslimitArchiveSummary;
+
+ClasslimitArchive *classlimit_archive_new                (void);
+char              *classlimit_archive_get_default_path   (void);
+gboolean           classlimit_archive_load               (ClasslimitArchive    *self,
+                                                          const char           *path,
+                                                          GError              **error);
+guint              classlimit_archive_get_n_semesters    (ClasslimitArchive    *self);
+const char        *classlimit_archive_get_name           (ClasslimitArchive    *self,
+                                                          guint                 semester);
+gint64             classlimit_archive_get_time           (ClasslimitArchive    *self,
+                                                          guint                 semester);
+guint              classlimit_archive_get_n_subjects     (ClasslimitArchive    *self,
+                                                          guint                 semester);
+GVariant          *classlimit_archive_read               (ClasslimitArchive    *self,
+                                                          guint                 semester,
+                                                          GError              **error);
+GArray            *classlimit_archive_summarize          (ClasslimitArchive    *self,
+                                                          guint                 n_recent);
+void               classlimit_archive_append_async       (ClasslimitArchive    *self,
+                                                          const char           *name,
+                                                          ClasslimitRoster     *roster,
+                                                          ClasslimitHistory    *history,
+                                                          GCancellable         *cancellable,
+                                                          GAsyncReadyCallback   callback,
+                                                          gpointer              user_data);
+gboolean           classlimit_archive_append_finish      (ClasslimitArchive    *self,
+                                                          GAsyncResult         *result,
+                                                          GError              **error);
+
+G_END_DECLS
@@ -0,0 +1,763 @@
+/* classlimit-chart.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+#include <glib/gi18n.h>
+
+#include <math.h>
+
+#include "classlimit-chart.h"
+
+/* Time series plotted as a step line over a min/max band. Each line
+ * keeps a pyramid of buckets: level 0 holds the samples themselves and
+ * every bucket of level k + 1 summarises FANOUT neighbours of level k.
+ * Drawing picks the finest level with at most two buckets per pixel in
+ * view, so a frame costs the same for a week of history as for years,
+ * and appending a sample only touches the last bucket of each level.
+ */
+
+#define FANOUT          4
+#define MAX_LEVELS     16
+#define MIN_SPAN       (60 * G_USEC_PER_SEC)
+#define PADDING         8
+#define LABEL_SPACING   6
+#define LINE_WIDTH      2
+#define ZOOM_STEP       1.25
+
+typedef struct {
+	gint64 start;
+	gint64 end;
+	float  first;
+	float  last;
+	float  min;
+	float  max;
+} Bucket;
+
+typedef struct {
+	GArray *levels[MAX_LEVELS];
+	guint   n_levels;
+} Pyramid;
+
+/* Adwaita palette orange 3 and blue 3 */
+static const GdkRGBA line_colors[CLASSLIMIT_CHART_N_LINES] = {
+	[CLASSLIMIT_CHART_LINE_SKIPS]     = { 1.0f,   0.471f, 0.0f,   1.0f },
+	[CLASSLIMIT_CHART_LINE_REMAINING] = { 0.208f, 0.518f, 0.894f, 1.0f },
+};
+
+struct _ClasslimitChart
+{
+	GtkWidget        parent_instance;
+
+	Pyramid          lines[CLASSLIMIT_CHART_N_LINES];
+	gboolean         has_data;
+	gint64           data_start;
+	gint64           data_end;
+
+	/* Visible time range; fit tracks all of the data, follow keeps the
+	 * newest sample at the right edge as more arrive.
+	 */
+	gint64           view_start;
+	gint64           view_span;
+	gboolean         fit;
+	gboolean         follow;
+
+	graphene_rect_t  plot;
+	double           pointer_x;
+	gint64           gesture_start;
+	gint64           gesture_span;
+};
+
+G_DEFINE_FINAL_TYPE (ClasslimitChart, classlimit_chart, GTK_TYPE_WIDGET)
+
+static void
+bucket_merge (Bucket       *into,
+              const Bucket *from)
+{
+	into->end = from->end;
+	into->last = from->last;
+	into->min = MIN (into->min, from->min);
+	into->max = MAX (into->max, from->max);
+}
+
+static void
+pyramid_init (Pyramid *pyramid)
+{
+	pyramid->levels[0] = g_array_new (FALSE, FALSE, sizeof (Bucket));
+	pyramid->n_levels = 1;
+}
+
+static void
+pyramid_clear (Pyramid *pyramid)
+{
+	guint k;
+
+	for (k = 0; k < pyramid->n_levels; k++)
+		g_clear_pointer (&pyramid->levels[k], g_array_unref);
+	pyramid->n_levels = 0;
+}
+
+static void
+pyramid_append (Pyramid      *pyramid,
+                const Bucket *sample)
+{
+	guint k;
+
+	g_array_append_vals (pyramid->levels[0], sample, 1);
+
+	/* Fold the changed last bucket of each level into its parent */
+	for (k = 0; k < pyramid->n_levels; k++) {
+		GArray *level = pyramid->levels[k];
+		const Bucket *child = &g_array_index (level, Bucket, level->len - 1);
+		GArray *parent;
+		guint index;
+
+		if (k + 1 == pyramid->n_levels) {
+			if (level->len < 2 || pyramid->n_levels == MAX_LEVELS)
+				break;
+
+			/* The top level just outgrew one bucket, start the next */
+			parent = g_array_new (FALSE, FALSE, sizeof (Bucket));
+			g_array_append_vals (parent, level->data, 1);
+			pyramid->levels[pyramid->n_levels++] = parent;
+		}
+
+		parent = pyramid->levels[k + 1];
+		index = (level->len - 1) / FANOUT;
+		if (index == parent->len)
+			g_array_append_vals (parent, child, 1);
+		else
+			bucket_merge (&g_array_index (parent, Bucket, index), child);
+	}
+}
+
+/* Index of the first bucket ending at or after @time */
+static guint
+first_visible (GArray *level,
+               gint64  time)
+{
+	guint lo = 0;
+	guint hi = level->len;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (g_array_index (level, Bucket, mid).end < time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Index of the first bucket starting after @time */
+static guint
+end_visible (GArray *level,
+             gint64  time)
+{
+	guint lo = 0;
+	guint hi = level->len;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (g_array_index (level, Bucket, mid).start <= time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Finds the finest level that still fits two buckets per pixel. The
+ * range includes the bucket before the view so the line enters from
+ * the left edge.
+ */
+static GArray *
+pick_level (Pyramid *pyramid,
+            gint64   start,
+            gint64   end,
+            double   width,
+            guint   *first,
+            guint   *last)
+{
+	GArray *level;
+	guint k;
+
+	for (k = 0; ; k++) {
+		level = pyramid->levels[k];
+		*first = first_visible (level, start);
+		*last = end_visible (level, end);
+		if (*last - MIN (*first, *last) <= 2 * width || k + 1 == pyramid->n_levels)
+			break;
+	}
+
+	if (*first > 0)
+		(*first)--;
+
+	return level;
+}
+
+static void
+clamp_view (ClasslimitChart *self)
+{
+	gint64 extent = self->data_end - self->data_start;
+	gint64 max_span = MAX (extent, MIN_SPAN) * 2;
+
+	self->view_span = CLAMP (self->view_span, MIN_SPAN, max_span);
+
+	/* Keep at least half the view on the data */
+	self->view_start = CLAMP (self->view_start,
+	                          self->data_start - self->view_span / 2,
+	                          MAX (self->data_end - self->view_span / 2, self->data_start - self->view_span / 2));
+	self->follow = self->view_start + self->view_span >= self->data_end;
+}
+
+static void
+set_view (ClasslimitChart *self,
+          gint64           start,
+          gint64           span)
+{
+	if (!self->has_data)
+		return;
+
+	self->view_start = start;
+	self->view_span = span;
+	self->fit = FALSE;
+	clamp_view (self);
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static gint64
+time_at (ClasslimitChart *self,
+         double           x)
+{
+	double fraction = self->plot.size.width > 0 ? (x - self->plot.origin.x) / self->plot.size.width : 0;
+
+	return self->view_start + (gint64) (fraction * self->view_span);
+}
+
+static PangoLayout *
+create_label (ClasslimitChart *self,
+              const char      *text)
+{
+	PangoLayout *layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), text);
+	PangoAttrList *attrs = pango_attr_list_new ();
+
+	pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_SMALL));
+	pango_attr_list_insert (attrs, pango_attr_font_features_new ("tnum=1"));
+	pango_layout_set_attributes (layout, attrs);
+	pango_attr_list_unref (attrs);
+
+	return layout;
+}
+
+static char *
+format_time (gint64 time,
+             gint64 span)
+{
+	g_autoptr(GDateTime) date = g_date_time_new_from_unix_local (time / G_USEC_PER_SEC);
+
+	if (date == NULL)
+		return g_strdup ("");
+
+	return g_date_time_format (date, span >= 2 * G_TIME_SPAN_DAY ? "%x" : "%R");
+}
+
+static void
+snapshot_label (GtkSnapshot   *snapshot,
+                PangoLayout   *layout,
+                double         x,
+                double         y,
+                const GdkRGBA *color)
+{
+	gtk_snapshot_save (snapshot);
+	gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (x, y));
+	gtk_snapshot_append_layout (snapshot, layout, color);
+	gtk_snapshot_restore (snapshot);
+}
+
+static void
+snapshot_legend (ClasslimitChart *self,
+                 GtkSnapshot     *snapshot,
+                 const GdkRGBA   *color)
+{
+	const char *names[CLASSLIMIT_CHART_N_LINES] = {
+		[CLASSLIMIT_CHART_LINE_SKIPS]     = _("Skips"),
+		[CLASSLIMIT_CHART_LINE_REMAINING] = _("Remaining"),
+	};
+	double x = self->plot.origin.x + self->plot.size.width;
+	int i;
+
+	/* Right-aligned, last line first */
+	for (i = CLASSLIMIT_CHART_N_LINES - 1; i >= 0; i--) {
+		g_autoptr(PangoLayout) layout = create_label (self, names[i]);
+		int width, height;
+
+		pango_layout_get_pixel_size (layout, &width, &height);
+		x -= width;
+		snapshot_label (snapshot, layout, x, self->plot.origin.y, color);
+		x -= LABEL_SPACING + height / 2;
+		gtk_snapshot_append_color (snapshot, &line_colors[i],
+			&GRAPHENE_RECT_INIT (x, self->plot.origin.y + height / 2 - LINE_WIDTH / 2,
+			                     height / 2, LINE_WIDTH));
+		x -= 2 * LABEL_SPACING;
+	}
+}
+
+static void
+classlimit_chart_snapshot (GtkWidget   *widget,
+                           GtkSnapshot *snapshot)
+{
+	ClasslimitChart *self = CLASSLIMIT_CHART (widget);
+	const graphene_rect_t *plot = &self->plot;
+	GArray *levels[CLASSLIMIT_CHART_N_LINES];
+	guint first[CLASSLIMIT_CHART_N_LINES];
+	guint last[CLASSLIMIT_CHART_N_LINES];
+	g_autoptr(PangoLayout) layout = NULL;
+	g_autofree char *text = NULL;
+	gint64 view_end = self->view_start + self->view_span;
+	double y_min = 0;
+	double y_max = 1;
+	double y_scale;
+	GdkRGBA color;
+	GdkRGBA dim;
+	int text_width, text_height;
+	guint i, j;
+
+	gtk_widget_get_color (widget, &color);
+	dim = color;
+	dim.alpha *= 0.55;
+
+	if (!self->has_data) {
+		layout = create_label (self, _("No skips recorded yet"));
+		pango_layout_get_pixel_size (layout, &text_width, &text_height);
+		snapshot_label (snapshot, layout,
+		                (gtk_widget_get_width (widget) - text_width) / 2.0,
+		                (gtk_widget_get_height (widget) - text_height) / 2.0, &dim);
+		return;
+	}
+
+	if (plot->size.width <= 0 || plot->size.height <= 0)
+		return;
+
+	for (i = 0; i < CLASSLIMIT_CHART_N_LINES; i++) {
+		levels[i] = pick_level (&self->lines[i], self->view_start, view_end,
+		                        plot->size.width, &first[i], &last[i]);
+		for (j = first[i]; j < last[i]; j++) {
+			const Bucket *b = &g_array_index (levels[i], Bucket, j);
+
+			y_min = MIN (y_min, b->min);
+			y_max = MAX (y_max, b->max);
+		}
+	}
+	y_max += (y_max - y_min) / 10;
+	y_scale = plot->size.height / (y_max - y_min);
+
+#define X(t) (plot->origin.x + (double) ((t) - self->view_start) / self->view_span * plot->size.width)
+#define Y(v) (plot->origin.y + plot->size.height - ((v) - y_min) * y_scale)
+
+	/* Axes: value range on the left, time range below */
+	gtk_snapshot_append_color (snapshot, &dim,
+		&GRAPHENE_RECT_INIT (plot->origin.x, Y (0), plot->size.width, 1));
+
+	text = g_strdup_printf ("%.0f", y_max);
+	layout = create_label (self, text);
+	pango_layout_get_pixel_size (layout, &text_width, &text_height);
+	snapshot_label (snapshot, layout, plot->origin.x - LABEL_SPACING - text_width, plot->origin.y, &dim);
+	g_clear_object (&layout);
+	g_clear_pointer (&text, g_free);
+
+	text = g_strdup_printf ("%.0f", y_min);
+	layout = create_label (self, text);
+	pango_layout_get_pixel_size (layout, &text_width, &text_height);
+	snapshot_label (snapshot, layout, plot->origin.x - LABEL_SPACING - text_width,
+	                plot->origin.y + plot->size.height - text_height, &dim);
+	g_clear_object (&layout);
+	g_clear_pointer (&text, g_free);
+
+	text = format_time (self->view_start, self->view_span);
+	layout = create_label (self, text);
+	snapshot_label (snapshot, layout, plot->origin.x,
+	                plot->origin.y + plot->size.height + LABEL_SPACING, &dim);
+	g_clear_object (&layout);
+	g_clear_pointer (&text, g_free);
+
+	text = format_time (view_end, self->view_span);
+	layout = create_label (self, text);
+	pango_layout_get_pixel_size (layout, &text_width, &text_height);
+	snapshot_label (snapshot, layout, plot->origin.x + plot->size.width - text_width,
+	                plot->origin.y + plot->size.height + LABEL_SPACING, &dim);
+
+	gtk_snapshot_push_clip (snapshot, plot);
+
+	for (i = 0; i < CLASSLIMIT_CHART_N_LINES; i++) {
+		g_autoptr(GskPathBuilder) band = gsk_path_builder_new ();
+		g_autoptr(GskPathBuilder) line = gsk_path_builder_new ();
+		g_autoptr(GskPath) band_path = NULL;
+		g_autoptr(GskPath) line_path = NULL;
+		g_autoptr(GskStroke) stroke = NULL;
+		GdkRGBA band_color = line_colors[i];
+		gboolean has_band = FALSE;
+		float previous = 0;
+
+		if (first[i] >= last[i])
+			continue;
+
+		for (j = first[i]; j < last[i]; j++) {
+			const Bucket *b = &g_array_index (levels[i], Bucket, j);
+			double x0 = X (b->start);
+			double x1 = MAX (X (b->end), x0 + 1);
+
+			/* Where a bucket hides several samples, show their spread */
+			if (b->max > b->min) {
+				gsk_path_builder_add_rect (band, &GRAPHENE_RECT_INIT (x0, Y (b->max), x1 - x0,
+				                                                      (b->max - b->min) * y_scale));
+				has_band = TRUE;
+			}
+
+			if (j == first[i]) {
+				gsk_path_builder_move_to (line, x0, Y (b->first));
+			} else {
+				gsk_path_builder_line_to (line, x0, Y (previous));
+				gsk_path_builder_line_to (line, x0, Y (b->first));
+			}
+			gsk_path_builder_line_to (line, X (b->end), Y (b->last));
+			previous = b->last;
+		}
+
+		/* The newest value holds until now */
+		if (last[i] == levels[i]->len)
+			gsk_path_builder_line_to (line, plot->origin.x + plot->size.width, Y (previous));
+
+		if (has_band) {
+			band_color.alpha = 0.25;
+			band_path = gsk_path_builder_free_to_path (g_steal_pointer (&band));
+			gtk_snapshot_append_fill (snapshot, band_path, GSK_FILL_RULE_WINDING, &band_color);
+		}
+
+		stroke = gsk_stroke_new (LINE_WIDTH);
+		gsk_stroke_set_line_join (stroke, GSK_LINE_JOIN_ROUND);
+		line_path = gsk_path_builder_free_to_path (g_steal_pointer (&line));
+		gtk_snapshot_append_stroke (snapshot, line_path, stroke, &line_colors[i]);
+	}
+
+#undef X
+#undef Y
+
+	gtk_snapshot_pop (snapshot);
+
+	snapshot_legend (self, snapshot, &dim);
+}
+
+static void
+classlimit_chart_measure (GtkWidget      *widget,
+                          GtkOrientation  orientation,
+                          int             for_size,
+                          int            *minimum,
+                          int            *natural,
+                          int            *minimum_baseline,
+                          int            *natural_baseline)
+{
+	if (orientation == GTK_ORIENTATION_HORIZONTAL) {
+		*minimum = 160;
+		*natural = 480;
+	} else {
+		*minimum = 120;
+		*natural = 240;
+	}
+}
+
+static void
+classlimit_chart_size_allocate (GtkWidget *widget,
+                                int        width,
+                                int        height,
+                                int        baseline)
+{
+	ClasslimitChart *self = CLASSLIMIT_CHART (widget);
+	g_autoptr(PangoLayout) layout = create_label (self, "0000");
+	int label_width, label_height;
+
+	/* Room for four digit values on the left and a date below */
+	pango_layout_get_pixel_size (layout, &label_width, &label_height);
+	graphene_rect_init (&self->plot,
+	                    PADDING + label_width + LABEL_SPACING,
+	                    PADDING,
+	                    MAX (width - 2 * PADDING - label_width - LABEL_SPACING, 0),
+	                    MAX (height - 2 * PADDING - label_height - LABEL_SPACING, 0));
+}
+
+static void
+on_motion (GtkEventControllerMotion *motion,
+           double                    x,
+           double                    y,
+           ClasslimitChart          *self)
+{
+	self->pointer_x = x;
+}
+
+static gboolean
+on_scroll (GtkEventControllerScroll *scroll,
+           double                    dx,
+           double                    dy,
+           ClasslimitChart          *self)
+{
+	gint64 anchor = time_at (self, self->pointer_x);
+	gint64 span = self->view_span;
+	gint64 start = self->view_start;
+
+	if (!self->has_data)
+		return FALSE;
+
+	/* Vertical scrolling zooms around the pointer, horizontal pans */
+	if (dy != 0) {
+		span = (gint64) (span * pow (ZOOM_STEP, dy));
+		start = anchor - (gint64) ((double) (anchor - self->view_start) / self->view_span * span);
+	}
+	if (dx != 0)
+		start += (gint64) (dx * span / 20);
+
+	set_view (self, start, span);
+
+	return TRUE;
+}
+
+static void
+on_drag_begin (GtkGestureDrag  *drag,
+               double           x,
+               double           y,
+               ClasslimitChart *self)
+{
+	self->gesture_start = self->view_start;
+}
+
+static void
+on_drag_update (GtkGestureDrag  *drag,
+                double           offset_x,
+                double           offset_y,
+                ClasslimitChart *self)
+{
+	if (self->plot.size.width <= 0)
+		return;
+
+	set_view (self, self->gesture_start - (gint64) (offset_x / self->plot.size.width * self->view_span),
+	          self->view_span);
+}
+
+static void
+on_zoom_begin (GtkGesture       *gesture,
+               GdkEventSequence *sequence,
+               ClasslimitChart  *self)
+{
+	self->gesture_start = self->view_start;
+	self->gesture_span = self->view_span;
+}
+
+static void
+on_zoom_scale_changed (GtkGestureZoom  *zoom,
+                       double           scale,
+                       ClasslimitChart *self)
+{
+	double x, y;
+	gint64 anchor;
+	gint64 span;
+
+	if (scale <= 0 || !gtk_gesture_get_bounding_box_center (GTK_GESTURE (zoom), &x, &y))
+		return;
+
+	self->view_start = self->gesture_start;
+	self->view_span = self->gesture_span;
+	anchor = time_at (self, x);
+	span = (gint64) (self->gesture_span / scale);
+	set_view (self, anchor - (gint64) ((double) (anchor - self->gesture_start) / self->gesture_span * span),
+	          span);
+}
+
+static void
+on_pressed (GtkGestureClick *click,
+            int              n_press,
+            double           x,
+            double           y,
+            ClasslimitChart *self)
+{
+	if (n_press == 2)
+		classlimit_chart_zoom_to_fit (self);
+}
+
+static void
+classlimit_chart_finalize (GObject *object)
+{
+	ClasslimitChart *self = CLASSLIMIT_CHART (object);
+	guint i;
+
+	for (i = 0; i < CLASSLIMIT_CHART_N_LINES; i++)
+		pyramid_clear (&self->lines[i]);
+
+	G_OBJECT_CLASS (classlimit_chart_parent_class)->finalize (object);
+}
+
+static void
+classlimit_chart_class_init (ClasslimitChartClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+	object_class->finalize = classlimit_chart_finalize;
+
+	widget_class->snapshot = classlimit_chart_snapshot;
+	widget_class->measure = classlimit_chart_measure;
+	widget_class->size_allocate = classlimit_chart_size_allocate;
+
+	gtk_widget_class_set_css_name (widget_class, "chart");
+	gtk_widget_class_set_accessible_role (widget_class, GTK_ACCESSIBLE_ROLE_IMG);
+}
+
+static void
+classlimit_chart_init (ClasslimitChart *self)
+{
+	GtkEventController *motion;
+	GtkEventController *scroll;
+	GtkGesture *drag;
+	GtkGesture *zoom;
+	GtkGesture *click;
+	guint i;
+
+	for (i = 0; i < CLASSLIMIT_CHART_N_LINES; i++)
+		pyramid_init (&self->lines[i]);
+	self->fit = TRUE;
+
+	motion = gtk_event_controller_motion_new ();
+	g_signal_connect (motion, "enter", G_CALLBACK (on_motion), self);
+	g_signal_connect (motion, "motion", G_CALLBACK (on_motion), self);
+	gtk_widget_add_controller (GTK_WIDGET (self), motion);
+
+	scroll = gtk_event_controller_scroll_new (GTK_EVENT_CONTROLLER_SCROLL_BOTH_AXES);
+	g_signal_connect (scroll, "scroll", G_CALLBACK (on_scroll), self);
+	gtk_widget_add_controller (GTK_WIDGET (self), scroll);
+
+	drag = gtk_gesture_drag_new ();
+	g_signal_connect (drag, "drag-begin", G_CALLBACK (on_drag_begin), self);
+	g_signal_connect (drag, "drag-update", G_CALLBACK (on_drag_update), self);
+	gtk_widget_add_controller (GTK_WIDGET (self), GTK_EVENT_CONTROLLER (drag));
+
+	zoom = gtk_gesture_zoom_new ();
+	g_signal_connect (zoom, "begin", G_CALLBACK (on_zoom_begin), self);
+	g_signal_connect (zoom, "scale-changed", G_CALLBACK (on_zoom_scale_changed), self);
+	gtk_widget_add_controller (GTK_WIDGET (self), GTK_EVENT_CONTROLLER (zoom));
+
+	click = gtk_gesture_click_new ();
+	g_signal_connect (click, "pressed", G_CALLBACK (on_pressed), self);
+	gtk_widget_add_controller (GTK_WIDGET (self), GTK_EVENT_CONTROLLER (click));
+
+	gtk_accessible_update_property (GTK_ACCESSIBLE (self),
+	                                GTK_ACCESSIBLE_PROPERTY_LABEL, _("Attendance history"),
+	                                GTK_ACCESSIBLE_PROPERTY_DESCRIPTION, _("Scroll to zoom, drag to pan, double-click to show everything"),
+	                                -1);
+}
+
+GtkWidget *
+classlimit_chart_new (void)
+{
+	return g_object_new (CLASSLIMIT_TYPE_CHART, NULL);
+}
+
+void
+classlimit_chart_clear (ClasslimitChart *self)
+{
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_CHART (self));
+
+	for (i = 0; i < CLASSLIMIT_CHART_N_LINES; i++) {
+		pyramid_clear (&self->lines[i]);
+		pyramid_init (&self->lines[i]);
+	}
+	self->has_data = FALSE;
+	self->fit = TRUE;
+
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+/**
+ * classlimit_chart_append:
+ * @self: a #ClasslimitChart
+ * @line: the line to extend
+ * @time: wall-clock time of the sample, in microseconds
+ * @value: the new value
+ *
+ * Adds a sample to the end of @line. Samples must arrive in time order;
+ * earlier ones are moved up to the newest time already shown.
+ */
+void
+classlimit_chart_append (ClasslimitChart     *self,
+                         ClasslimitChartLine  line,
+                         gint64               time,
+                         double               value)
+{
+	GArray *samples;
+	Bucket sample;
+
+	g_return_if_fail (CLASSLIMIT_IS_CHART (self));
+	g_return_if_fail (line < CLASSLIMIT_CHART_N_LINES);
+
+	samples = self->lines[line].levels[0];
+	if (samples->len > 0)
+		time = MAX (time, g_array_index (samples, Bucket, samples->len - 1).end);
+
+	sample.start = sample.end = time;
+	sample.first = sample.last = sample.min = sample.max = value;
+	pyramid_append (&self->lines[line], &sample);
+
+	if (!self->has_data) {
+		self->has_data = TRUE;
+		self->data_start = self->data_end = time;
+	}
+	self->data_start = MIN (self->data_start, time);
+	self->data_end = MAX (self->data_end, time);
+
+	if (self->fit) {
+		classlimit_chart_zoom_to_fit (self);
+		return;
+	}
+	if (self->follow)
+		self->view_start = self->data_end - self->view_span;
+
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+void
+classlimit_chart_zoom_to_fit (ClasslimitChart *self)
+{
+	gint64 extent;
+
+	g_return_if_fail (CLASSLIMIT_IS_CHART (self));
+
+	self->fit = TRUE;
+	self->follow = TRUE;
+
+	if (self->has_data) {
+		extent = self->data_end - self->data_start;
+		self->view_span = MAX (extent + extent / 20, MIN_SPAN);
+		self->view_start = self->data_start - (self->view_span - extent) / 2;
+	}
+
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+}
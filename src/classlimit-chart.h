@@ -0,0 +1,45 @@
+/* classlimit-chart.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define CLASSLIMIT_TYPE_CHART (classlimit_chart_get_type())
+
+G_DECLARE_FINAL_TYPE (ClasslimitChart, classlimit_chart, CLASSLIMIT, CHART, GtkWidget)
+
+typedef enum {
+	CLASSLIMIT_CHART_LINE_SKIPS,
+	CLASSLIMIT_CHART_LINE_REMAINING,
+	CLASSLIMIT_CHART_N_LINES
+} ClasslimitChartLine;
+
+GtkWidget *classlimit_chart_new         (void);
+void       classlimit_chart_clear       (ClasslimitChart     *self);
+void       classlimit_chart_append      (ClasslimitChart     *self,
+                                         ClasslimitChartLine  line,
+                                         gint64               time,
+                                         double               value);
+void       classlimit_chart_zoom_to_fit (ClasslimitChart     *self);
+
+G_END_DECLS
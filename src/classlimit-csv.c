@@ -0,0 +1,626 @@
+/* classlimit-csv.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+/* test-csv builds this file a second time with CLASSLIMIT_CSV_SCALAR,
+ * to check the vector scanners against the plain loop.
+ */
+#if defined(__SSE2__) && !defined(CLASSLIMIT_CSV_SCALAR)
+#define HAVE_SSE2_SCANNER 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && !defined(CLASSLIMIT_CSV_SCALAR)
+#define HAVE_NEON_SCANNER 1
+#include <arm_neon.h>
+#endif
+
+#include "classlimit-csv.h"
+
+void
+classlimit_csv_columns_clear (ClasslimitCsvColumns *columns)
+{
+	g_clear_pointer (&columns->name, g_free);
+	g_clear_pointer (&columns->weekly_hours, g_free);
+	g_clear_pointer (&columns->current_skips, g_free);
+}
+
+/* Finds the next delimiter, quote or line break. Fields are usually
+ * short, but names and long runs of unmapped columns are not, so whole
+ * vectors are tested at a time where the target has them.
+ */
+static inline const char *
+find_special_scalar (const char *p,
+                     const char *end,
+                     char        delimiter)
+{
+	for (; p < end; p++) {
+		if (*p == delimiter || *p == '"' || *p == '\n' || *p == '\r')
+			break;
+	}
+
+	return p;
+}
+
+#if defined(HAVE_SSE2_SCANNER)
+static inline const char *
+find_special (const char *p,
+              const char *end,
+              char        delimiter)
+{
+	const __m128i d = _mm_set1_epi8 (delimiter);
+	const __m128i q = _mm_set1_epi8 ('"');
+	const __m128i n = _mm_set1_epi8 ('\n');
+	const __m128i r = _mm_set1_epi8 ('\r');
+
+	while (end - p >= 16) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (gconstpointer) p);
+		__m128i hits = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (v, d), _mm_cmpeq_epi8 (v, q)),
+		                             _mm_or_si128 (_mm_cmpeq_epi8 (v, n), _mm_cmpeq_epi8 (v, r)));
+		int mask = _mm_movemask_epi8 (hits);
+
+		if (mask != 0)
+			return p + __builtin_ctz ((unsigned int) mask);
+		p += 16;
+	}
+
+	return find_special_scalar (p, end, delimiter);
+}
+#elif defined(HAVE_NEON_SCANNER)
+static inline const char *
+find_special (const char *p,
+              const char *end,
+              char        delimiter)
+{
+	const uint8x16_t d = vdupq_n_u8 ((guint8) delimiter);
+	const uint8x16_t q = vdupq_n_u8 ('"');
+	const uint8x16_t n = vdupq_n_u8 ('\n');
+	const uint8x16_t r = vdupq_n_u8 ('\r');
+
+	while (end - p >= 16) {
+		uint8x16_t v = vld1q_u8 ((const guint8 *) p);
+		uint8x16_t hits = vorrq_u8 (vorrq_u8 (vceqq_u8 (v, d), vceqq_u8 (v, q)),
+		                            vorrq_u8 (vceqq_u8 (v, n), vceqq_u8 (v, r)));
+		/* Narrow each byte to a nibble; there is no movemask */
+		guint64 mask = vget_lane_u64 (vreinterpret_u64_u8 (vshrn_n_u16 (vreinterpretq_u16_u8 (hits), 4)), 0);
+
+		if (mask != 0)
+			return p + (__builtin_ctzll (mask) >> 2);
+		p += 16;
+	}
+
+	return find_special_scalar (p, end, delimiter);
+}
+#else
+#define find_special find_special_scalar
+#endif
+
+typedef struct {
+	const char *p;
+	const char *end;
+	char        delimiter;
+	guint       record;
+	/* Unescaped contents of the last quoted field */
+	GString    *quoted;
+} Scanner;
+
+/* Reads one field. Unquoted fields point straight into the input, only
+ * quoted ones are copied, to undo "" escapes.
+ */
+static gboolean
+next_field (Scanner     *s,
+            const char **field,
+            gsize       *length,
+            gboolean    *end_of_record,
+            GError     **error)
+{
+	const char *p = s->p;
+
+	if (p < s->end && *p == '"') {
+		g_string_truncate (s->quoted, 0);
+		p++;
+		for (;;) {
+			const char *q = memchr (p, '"', s->end - p);
+
+			if (q == NULL) {
+				g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				             "Record %u: unterminated quoted field", s->record);
+				return FALSE;
+			}
+			g_string_append_len (s->quoted, p, q - p);
+			p = q + 1;
+			if (p < s->end && *p == '"') {
+				g_string_append_c (s->quoted, '"');
+				p++;
+			} else {
+				break;
+			}
+		}
+		*field = s->quoted->str;
+		*length = s->quoted->len;
+
+		/* Anything between the closing quote and the delimiter is dropped */
+		while (p < s->end && *p != s->delimiter && *p != '\n' && *p != '\r')
+			p++;
+	} else {
+		const char *start = p;
+
+		/* A quote inside an unquoted field is just a character */
+		for (;;) {
+			p = find_special (p, s->end, s->delimiter);
+			if (p < s->end && *p == '"')
+				p++;
+			else
+				break;
+		}
+		*field = start;
+		*length = p - start;
+	}
+
+	if (p >= s->end) {
+		*end_of_record = TRUE;
+	} else if (*p == s->delimiter) {
+		*end_of_record = FALSE;
+		p++;
+	} else {
+		*end_of_record = TRUE;
+		if (*p == '\r' && p + 1 < s->end && p[1] == '\n')
+			p++;
+		p++;
+	}
+
+	s->p = p;
+
+	return TRUE;
+}
+
+/* Straight from the input bytes, no copy and no locale */
+static gboolean
+parse_int (const char *p,
+           gsize       length,
+           int        *value)
+{
+	const char *end = p + length;
+	int result = 0;
+
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	while (end > p && (end[-1] == ' ' || end[-1] == '\t'))
+		end--;
+	if (p < end && *p == '+')
+		p++;
+	if (p == end)
+		return FALSE;
+
+	for (; p < end; p++) {
+		if (*p < '0' || *p > '9' || result > (G_MAXINT - 9) / 10)
+			return FALSE;
+		result = result * 10 + (*p - '0');
+	}
+
+	*value = result;
+
+	return TRUE;
+}
+
+/* Returns a 0-based column number, or -1 if @spec names a header */
+static int
+column_number (const char *spec)
+{
+	guint64 number;
+
+	if (spec == NULL || *spec == '\0' || !g_ascii_string_to_unsigned (spec, 10, 1, G_MAXINT, &number, NULL))
+		return -1;
+
+	return (int) number - 1;
+}
+
+/* Matches header names against the first record */
+static gboolean
+resolve_header (Scanner                     *s,
+                const ClasslimitCsvColumns  *columns,
+                int                          index[3],
+                GError                     **error)
+{
+	const char *specs[3] = { columns->name, columns->weekly_hours, columns->current_skips };
+	gboolean end_of_record = FALSE;
+	int column = 0;
+	guint i;
+
+	while (!end_of_record) {
+		g_autofree char *name = NULL;
+		const char *field;
+		gsize length;
+
+		if (!next_field (s, &field, &length, &end_of_record, error))
+			return FALSE;
+
+		name = g_strstrip (g_strndup (field, length));
+		for (i = 0; i < G_N_ELEMENTS (specs); i++) {
+			if (index[i] < 0 && specs[i] && *specs[i] && column_number (specs[i]) < 0 &&
+			    g_ascii_strcasecmp (name, specs[i]) == 0)
+				index[i] = column;
+		}
+		column++;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (specs); i++) {
+		if (index[i] < 0 && specs[i] && *specs[i]) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			             "No “%s” column in the header", specs[i]);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * classlimit_csv_parse:
+ * @data: CSV text
+ * @length: the length of @data
+ * @columns: which columns hold the name, weekly hours and skips
+ * @error: return location for a #GError
+ *
+ * Parses one subject per record. Records with an empty name, such as
+ * blank lines, are skipped. When every column is given by number, a
+ * first record whose hours are not a number is taken to be a header.
+ * Like classlimit_roster_parse_json(), this touches no roster and is
+ * safe to call from any thread.
+ *
+ * Returns: (transfer full) (element-type ClasslimitSubject): the subjects,
+ *   or %NULL on error
+ */
+GPtrArray *
+classlimit_csv_parse (const char                  *data,
+                      gsize                        length,
+                      const ClasslimitCsvColumns  *columns,
+                      GError                     **error)
+{
+	g_autoptr(GPtrArray) subjects = NULL;
+	g_autoptr(GString) quoted = NULL;
+	g_autoptr(GString) name = NULL;
+	Scanner s;
+	int index[3];
+	gboolean has_header;
+
+	g_return_val_if_fail (data != NULL || length == 0, NULL);
+	g_return_val_if_fail (columns != NULL, NULL);
+
+	index[0] = column_number (columns->name);
+	index[1] = column_number (columns->weekly_hours);
+	index[2] = column_number (columns->current_skips);
+	has_header = index[0] < 0 || index[1] < 0 ||
+	             (index[2] < 0 && columns->current_skips && *columns->current_skips);
+
+	quoted = g_string_sized_new (64);
+	name = g_string_sized_new (64);
+	s.p = data;
+	s.end = data + length;
+	s.delimiter = columns->delimiter ? columns->delimiter : ',';
+	s.record = 1;
+	s.quoted = quoted;
+
+	/* Spreadsheets like to start with a byte order mark */
+	if (length >= 3 && memcmp (data, "\xef\xbb\xbf", 3) == 0)
+		s.p += 3;
+
+	if (has_header) {
+		if (!resolve_header (&s, columns, index, error))
+			return NULL;
+		s.record++;
+	}
+
+	/* Rough guess from a typical record length, to avoid regrowing */
+	subjects = g_ptr_array_new_full ((guint) MIN (length / 16, 1 << 20), g_object_unref);
+
+	for (; s.p < s.end; s.record++) {
+		ClasslimitSubject *subject;
+		gboolean end_of_record = FALSE;
+		gboolean hours_ok = FALSE;
+		gboolean skips_ok = TRUE;
+		int hours = 0;
+		int skips = 0;
+		int column;
+
+		g_string_truncate (name, 0);
+		for (column = 0; !end_of_record; column++) {
+			const char *field;
+			gsize field_length;
+
+			if (!next_field (&s, &field, &field_length, &end_of_record, error))
+				return NULL;
+
+			if (column == index[0])
+				g_string_append_len (name, field, field_length);
+			if (column == index[1])
+				hours_ok = parse_int (field, field_length, &hours);
+			if (column == index[2])
+				skips_ok = field_length == 0 || parse_int (field, field_length, &skips);
+		}
+
+		g_strstrip (name->str);
+		if (name->str[0] == '\0')
+			continue;
+
+		if (!hours_ok && !has_header && s.record == 1)
+			continue;
+
+		if (!hours_ok || !skips_ok) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			             "Record %u: %s is not a whole number", s.record,
+			             hours_ok ? "current skips" : "weekly hours");
+			return NULL;
+		}
+
+		if (!g_utf8_validate (name->str, -1, NULL)) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			             "Record %u: the name is not valid UTF-8", s.record);
+			return NULL;
+		}
+
+		subject = classlimit_subject_new (name->str, hours);
+		classlimit_subject_set_current_skips (subject, skips);
+		g_ptr_array_add (subjects, subject);
+	}
+
+	return g_steal_pointer (&subjects);
+}
+
+/**
+ * classlimit_csv_load:
+ * @file: a CSV file
+ * @columns: which columns hold the name, weekly hours and skips
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for a #GError
+ *
+ * Like classlimit_csv_parse(), reading local files through a memory
+ * map so large exports are never copied. Blocks, so call it from a
+ * worker thread.
+ *
+ * Returns: (transfer full) (element-type ClasslimitSubject): the subjects,
+ *   or %NULL on error
+ */
+GPtrArray *
+classlimit_csv_load (GFile                       *file,
+                     const ClasslimitCsvColumns  *columns,
+                     GCancellable                *cancellable,
+                     GError                     **error)
+{
+	g_autoptr(GMappedFile) mapped = NULL;
+	g_autofree char *contents = NULL;
+	const char *path;
+	gsize length;
+
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+	g_return_val_if_fail (columns != NULL, NULL);
+
+	path = g_file_peek_path (file);
+	if (path != NULL) {
+		mapped = g_mapped_file_new (path, FALSE, error);
+		if (mapped == NULL)
+			return NULL;
+
+		return classlimit_csv_parse (g_mapped_file_get_contents (mapped),
+		                             g_mapped_file_get_length (mapped),
+		                             columns, error);
+	}
+
+	if (!g_file_load_contents (file, cancellable, &contents, &length, NULL, error))
+		return NULL;
+
+	return classlimit_csv_parse (contents, length, columns, error);
+}
+
+/* One "name<separator>hours" line, with line ending at its end */
+static gboolean
+parse_pasted_line (const char *line,
+                   const char *separator,
+                   const char *end,
+                   GString    *name,
+                   GPtrArray  *subjects)
+{
+	const char *name_end;
+	int weekly_hours;
+
+	if (separator == NULL || !parse_int (separator + 1, end - separator - 1, &weekly_hours) || weekly_hours <= 0)
+		return FALSE;
+
+	name_end = separator;
+	while (line < name_end && (*line == ' ' || *line == '\t'))
+		line++;
+	while (name_end > line && (name_end[-1] == ' ' || name_end[-1] == '\t'))
+		name_end--;
+	if (line == name_end)
+		return FALSE;
+
+	/* Reused for every line, so it only grows to the longest name */
+	g_string_truncate (name, 0);
+	g_string_append_len (name, line, name_end - line);
+	g_ptr_array_add (subjects, classlimit_subject_new (name->str, weekly_hours));
+
+	return TRUE;
+}
+
+/**
+ * classlimit_csv_parse_pasted:
+ * @text: pasted text
+ * @length: the length of @text, or -1 if it is nul-terminated
+ * @n_skipped: (out) (optional): return location for the number of
+ *   non-blank lines that held no subject
+ *
+ * Parses a block of "name, hours" lines as copied from a spreadsheet or
+ * a syllabus. The hours follow the last tab, semicolon or comma of the
+ * line, so names may contain the other separators. Lines without
+ * positive hours, like a header, are skipped. The text is read once,
+ * front to back, without splitting it into lines first.
+ *
+ * Returns: (transfer full) (element-type ClasslimitSubject): the subjects
+ */
+GPtrArray *
+classlimit_csv_parse_pasted (const char *text,
+                             gssize      length,
+                             guint      *n_skipped)
+{
+	g_autoptr(GString) name = NULL;
+	GPtrArray *subjects;
+	const char *p, *end, *line;
+	const char *separator = NULL;
+	gboolean blank = TRUE;
+	guint skipped = 0;
+
+	g_return_val_if_fail (text != NULL, NULL);
+
+	if (length < 0)
+		length = strlen (text);
+	end = text + length;
+
+	/* Lines are hardly ever shorter than this, so the array rarely grows */
+	subjects = g_ptr_array_new_full ((guint) MIN ((gsize) length / 8, G_MAXUINT - 1) + 1,
+	                                 (GDestroyNotify) g_object_unref);
+	name = g_string_sized_new (64);
+
+	for (p = line = text; ; p++) {
+		const char *line_end;
+
+		if (p < end && *p != '\n') {
+			if (*p == '\t' || *p == ';' || *p == ',')
+				separator = p;
+			else if (*p != ' ' && *p != '\r')
+				blank = FALSE;
+			continue;
+		}
+
+		line_end = p > line && p[-1] == '\r' ? p - 1 : p;
+		if (!parse_pasted_line (line, separator, line_end, name, subjects) && !blank)
+			skipped++;
+
+		if (p >= end)
+			break;
+		line = p + 1;
+		separator = NULL;
+		blank = TRUE;
+	}
+
+	if (n_skipped)
+		*n_skipped = skipped;
+
+	return subjects;
+}
+
+/**
+ * classlimit_csv_delimiter_is_valid:
+ * @delimiter: a field delimiter
+ *
+ * Quotes and line breaks already mean something else, and the scanners
+ * only compare single bytes.
+ *
+ * Returns: whether @delimiter can separate fields
+ */
+gboolean
+classlimit_csv_delimiter_is_valid (int delimiter)
+{
+	return delimiter > 0 && delimiter <= 127 && strchr ("\"\r\n", delimiter) == NULL;
+}
+
+static gboolean
+needs_quotes (const char *text,
+              char        delimiter)
+{
+	const char *end = text + strlen (text);
+
+	return *text == ' ' || (end > text && end[-1] == ' ') ||
+	       find_special (text, end, delimiter) != end;
+}
+
+static void
+append_int (GString *str,
+            int      value)
+{
+	char digits[16];
+	guint n = 0;
+	guint v = value < 0 ? 0 : (guint) value;
+
+	do {
+		digits[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v > 0);
+
+	while (n > 0)
+		g_string_append_c (str, digits[--n]);
+}
+
+/**
+ * classlimit_csv_export:
+ * @roster: a #ClasslimitRoster
+ * @delimiter: the field delimiter
+ * @length: (out) (optional): return location for the length
+ *
+ * Writes the subjects as CSV with a name, weekly_hours, current_skips
+ * header, which the default column mapping reads back.
+ *
+ * Returns: (transfer full): the CSV text
+ */
+char *
+classlimit_csv_export (ClasslimitRoster *roster,
+                       char              delimiter,
+                       gsize            *length)
+{
+	guint n_subjects;
+	GString *str;
+	guint i;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (roster), NULL);
+	g_return_val_if_fail (classlimit_csv_delimiter_is_valid (delimiter), NULL);
+
+	n_subjects = g_list_model_get_n_items (G_LIST_MODEL (roster));
+	str = g_string_sized_new (32 + (gsize) n_subjects * 32);
+	g_string_append_printf (str, "name%cweekly_hours%ccurrent_skips\n", delimiter, delimiter);
+
+	for (i = 0; i < n_subjects; i++) {
+		ClasslimitSubject *s = classlimit_roster_get_subject (roster, i);
+		const char *name = classlimit_subject_get_name (s);
+
+		if (needs_quotes (name, delimiter)) {
+			const char *p;
+
+			g_string_append_c (str, '"');
+			for (p = name; *p; p++) {
+				if (*p == '"')
+					g_string_append_c (str, '"');
+				g_string_append_c (str, *p);
+			}
+			g_string_append_c (str, '"');
+		} else {
+			g_string_append (str, name);
+		}
+		g_string_append_c (str, delimiter);
+		append_int (str, classlimit_subject_get_weekly_hours (s));
+		g_string_append_c (str, delimiter);
+		append_int (str, classlimit_subject_get_current_skips (s));
+		g_string_append_c (str, '\n');
+	}
+
+	if (length)
+		*length = str->len;
+
+	return g_string_free (str, FALSE);
+}
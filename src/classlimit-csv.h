@@ -0,0 +1,59 @@
+/* classlimit-csv.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "classlimit-roster.h"
+
+G_BEGIN_DECLS
+
+/* Each column is a header name, matched without regard to case, or a
+ * 1-based column number. An empty current_skips column means there is
+ * none.
+ */
+typedef struct {
+	char *name;
+	char *weekly_hours;
+	char *current_skips;
+	char  delimiter;
+} ClasslimitCsvColumns;
+
+void       classlimit_csv_columns_clear      (ClasslimitCsvColumns         *columns);
+gboolean   classlimit_csv_delimiter_is_valid (int                           delimiter);
+GPtrArray *classlimit_csv_parse             (const char                   *data,
+                                             gsize                         length,
+                                             const ClasslimitCsvColumns   *columns,
+                                             GError                      **error);
+GPtrArray *classlimit_csv_load              (GFile                        *file,
+                                             const ClasslimitCsvColumns   *columns,
+                                             GCancellable                 *cancellable,
+                                             GError                      **error);
+GPtrArray *classlimit_csv_parse_pasted      (const char                   *text,
+                                             gssize                        length,
+                                             guint                        *n_skipped);
+char      *classlimit_csv_export            (ClasslimitRoster             *roster,
+                                             char                          delimiter,
+                                             gsize                        *length);
+
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (ClasslimitCsvColumns, classlimit_csv_columns_clear)
+
+G_END_DECLS
@@ -0,0 +1,343 @@
+/* classlimit-frame-monitor.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+#include <json-glib/json-glib.h>
+
+#include "classlimit-frame-monitor.h"
+
+/* Roughly half an hour of continuous 60 Hz painting */
+#define MAX_FRAMES 100000
+#define DEFAULT_REFRESH_INTERVAL 16667
+
+typedef struct {
+	gint64      start;
+	gint64      layout_usec;
+	gint64      paint_usec;
+	gint64      total_usec;
+	guint       dropped;
+	const char *action;
+} FrameRecord;
+
+typedef struct {
+	gint64      time;
+	const char *action;
+} ActionRecord;
+
+struct _ClasslimitFrameMonitor
+{
+	GtkWidget     *widget;
+	GdkFrameClock *clock;
+	gulong         realize_id;
+	gulong         unrealize_id;
+	gulong         clock_ids[5];
+
+	/* Current frame; mark is the end of the previous phase */
+	gint64         frame_start;
+	gint64         mark;
+	gint64         layout_usec;
+	gint64         paint_usec;
+
+	const char    *action;
+	GArray        *frames;
+	GArray        *actions;
+	guint          n_frames;
+	guint          n_long;
+	guint          n_dropped;
+};
+
+static void
+on_before_paint (GdkFrameClock          *clock,
+                 ClasslimitFrameMonitor *self)
+{
+	self->frame_start = self->mark = g_get_monotonic_time ();
+	self->layout_usec = 0;
+	self->paint_usec = 0;
+}
+
+static void
+on_update (GdkFrameClock          *clock,
+           ClasslimitFrameMonitor *self)
+{
+	self->mark = g_get_monotonic_time ();
+}
+
+static void
+on_layout (GdkFrameClock          *clock,
+           ClasslimitFrameMonitor *self)
+{
+	gint64 now = g_get_monotonic_time ();
+
+	self->layout_usec = now - self->mark;
+	self->mark = now;
+}
+
+static void
+on_paint (GdkFrameClock          *clock,
+          ClasslimitFrameMonitor *self)
+{
+	gint64 now = g_get_monotonic_time ();
+
+	self->paint_usec = now - self->mark;
+	self->mark = now;
+}
+
+static void
+on_after_paint (GdkFrameClock          *clock,
+                ClasslimitFrameMonitor *self)
+{
+	FrameRecord record;
+	gint64 interval = 0;
+	gint64 presentation_time = 0;
+
+	if (self->frame_start == 0)
+		return;
+
+	gdk_frame_clock_get_refresh_info (clock, gdk_frame_clock_get_frame_time (clock),
+	                                  &interval, &presentation_time);
+	if (interval <= 0)
+		interval = DEFAULT_REFRESH_INTERVAL;
+
+	record.start = self->frame_start;
+	record.layout_usec = self->layout_usec;
+	record.paint_usec = self->paint_usec;
+	record.total_usec = g_get_monotonic_time () - self->frame_start;
+	record.dropped = record.total_usec / interval;
+	record.action = self->action;
+	self->frame_start = 0;
+
+	/* A frame that outlives the refresh interval misses at least one
+	 * vblank; counting from the frame itself keeps idle gaps between
+	 * frames from looking like drops.
+	 */
+	self->n_frames++;
+	self->n_dropped += record.dropped;
+	if (record.dropped > 0)
+		self->n_long++;
+
+	if (self->frames->len < MAX_FRAMES)
+		g_array_append_val (self->frames, record);
+}
+
+static void
+disconnect_clock (ClasslimitFrameMonitor *self)
+{
+	guint i;
+
+	if (self->clock == NULL)
+		return;
+
+	for (i = 0; i < G_N_ELEMENTS (self->clock_ids); i++)
+		g_clear_signal_handler (&self->clock_ids[i], self->clock);
+	g_clear_object (&self->clock);
+}
+
+static void
+on_widget_realize (GtkWidget              *widget,
+                   ClasslimitFrameMonitor *self)
+{
+	GdkFrameClock *clock = gtk_widget_get_frame_clock (widget);
+
+	disconnect_clock (self);
+	if (clock == NULL)
+		return;
+
+	/* GTK does its own layout and painting from handlers connected at
+	 * realize time, so ours run after them and see the finished phase.
+	 */
+	self->clock = g_object_ref (clock);
+	self->clock_ids[0] = g_signal_connect (clock, "before-paint", G_CALLBACK (on_before_paint), self);
+	self->clock_ids[1] = g_signal_connect_after (clock, "update", G_CALLBACK (on_update), self);
+	self->clock_ids[2] = g_signal_connect_after (clock, "layout", G_CALLBACK (on_layout), self);
+	self->clock_ids[3] = g_signal_connect_after (clock, "paint", G_CALLBACK (on_paint), self);
+	self->clock_ids[4] = g_signal_connect_after (clock, "after-paint", G_CALLBACK (on_after_paint), self);
+}
+
+static void
+on_widget_unrealize (GtkWidget              *widget,
+                     ClasslimitFrameMonitor *self)
+{
+	disconnect_clock (self);
+}
+
+ClasslimitFrameMonitor *
+classlimit_frame_monitor_new (GtkWidget *widget)
+{
+	ClasslimitFrameMonitor *self;
+
+	g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
+
+	self = g_new0 (ClasslimitFrameMonitor, 1);
+	self->widget = widget;
+	self->action = g_intern_static_string ("startup");
+	self->frames = g_array_new (FALSE, FALSE, sizeof (FrameRecord));
+	self->actions = g_array_new (FALSE, FALSE, sizeof (ActionRecord));
+
+	self->realize_id = g_signal_connect (widget, "realize", G_CALLBACK (on_widget_realize), self);
+	self->unrealize_id = g_signal_connect (widget, "unrealize", G_CALLBACK (on_widget_unrealize), self);
+	if (gtk_widget_get_realized (widget))
+		on_widget_realize (widget, self);
+
+	return self;
+}
+
+void
+classlimit_frame_monitor_free (ClasslimitFrameMonitor *self)
+{
+	if (self == NULL)
+		return;
+
+	disconnect_clock (self);
+	g_clear_signal_handler (&self->realize_id, self->widget);
+	g_clear_signal_handler (&self->unrealize_id, self->widget);
+	g_array_unref (self->frames);
+	g_array_unref (self->actions);
+	g_free (self);
+}
+
+void
+classlimit_frame_monitor_mark_action (ClasslimitFrameMonitor *self,
+                                      const char             *action)
+{
+	ActionRecord record;
+
+	g_return_if_fail (self != NULL);
+	g_return_if_fail (action != NULL);
+
+	record.time = g_get_monotonic_time ();
+	record.action = self->action = g_intern_string (action);
+	if (self->actions->len < MAX_FRAMES)
+		g_array_append_val (self->actions, record);
+}
+
+void
+classlimit_frame_monitor_get_summary (ClasslimitFrameMonitor *self,
+                                      guint                  *n_frames,
+                                      guint                  *n_long,
+                                      guint                  *n_dropped)
+{
+	g_return_if_fail (self != NULL);
+
+	if (n_frames)
+		*n_frames = self->n_frames;
+	if (n_long)
+		*n_long = self->n_long;
+	if (n_dropped)
+		*n_dropped = self->n_dropped;
+}
+
+static void
+add_complete_event (JsonBuilder *builder,
+                    const char  *name,
+                    gint64       ts,
+                    gint64       dur)
+{
+	json_builder_set_member_name (builder, "name");
+	json_builder_add_string_value (builder, name);
+	json_builder_set_member_name (builder, "ph");
+	json_builder_add_string_value (builder, "X");
+	json_builder_set_member_name (builder, "pid");
+	json_builder_add_int_value (builder, 1);
+	json_builder_set_member_name (builder, "tid");
+	json_builder_add_int_value (builder, 1);
+	json_builder_set_member_name (builder, "ts");
+	json_builder_add_int_value (builder, ts);
+	json_builder_set_member_name (builder, "dur");
+	json_builder_add_int_value (builder, dur);
+}
+
+/* Writes the recorded frames in the Chrome trace event format, which
+ * both Perfetto and chrome://tracing load directly.
+ */
+gboolean
+classlimit_frame_monitor_write_trace (ClasslimitFrameMonitor  *self,
+                                      const char              *path,
+                                      GError                 **error)
+{
+	g_autoptr(JsonBuilder) builder = NULL;
+	g_autoptr(JsonGenerator) gen = NULL;
+	g_autoptr(JsonNode) root = NULL;
+	guint i;
+
+	g_return_val_if_fail (self != NULL, FALSE);
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	builder = json_builder_new ();
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "traceEvents");
+	json_builder_begin_array (builder);
+
+	for (i = 0; i < self->frames->len; i++) {
+		const FrameRecord *frame = &g_array_index (self->frames, FrameRecord, i);
+
+		json_builder_begin_object (builder);
+		add_complete_event (builder, frame->dropped > 0 ? "long-frame" : "frame",
+		                    frame->start, frame->total_usec);
+		json_builder_set_member_name (builder, "args");
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "layout_us");
+		json_builder_add_int_value (builder, frame->layout_usec);
+		json_builder_set_member_name (builder, "paint_us");
+		json_builder_add_int_value (builder, frame->paint_usec);
+		json_builder_set_member_name (builder, "dropped");
+		json_builder_add_int_value (builder, frame->dropped);
+		json_builder_set_member_name (builder, "action");
+		json_builder_add_string_value (builder, frame->action);
+		json_builder_end_object (builder);
+		json_builder_end_object (builder);
+	}
+
+	for (i = 0; i < self->actions->len; i++) {
+		const ActionRecord *action = &g_array_index (self->actions, ActionRecord, i);
+
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "name");
+		json_builder_add_string_value (builder, action->action);
+		json_builder_set_member_name (builder, "ph");
+		json_builder_add_string_value (builder, "i");
+		json_builder_set_member_name (builder, "s");
+		json_builder_add_string_value (builder, "p");
+		json_builder_set_member_name (builder, "pid");
+		json_builder_add_int_value (builder, 1);
+		json_builder_set_member_name (builder, "tid");
+		json_builder_add_int_value (builder, 1);
+		json_builder_set_member_name (builder, "ts");
+		json_builder_add_int_value (builder, action->time);
+		json_builder_end_object (builder);
+	}
+
+	json_builder_end_array (builder);
+	json_builder_set_member_name (builder, "otherData");
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "frames");
+	json_builder_add_int_value (builder, self->n_frames);
+	json_builder_set_member_name (builder, "long_frames");
+	json_builder_add_int_value (builder, self->n_long);
+	json_builder_set_member_name (builder, "dropped_frames");
+	json_builder_add_int_value (builder, self->n_dropped);
+	json_builder_end_object (builder);
+	json_builder_end_object (builder);
+
+	root = json_builder_get_root (builder);
+	gen = json_generator_new ();
+	json_generator_set_root (gen, root);
+
+	return json_generator_to_file (gen, path, error);
+}
@@ -0,0 +1,43 @@
+/* classlimit-frame-monitor.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ClasslimitFrameMonitor ClasslimitFrameMonitor;
+
+ClasslimitFrameMonitor *classlimit_frame_monitor_new         (GtkWidget               *widget);
+void                    classlimit_frame_monitor_free        (ClasslimitFrameMonitor  *self);
+void                    classlimit_frame_monitor_mark_action (ClasslimitFrameMonitor  *self,
+                                                              const char              *action);
+void                    classlimit_frame_monitor_get_summary (ClasslimitFrameMonitor  *self,
+                                                              guint                   *n_frames,
+                                                              guint                   *n_long,
+                                                              guint                   *n_dropped);
+gboolean                classlimit_frame_monitor_write_trace (ClasslimitFrameMonitor  *self,
+                                                              const char              *path,
+                                                              GError                 **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ClasslimitFrameMonitor, classlimit_frame_monitor_free)
+
+G_END_DECLS
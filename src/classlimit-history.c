@@ -0,0 +1,612 @@
+/* classlimit-history.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "classlimit-history.h"
+
+/* Skip counts and remaining allowances over time, per subject and in
+ * total. Every change is appended to a plain text log as it happens,
+ * one line per sample:
+ *
+ *   <unix time in µs> TAB <skips> TAB <remaining> TAB <subject name>
+ *
+ * with an empty name for the aggregate series, so the file only ever
+ * grows and a crash loses at most the line being written. Control
+ * characters in names become spaces, so a name is always one field.
+ */
+
+#define HISTORY_HEADER "# classlimit-history 1\n"
+
+typedef struct {
+	char   *name;
+	GArray *samples;
+
+	/* Current totals over the subjects of this name, kept up to date
+	 * as they change rather than summed again for every sample.
+	 */
+	guint   n_subjects;
+	int     skips;
+	int     remaining;
+
+	/* Marks the series as touched since the last record() */
+	guint   generation;
+} Series;
+
+/* What a roster position last contributed to its series */
+typedef struct {
+	guint series;
+	int   skips;
+	int   remaining;
+} Tracked;
+
+#define UNTRACKED G_MAXUINT
+
+struct _ClasslimitHistory
+{
+	GObject            parent_instance;
+
+	GPtrArray         *series;
+	GHashTable        *by_name;
+	GOutputStream     *stream;
+
+	ClasslimitRoster  *roster;
+	guint              generation;
+
+	/* One entry per subject, in roster order, and the positions that
+	 * changed since the last record(), as a range [dirty_start, dirty_end)
+	 */
+	GArray            *tracked;
+	guint              dirty_start;
+	guint              dirty_end;
+	GArray            *touched;
+};
+
+G_DEFINE_FINAL_TYPE (ClasslimitHistory, classlimit_history, G_TYPE_OBJECT)
+
+enum {
+	APPENDED,
+	N_SIGNALS
+};
+
+static guint signals [N_SIGNALS];
+
+static void
+series_free (Series *series)
+{
+	g_free (series->name);
+	g_array_unref (series->samples);
+	g_free (series);
+}
+
+static guint
+ensure_series (ClasslimitHistory *self,
+               const char        *name)
+{
+	gpointer index;
+	Series *series;
+
+	if (g_hash_table_lookup_extended (self->by_name, name, NULL, &index))
+		return GPOINTER_TO_UINT (index);
+
+	series = g_new0 (Series, 1);
+	series->name = g_strdup (name);
+	series->samples = g_array_new (FALSE, FALSE, sizeof (ClasslimitHistorySample));
+	g_ptr_array_add (self->series, series);
+	g_hash_table_insert (self->by_name, series->name, GUINT_TO_POINTER (self->series->len - 1));
+
+	return self->series->len - 1;
+}
+
+static const ClasslimitHistorySample *
+last_sample (Series *series)
+{
+	if (series->samples->len == 0)
+		return NULL;
+
+	return &g_array_index (series->samples, ClasslimitHistorySample, series->samples->len - 1);
+}
+
+static void
+parse_line (ClasslimitHistory *self,
+            const char        *line,
+            const char        *end)
+{
+	ClasslimitHistorySample sample;
+	g_autofree char *copy = g_strndup (line, end - line);
+	char *p = copy;
+	Series *series;
+
+	if (*p == '#' || *p == '\0')
+		return;
+
+	sample.time = g_ascii_strtoll (p, &p, 10);
+	if (*p++ != '\t')
+		return;
+	sample.skips = (int) g_ascii_strtoll (p, &p, 10);
+	if (*p++ != '\t')
+		return;
+	sample.remaining = (int) g_ascii_strtoll (p, &p, 10);
+	if (*p++ != '\t')
+		return;
+
+	series = g_ptr_array_index (self->series, ensure_series (self, p));
+	if (series->samples->len > 0)
+		sample.time = MAX (sample.time, last_sample (series)->time);
+	g_array_append_val (series->samples, sample);
+}
+
+/* The series key for a subject, with control characters replaced so
+ * the name stays one field of one log line
+ */
+static const char *
+series_name (const char  *name,
+             char       **copy)
+{
+	const char *p;
+	char *q;
+
+	for (p = name; *p; p++) {
+		if ((guchar) *p < 0x20 || *p == 0x7f)
+			break;
+	}
+	if (*p == '\0')
+		return name;
+
+	*copy = g_strdup (name);
+	for (q = *copy + (p - name); *q; q++) {
+		if ((guchar) *q < 0x20 || *q == 0x7f)
+			*q = ' ';
+	}
+
+	return *copy;
+}
+
+static int
+compare_indices (gconstpointer a,
+                 gconstpointer b)
+{
+	guint ia = *(const guint *) a;
+	guint ib = *(const guint *) b;
+
+	return (ia > ib) - (ia < ib);
+}
+
+static void
+touch (ClasslimitHistory *self,
+       guint              index)
+{
+	Series *series = g_ptr_array_index (self->series, index);
+
+	if (series->generation != self->generation) {
+		series->generation = self->generation;
+		g_array_append_val (self->touched, index);
+	}
+}
+
+static void
+add_tracked (ClasslimitHistory *self,
+             const Tracked     *tracked,
+             int                sign)
+{
+	Series *aggregate = g_ptr_array_index (self->series, CLASSLIMIT_HISTORY_AGGREGATE);
+	Series *series = g_ptr_array_index (self->series, tracked->series);
+
+	series->n_subjects += sign;
+	series->skips += sign * tracked->skips;
+	series->remaining += sign * tracked->remaining;
+	aggregate->skips += sign * tracked->skips;
+	aggregate->remaining += sign * tracked->remaining;
+	touch (self, tracked->series);
+}
+
+static void
+mark_dirty (ClasslimitHistory *self,
+            guint              start,
+            guint              end)
+{
+	if (self->dirty_start == self->dirty_end) {
+		self->dirty_start = start;
+		self->dirty_end = end;
+	} else {
+		self->dirty_start = MIN (self->dirty_start, start);
+		self->dirty_end = MAX (self->dirty_end, end);
+	}
+}
+
+/* Where an old position ends up after a splice; removed ones collapse
+ * onto its start.
+ */
+static guint
+map_position (guint pos,
+              guint position,
+              guint removed,
+              guint added)
+{
+	if (pos <= position)
+		return pos;
+	if (pos >= position + removed)
+		return pos - removed + added;
+	return position;
+}
+
+static void
+on_items_changed (ClasslimitHistory *self,
+                  guint              position,
+                  guint              removed,
+                  guint              added,
+                  GListModel        *model)
+{
+	guint i;
+
+	/* A missed change shows as a length mismatch and is caught up on
+	 * in record()
+	 */
+	if (position + removed > self->tracked->len)
+		return;
+
+	for (i = position; i < position + removed; i++) {
+		Tracked *tracked = &g_array_index (self->tracked, Tracked, i);
+
+		if (tracked->series != UNTRACKED)
+			add_tracked (self, tracked, -1);
+	}
+
+	if (removed != added) {
+		guint tail = self->tracked->len - position - removed;
+
+		if (added > removed)
+			g_array_set_size (self->tracked, self->tracked->len + added - removed);
+		memmove (&g_array_index (self->tracked, Tracked, position + added),
+		         &g_array_index (self->tracked, Tracked, position + removed),
+		         tail * sizeof (Tracked));
+		if (removed > added)
+			g_array_set_size (self->tracked, self->tracked->len - removed + added);
+	}
+	for (i = position; i < position + added; i++)
+		g_array_index (self->tracked, Tracked, i).series = UNTRACKED;
+
+	if (self->dirty_start != self->dirty_end) {
+		self->dirty_start = map_position (self->dirty_start, position, removed, added);
+		self->dirty_end = map_position (self->dirty_end, position, removed, added);
+	}
+	if (added > 0)
+		mark_dirty (self, position, position + added);
+}
+
+/* Forgets every contribution and marks the whole roster dirty */
+static void
+resync (ClasslimitHistory *self,
+        guint              n_items)
+{
+	guint i;
+
+	for (i = 0; i < self->series->len; i++) {
+		Series *series = g_ptr_array_index (self->series, i);
+
+		series->n_subjects = 0;
+		series->skips = 0;
+		series->remaining = 0;
+		touch (self, i);
+	}
+
+	g_array_set_size (self->tracked, n_items);
+	for (i = 0; i < n_items; i++)
+		g_array_index (self->tracked, Tracked, i).series = UNTRACKED;
+	self->dirty_start = 0;
+	self->dirty_end = n_items;
+}
+
+/* Reads back the subjects that changed since the last call, updates
+ * their series and appends a sample to each touched series whose
+ * values moved, writing the whole batch at once.
+ */
+static void
+record (ClasslimitHistory *self)
+{
+	g_autoptr(GString) batch = g_string_new (NULL);
+	g_autoptr(GArray) appended = g_array_new (FALSE, FALSE, sizeof (guint));
+	g_autoptr(GError) error = NULL;
+	gint64 now = g_get_real_time ();
+	guint n_items;
+	guint i;
+
+	n_items = g_list_model_get_n_items (G_LIST_MODEL (self->roster));
+	if (n_items != self->tracked->len)
+		resync (self, n_items);
+
+	for (i = self->dirty_start; i < self->dirty_end; i++) {
+		ClasslimitSubject *subject = classlimit_roster_get_subject (self->roster, i);
+		Tracked *tracked = &g_array_index (self->tracked, Tracked, i);
+		g_autofree char *copy = NULL;
+		Tracked now_tracked;
+
+		now_tracked.series = ensure_series (self, series_name (classlimit_subject_get_name (subject), &copy));
+		now_tracked.skips = classlimit_subject_get_current_skips (subject);
+
+		/* Until the next calculation the last known allowance stands */
+		if (classlimit_subject_get_results_valid (subject) || tracked->series == UNTRACKED)
+			now_tracked.remaining = classlimit_subject_get_remaining (subject);
+		else
+			now_tracked.remaining = tracked->remaining;
+
+		if (tracked->series != UNTRACKED)
+			add_tracked (self, tracked, -1);
+		*tracked = now_tracked;
+		add_tracked (self, tracked, 1);
+	}
+	self->dirty_start = self->dirty_end = 0;
+
+	touch (self, CLASSLIMIT_HISTORY_AGGREGATE);
+	for (i = 0; i < self->touched->len; i++) {
+		guint index = g_array_index (self->touched, guint, i);
+		Series *series = g_ptr_array_index (self->series, index);
+		const ClasslimitHistorySample *last = last_sample (series);
+		ClasslimitHistorySample sample = { now, series->skips, series->remaining };
+
+		/* A name no subject has any more just ends */
+		if (index != CLASSLIMIT_HISTORY_AGGREGATE && series->n_subjects == 0)
+			continue;
+		if (last && last->skips == sample.skips && last->remaining == sample.remaining)
+			continue;
+
+		/* Keep each series sorted even if the wall clock steps back */
+		if (last && sample.time < last->time)
+			sample.time = last->time;
+
+		g_array_append_val (series->samples, sample);
+		g_array_append_val (appended, index);
+		g_string_append_printf (batch, "%" G_GINT64_FORMAT "\t%d\t%d\t%s\n",
+		                        sample.time, sample.skips, sample.remaining, series->name);
+	}
+	g_array_set_size (self->touched, 0);
+	self->generation++;
+
+	if (self->stream && batch->len > 0 &&
+	    !g_output_stream_write_all (self->stream, batch->str, batch->len, NULL, NULL, &error))
+		g_warning ("Failed to append to attendance history: %s", error->message);
+
+	/* Emitted in series order, as listeners have always seen them */
+	g_array_sort (appended, compare_indices);
+	for (i = 0; i < appended->len; i++)
+		g_signal_emit (self, signals [APPENDED], 0, g_array_index (appended, guint, i));
+}
+
+static void
+classlimit_history_dispose (GObject *object)
+{
+	ClasslimitHistory *self = CLASSLIMIT_HISTORY (object);
+
+	if (self->roster) {
+		g_signal_handlers_disconnect_by_data (self->roster, self);
+		g_clear_object (&self->roster);
+	}
+	if (self->stream)
+		g_output_stream_close (self->stream, NULL, NULL);
+	g_clear_object (&self->stream);
+
+	G_OBJECT_CLASS (classlimit_history_parent_class)->dispose (object);
+}
+
+static void
+classlimit_history_finalize (GObject *object)
+{
+	ClasslimitHistory *self = CLASSLIMIT_HISTORY (object);
+
+	g_clear_pointer (&self->by_name, g_hash_table_unref);
+	g_clear_pointer (&self->series, g_ptr_array_unref);
+	g_clear_pointer (&self->tracked, g_array_unref);
+	g_clear_pointer (&self->touched, g_array_unref);
+
+	G_OBJECT_CLASS (classlimit_history_parent_class)->finalize (object);
+}
+
+static void
+classlimit_history_class_init (ClasslimitHistoryClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = classlimit_history_dispose;
+	object_class->finalize = classlimit_history_finalize;
+
+	/**
+	 * ClasslimitHistory::appended:
+	 * @series: the series that grew
+	 *
+	 * Emitted after a sample was added to the end of @series. Series
+	 * only ever grow, so listeners can pick up from where they left off.
+	 */
+	signals [APPENDED] =
+		g_signal_new ("appended",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 1, G_TYPE_UINT);
+}
+
+static void
+classlimit_history_init (ClasslimitHistory *self)
+{
+	self->series = g_ptr_array_new_with_free_func ((GDestroyNotify) series_free);
+	self->by_name = g_hash_table_new (g_str_hash, g_str_equal);
+	self->tracked = g_array_new (FALSE, FALSE, sizeof (Tracked));
+	self->touched = g_array_new (FALSE, FALSE, sizeof (guint));
+	/* New series start at 0, which must not read as touched */
+	self->generation = 1;
+
+	ensure_series (self, "");
+}
+
+ClasslimitHistory *
+classlimit_history_new (void)
+{
+	return g_object_new (CLASSLIMIT_TYPE_HISTORY, NULL);
+}
+
+char *
+classlimit_history_get_default_path (void)
+{
+	return g_build_filename (g_get_user_data_dir (), "classlimit", "history", NULL);
+}
+
+/**
+ * classlimit_history_load:
+ * @self: a #ClasslimitHistory
+ * @path: the history log
+ * @error: return location for a #GError
+ *
+ * Reads the samples already in @path, which need not exist yet, and
+ * keeps it open so later samples are appended to it.
+ *
+ * Returns: %TRUE if the log could be read and opened
+ */
+gboolean
+classlimit_history_load (ClasslimitHistory  *self,
+                         const char         *path,
+                         GError            **error)
+{
+	g_autoptr(GMappedFile) mapped = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GError) local_error = NULL;
+	g_autofree char *dir = NULL;
+	GFileOutputStream *stream;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_HISTORY (self), FALSE);
+	g_return_val_if_fail (path != NULL, FALSE);
+	g_return_val_if_fail (self->stream == NULL, FALSE);
+
+	mapped = g_mapped_file_new (path, FALSE, &local_error);
+	if (mapped) {
+		const char *line = g_mapped_file_get_contents (mapped);
+		const char *end = line + g_mapped_file_get_length (mapped);
+
+		while (line < end) {
+			const char *eol = memchr (line, '\n', end - line);
+
+			/* A torn last line is dropped, not misread */
+			if (eol == NULL)
+				break;
+			parse_line (self, line, eol);
+			line = eol + 1;
+		}
+	} else if (!g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+		g_propagate_error (error, g_steal_pointer (&local_error));
+		return FALSE;
+	}
+
+	dir = g_path_get_dirname (path);
+	if (g_mkdir_with_parents (dir, 0700) != 0) {
+		int saved_errno = errno;
+
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+		             "Could not create %s: %s", dir, g_strerror (saved_errno));
+		return FALSE;
+	}
+
+	file = g_file_new_for_path (path);
+	stream = g_file_append_to (file, G_FILE_CREATE_PRIVATE, NULL, error);
+	if (stream == NULL)
+		return FALSE;
+	self->stream = G_OUTPUT_STREAM (stream);
+
+	if (mapped == NULL)
+		return g_output_stream_write_all (self->stream, HISTORY_HEADER,
+		                                  strlen (HISTORY_HEADER), NULL, NULL, error);
+
+	return TRUE;
+}
+
+/**
+ * classlimit_history_track:
+ * @self: a #ClasslimitHistory
+ * @roster: the roster to follow
+ *
+ * Records the current state of @roster and a new sample whenever a
+ * change or calculation moves a subject's skips or allowance. Changes
+ * made inside one roster transaction land as a single batch, and only
+ * the subjects the roster reported as changed are read back.
+ */
+void
+classlimit_history_track (ClasslimitHistory *self,
+                          ClasslimitRoster  *roster)
+{
+	g_return_if_fail (CLASSLIMIT_IS_HISTORY (self));
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (roster));
+
+	if (self->roster == roster)
+		return;
+
+	if (self->roster)
+		g_signal_handlers_disconnect_by_data (self->roster, self);
+	g_set_object (&self->roster, roster);
+
+	g_signal_connect_object (roster, "items-changed", G_CALLBACK (on_items_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object (roster, "changed", G_CALLBACK (record), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object (roster, "calculated", G_CALLBACK (record), self, G_CONNECT_SWAPPED);
+	resync (self, g_list_model_get_n_items (G_LIST_MODEL (roster)));
+	record (self);
+}
+
+guint
+classlimit_history_get_n_series (ClasslimitHistory *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_HISTORY (self), 0);
+
+	return self->series->len;
+}
+
+const char *
+classlimit_history_get_series_name (ClasslimitHistory *self,
+                                    guint              series)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_HISTORY (self), NULL);
+	g_return_val_if_fail (series < self->series->len, NULL);
+
+	return ((Series *) g_ptr_array_index (self->series, series))->name;
+}
+
+/**
+ * classlimit_history_get_samples:
+ * @self: a #ClasslimitHistory
+ * @series: a series index
+ * @n_samples: (out): return location for the number of samples
+ *
+ * Returns: (transfer none) (array length=n_samples): the samples of
+ *   @series in time order, valid until the next change to the roster
+ */
+const ClasslimitHistorySample *
+classlimit_history_get_samples (ClasslimitHistory *self,
+                                guint              series,
+                                guint             *n_samples)
+{
+	GArray *samples;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_HISTORY (self), NULL);
+	g_return_val_if_fail (series < self->series->len, NULL);
+	g_return_val_if_fail (n_samples != NULL, NULL);
+
+	samples = ((Series *) g_ptr_array_index (self->series, series))->samples;
+	*n_samples = samples->len;
+
+	return (const ClasslimitHistorySample *) (gpointer) samples->data;
+}
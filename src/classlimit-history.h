@@ -0,0 +1,58 @@
+/* classlimit-history.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "classlimit-roster.h"
+
+G_BEGIN_DECLS
+
+#define CLASSLIMIT_TYPE_HISTORY (classlimit_history_get_type())
+
+G_DECLARE_FINAL_TYPE (ClasslimitHistory, classlimit_history, CLASSLIMIT, HISTORY, GObject)
+
+/* Series 0 is the sum over all subjects, the rest follow subject names
+ * in order of first appearance.
+ */
+#define CLASSLIMIT_HISTORY_AGGREGATE 0
+
+typedef struct {
+	gint64 time;
+	int    skips;
+	int    remaining;
+} ClasslimitHistorySample;
+
+ClasslimitHistory             *classlimit_history_new              (void);
+char                          *classlimit_history_get_default_path (void);
+gboolean                       classlimit_history_load             (ClasslimitHistory  *self,
+                                                                    const char         *path,
+                                                                    GError            **error);
+void                           classlimit_history_track            (ClasslimitHistory  *self,
+                                                                    ClasslimitRoster   *roster);
+guint                          classlimit_history_get_n_series     (ClasslimitHistory  *self);
+const char                    *classlimit_history_get_series_name  (ClasslimitHistory  *self,
+                                                                    guint               series);
+const ClasslimitHistorySample *classlimit_history_get_samples      (ClasslimitHistory  *self,
+                                                                    guint               series,
+                                                                    guint              *n_samples);
+
+G_END_DECLS
@@ -0,0 +1,506 @@
+/* classlimit-importer.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "classlimit-importer.h"
+#include "classlimit-profiler.h"
+
+/* Directory entries asked of the enumerator at a time */
+#define ENUMERATE_BATCH 32
+
+/* Enumeration pauses once this many files per worker are waiting to
+ * be parsed or merged, so a huge folder never queues up all at once.
+ */
+#define PENDING_PER_THREAD 4
+
+/* Merges land in the roster as they arrive, but are written to the
+ * settings at most this often, and once more at the end.
+ */
+#define SAVE_INTERVAL_MS 1000
+
+typedef struct {
+	GFile     *file;
+	GPtrArray *subjects;
+	GError    *error;
+} Job;
+
+struct _ClasslimitImporter
+{
+	GObject          parent_instance;
+
+	ClasslimitRoster *roster;
+	GFile           *folder;
+
+	/* Only touched on the main context */
+	GTask           *task;
+	GFileEnumerator *enumerator;
+	GThreadPool     *pool;
+	guint            max_pending;
+	guint            n_pending;
+	gboolean         enumerating;
+	gboolean         enumerated;
+	GError          *enumerate_error;
+	gint64           begin;
+	gint64           last_save;
+	guint            n_files;
+	guint            n_done;
+	guint            n_subjects;
+	GPtrArray       *errors;
+
+	/* Shared with the workers */
+	GMainContext    *context;
+	GCancellable    *cancellable;
+	GAsyncQueue     *done;
+	gint             drain_scheduled;
+};
+
+G_DEFINE_FINAL_TYPE (ClasslimitImporter, classlimit_importer, G_TYPE_OBJECT)
+
+enum {
+	PROGRESS,
+	N_SIGNALS
+};
+
+static guint signals [N_SIGNALS];
+
+static void request_more (ClasslimitImporter *self);
+
+static void
+job_free (Job *job)
+{
+	g_clear_object (&job->file);
+	g_clear_pointer (&job->subjects, g_ptr_array_unref);
+	g_clear_error (&job->error);
+	g_free (job);
+}
+
+static void
+classlimit_importer_finalize (GObject *object)
+{
+	ClasslimitImporter *self = (ClasslimitImporter *)object;
+
+	g_assert (self->task == NULL);
+
+	g_clear_object (&self->roster);
+	g_clear_object (&self->folder);
+	g_clear_object (&self->enumerator);
+	g_clear_error (&self->enumerate_error);
+	g_clear_pointer (&self->errors, g_ptr_array_unref);
+	g_clear_pointer (&self->context, g_main_context_unref);
+	g_clear_object (&self->cancellable);
+	g_clear_pointer (&self->done, g_async_queue_unref);
+
+	G_OBJECT_CLASS (classlimit_importer_parent_class)->finalize (object);
+}
+
+static void
+classlimit_importer_class_init (ClasslimitImporterClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = classlimit_importer_finalize;
+
+	/**
+	 * ClasslimitImporter::progress:
+	 *
+	 * Emitted whenever more files were found or merged.
+	 */
+	signals [PROGRESS] =
+		g_signal_new ("progress",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 0);
+}
+
+static void
+classlimit_importer_init (ClasslimitImporter *self)
+{
+	self->errors = g_ptr_array_new_with_free_func (g_free);
+	self->done = g_async_queue_new_full ((GDestroyNotify) job_free);
+}
+
+/**
+ * classlimit_importer_new:
+ * @roster: the roster to import into
+ * @folder: a folder of exported rosters
+ *
+ * Creates an importer that appends the subjects of every `.json` file
+ * in @folder to @roster.
+ *
+ * Returns: (transfer full): a new #ClasslimitImporter
+ */
+ClasslimitImporter *
+classlimit_importer_new (ClasslimitRoster *roster,
+                         GFile            *folder)
+{
+	ClasslimitImporter *self;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (roster), NULL);
+	g_return_val_if_fail (G_IS_FILE (folder), NULL);
+
+	self = g_object_new (CLASSLIMIT_TYPE_IMPORTER, NULL);
+	self->roster = g_object_ref (roster);
+	self->folder = g_object_ref (folder);
+
+	return self;
+}
+
+guint
+classlimit_importer_get_n_files (ClasslimitImporter *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_IMPORTER (self), 0);
+
+	return self->n_files;
+}
+
+guint
+classlimit_importer_get_n_done (ClasslimitImporter *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_IMPORTER (self), 0);
+
+	return self->n_done;
+}
+
+guint
+classlimit_importer_get_n_subjects (ClasslimitImporter *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_IMPORTER (self), 0);
+
+	return self->n_subjects;
+}
+
+/* Whether n_files is final */
+gboolean
+classlimit_importer_is_enumerated (ClasslimitImporter *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_IMPORTER (self), FALSE);
+
+	return self->enumerated;
+}
+
+/**
+ * classlimit_importer_get_errors:
+ * @self: a #ClasslimitImporter
+ *
+ * Gets one message per file that could not be imported.
+ *
+ * Returns: (transfer none) (element-type utf8): the messages
+ */
+GPtrArray *
+classlimit_importer_get_errors (ClasslimitImporter *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_IMPORTER (self), NULL);
+
+	return self->errors;
+}
+
+static void
+maybe_finish (ClasslimitImporter *self)
+{
+	g_autoptr(GTask) task = NULL;
+	GError *error = NULL;
+
+	if (self->task == NULL || !self->enumerated || self->enumerating || self->n_pending > 0)
+		return;
+
+	task = g_steal_pointer (&self->task);
+
+	/* Every job has been merged, so the workers are idle */
+	g_thread_pool_free (g_steal_pointer (&self->pool), FALSE, TRUE);
+	if (self->enumerator)
+		g_file_enumerator_close_async (self->enumerator, G_PRIORITY_DEFAULT, NULL, NULL, NULL);
+
+	classlimit_roster_release_saves (self->roster);
+	classlimit_profiler_end (CLASSLIMIT_PROBE_IMPORT, self->begin, self->n_subjects);
+
+	if (g_cancellable_set_error_if_cancelled (self->cancellable, &error))
+		g_task_return_error (task, error);
+	else if (self->enumerate_error)
+		g_task_return_error (task, g_steal_pointer (&self->enumerate_error));
+	else
+		g_task_return_boolean (task, TRUE);
+}
+
+/* Runs on the main context, merging whatever the workers finished since
+ * the last run in the order it arrived, as one splice.
+ */
+static gboolean
+drain (gpointer user_data)
+{
+	ClasslimitImporter *self = CLASSLIMIT_IMPORTER (user_data);
+	g_autoptr(GPtrArray) jobs = g_ptr_array_new_with_free_func ((GDestroyNotify) job_free);
+	g_autoptr(GPtrArray) merged = g_ptr_array_new ();
+	gboolean cancelled = g_cancellable_is_cancelled (self->cancellable);
+	Job *job;
+	guint i;
+
+	/* Reset first; a job pushed after this schedules another drain */
+	g_atomic_int_set (&self->drain_scheduled, FALSE);
+	while ((job = g_async_queue_try_pop (self->done)))
+		g_ptr_array_add (jobs, job);
+
+	for (i = 0; i < jobs->len; i++) {
+		job = g_ptr_array_index (jobs, i);
+
+		self->n_done++;
+		self->n_pending--;
+
+		if (job->error) {
+			g_autofree char *name = g_file_get_basename (job->file);
+
+			if (!g_error_matches (job->error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+				g_ptr_array_add (self->errors, g_strdup_printf ("%s: %s", name, job->error->message));
+		} else if (!cancelled) {
+			g_ptr_array_extend (merged, job->subjects, NULL, NULL);
+			self->n_subjects += job->subjects->len;
+		}
+	}
+
+	/* A transaction per merge, never across the whole import, so edits
+	 * made meanwhile are announced as usual. Saves are held until the
+	 * import finishes, apart from one every SAVE_INTERVAL_MS.
+	 */
+	if (merged->len > 0) {
+		gint64 now;
+
+		classlimit_roster_begin (self->roster);
+		classlimit_roster_append_many (self->roster, (ClasslimitSubject **) merged->pdata, merged->len);
+		classlimit_roster_commit (self->roster);
+
+		now = g_get_monotonic_time ();
+		if (now - self->last_save >= SAVE_INTERVAL_MS * G_TIME_SPAN_MILLISECOND) {
+			classlimit_roster_flush (self->roster);
+			self->last_save = now;
+		}
+	}
+
+	g_signal_emit (self, signals [PROGRESS], 0);
+	request_more (self);
+	maybe_finish (self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Worker thread: read and parse one file, then hand it back */
+static void
+parse_job (gpointer data,
+           gpointer user_data)
+{
+	ClasslimitImporter *self = CLASSLIMIT_IMPORTER (user_data);
+	Job *job = data;
+	g_autofree char *contents = NULL;
+	gsize length;
+
+	if (g_file_load_contents (job->file, self->cancellable, &contents, &length, NULL, &job->error))
+		job->subjects = classlimit_roster_parse_json (contents, length, &job->error);
+
+	g_async_queue_push (self->done, job);
+	if (g_atomic_int_compare_and_exchange (&self->drain_scheduled, FALSE, TRUE))
+		g_main_context_invoke_full (self->context, G_PRIORITY_DEFAULT,
+		                            drain, g_object_ref (self), g_object_unref);
+}
+
+static gboolean
+is_roster_file (GFileInfo *info)
+{
+	const char *name = g_file_info_get_name (info);
+	gsize length = strlen (name);
+
+	return g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR &&
+	       length > 5 && g_ascii_strcasecmp (name + length - 5, ".json") == 0;
+}
+
+static void
+on_next_files (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+	g_autoptr(ClasslimitImporter) self = CLASSLIMIT_IMPORTER (user_data);
+	g_autoptr(GError) error = NULL;
+	GList *infos;
+	GList *l;
+
+	self->enumerating = FALSE;
+	infos = g_file_enumerator_next_files_finish (G_FILE_ENUMERATOR (source), result, &error);
+
+	if (error) {
+		/* Keep what was found so far, but say the listing stopped short */
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_ptr_array_add (self->errors, g_strdup (error->message));
+		self->enumerated = TRUE;
+	} else if (infos == NULL) {
+		self->enumerated = TRUE;
+	}
+
+	for (l = infos; l != NULL; l = l->next) {
+		Job *job;
+
+		if (!is_roster_file (l->data))
+			continue;
+
+		job = g_new0 (Job, 1);
+		job->file = g_file_enumerator_get_child (self->enumerator, l->data);
+		self->n_files++;
+		self->n_pending++;
+		g_thread_pool_push (self->pool, job, NULL);
+	}
+	g_list_free_full (infos, g_object_unref);
+
+	g_signal_emit (self, signals [PROGRESS], 0);
+	request_more (self);
+	maybe_finish (self);
+}
+
+/* Backpressure: only list more of the folder while the workers and the
+ * merge keep up.
+ */
+static void
+request_more (ClasslimitImporter *self)
+{
+	if (self->enumerator == NULL || self->enumerating || self->enumerated)
+		return;
+
+	if (g_cancellable_is_cancelled (self->cancellable)) {
+		self->enumerated = TRUE;
+		return;
+	}
+
+	if (self->n_pending >= self->max_pending)
+		return;
+
+	self->enumerating = TRUE;
+	g_file_enumerator_next_files_async (self->enumerator, ENUMERATE_BATCH, G_PRIORITY_DEFAULT,
+	                                    self->cancellable, on_next_files, g_object_ref (self));
+}
+
+static void
+on_enumerated (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+	g_autoptr(ClasslimitImporter) self = CLASSLIMIT_IMPORTER (user_data);
+
+	self->enumerating = FALSE;
+	self->enumerator = g_file_enumerate_children_finish (G_FILE (source), result, &self->enumerate_error);
+	if (self->enumerator == NULL)
+		self->enumerated = TRUE;
+
+	request_more (self);
+	maybe_finish (self);
+}
+
+/**
+ * classlimit_importer_run_async:
+ * @self: a #ClasslimitImporter
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when every file has been merged or has failed
+ * @user_data: data for @callback
+ *
+ * Lists the folder in batches and parses files on a pool of one worker
+ * per core. Parsed files are merged on the calling thread's main
+ * context as they arrive, each batch as one roster transaction. The
+ * roster is saved at most once a second while that goes on, and once
+ * when it is done. Files that fail to load or parse are collected in classlimit_importer_get_errors() and do not stop
+ * the import.
+ */
+void
+classlimit_importer_run_async (ClasslimitImporter  *self,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+	guint n_threads = MAX (g_get_num_processors (), 1);
+
+	g_return_if_fail (CLASSLIMIT_IS_IMPORTER (self));
+	g_return_if_fail (self->task == NULL && self->pool == NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	self->task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (self->task, classlimit_importer_run_async);
+
+	self->context = g_main_context_ref_thread_default ();
+	self->cancellable = cancellable ? g_object_ref (cancellable) : g_cancellable_new ();
+	self->pool = g_thread_pool_new (parse_job, self, n_threads, FALSE, NULL);
+	self->max_pending = n_threads * PENDING_PER_THREAD;
+	self->begin = classlimit_profiler_begin ();
+	self->last_save = g_get_monotonic_time ();
+	classlimit_roster_hold_saves (self->roster);
+
+	self->enumerating = TRUE;
+	g_file_enumerate_children_async (self->folder,
+	                                 G_FILE_ATTRIBUTE_STANDARD_NAME ","
+	                                 G_FILE_ATTRIBUTE_STANDARD_TYPE,
+	                                 G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT,
+	                                 self->cancellable, on_enumerated, g_object_ref (self));
+}
+
+gboolean
+classlimit_importer_run_finish (ClasslimitImporter  *self,
+                                GAsyncResult        *result,
+                                GError             **error)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_IMPORTER (self), FALSE);
+	g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+on_run_done (GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+	GAsyncResult **out = user_data;
+
+	*out = g_object_ref (result);
+}
+
+/**
+ * classlimit_importer_run:
+ * @self: a #ClasslimitImporter
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for a #GError
+ *
+ * Like classlimit_importer_run_async(), but blocks until the import is
+ * done, merging on a private main context. Used when replaying
+ * recorded folder imports.
+ *
+ * Returns: %TRUE if the folder could be listed
+ */
+gboolean
+classlimit_importer_run (ClasslimitImporter  *self,
+                         GCancellable        *cancellable,
+                         GError             **error)
+{
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GAsyncResult) result = NULL;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_IMPORTER (self), FALSE);
+
+	g_main_context_push_thread_default (context);
+	classlimit_importer_run_async (self, cancellable, on_run_done, &result);
+	while (result == NULL)
+		g_main_context_iteration (context, TRUE);
+	g_main_context_pop_thread_default (context);
+
+	return classlimit_importer_run_finish (self, result, error);
+}
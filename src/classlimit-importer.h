@@ -0,0 +1,51 @@
+/* classlimit-importer.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "classlimit-roster.h"
+
+G_BEGIN_DECLS
+
+#define CLASSLIMIT_TYPE_IMPORTER (classlimit_importer_get_type())
+
+G_DECLARE_FINAL_TYPE (ClasslimitImporter, classlimit_importer, CLASSLIMIT, IMPORTER, GObject)
+
+ClasslimitImporter *classlimit_importer_new            (ClasslimitRoster    *roster,
+                                                        GFile               *folder);
+guint               classlimit_importer_get_n_files    (ClasslimitImporter  *self);
+guint               classlimit_importer_get_n_done     (ClasslimitImporter  *self);
+guint               classlimit_importer_get_n_subjects (ClasslimitImporter  *self);
+gboolean            classlimit_importer_is_enumerated  (ClasslimitImporter  *self);
+GPtrArray          *classlimit_importer_get_errors     (ClasslimitImporter  *self);
+void                classlimit_importer_run_async      (ClasslimitImporter  *self,
+                                                        GCancellable        *cancellable,
+                                                        GAsyncReadyCallback  callback,
+                                                        gpointer             user_data);
+gboolean            classlimit_importer_run_finish     (ClasslimitImporter  *self,
+                                                        GAsyncResult        *result,
+                                                        GError             **error);
+gboolean            classlimit_importer_run            (ClasslimitImporter  *self,
+                                                        GCancellable        *cancellable,
+                                                        GError             **error);
+
+G_END_DECLS
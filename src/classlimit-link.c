@@ -0,0 +1,465 @@
+/* classlimit-link.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "classlimit-link.h"
+
+/* Editors tend to save in several steps (truncate, write, rename), so
+ * the file is only read again once it has been quiet for a moment.
+ */
+#define RELOAD_DELAY_MS 250
+
+/* Roster changes are written back at most this often */
+#define WRITE_DELAY_MS 500
+
+#define QUERY_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+typedef struct {
+	guint64 mtime;
+	goffset size;
+} Stamp;
+
+typedef struct {
+	/* What the file held when the reload started */
+	char     *known_hash;
+	Stamp     known;
+	guint     n_writes;
+
+	/* What it holds now */
+	char     *hash;
+	Stamp     stamp;
+	GVariant *records;
+	int       required_attendance;
+	int       total_weeks;
+	int       session_hours;
+} Reload;
+
+struct _ClasslimitLink
+{
+	GObject           parent_instance;
+
+	ClasslimitRoster *roster;
+	GFile            *file;
+	GFileMonitor     *monitor;
+	GCancellable     *cancellable;
+
+	/* Checksum and stamp of the contents we last read or wrote, so
+	 * our own writes coming back through the monitor are ignored.
+	 */
+	char             *hash;
+	Stamp             stamp;
+	guint             n_writes;
+
+	guint             reload_id;
+	guint             write_id;
+	gboolean          reloading;
+	gboolean          reload_again;
+	gboolean          applying;
+};
+
+G_DEFINE_FINAL_TYPE (ClasslimitLink, classlimit_link, G_TYPE_OBJECT)
+
+static void
+reload_free (gpointer data)
+{
+	Reload *reload = data;
+
+	g_free (reload->known_hash);
+	g_free (reload->hash);
+	g_clear_pointer (&reload->records, g_variant_unref);
+	g_free (reload);
+}
+
+static void
+stamp_from_info (Stamp     *stamp,
+                 GFileInfo *info)
+{
+	stamp->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+	               g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	stamp->size = g_file_info_get_size (info);
+}
+
+static void
+reload_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+	ClasslimitLink *self = source_object;
+	Reload *reload = task_data;
+	g_autoptr(GFileInfo) info = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree char *contents = NULL;
+	gsize length;
+
+	info = g_file_query_info (self->file, QUERY_ATTRIBUTES, G_FILE_QUERY_INFO_NONE, cancellable, &error);
+	if (info == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	stamp_from_info (&reload->stamp, info);
+
+	/* Untouched since we last read or wrote it */
+	if (reload->known_hash != NULL &&
+	    reload->stamp.mtime == reload->known.mtime &&
+	    reload->stamp.size == reload->known.size) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	if (!g_file_load_contents (self->file, cancellable, &contents, &length, NULL, &error)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	/* Touched, or written back by us, but holding the same roster */
+	reload->hash = g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) contents, length);
+	if (g_strcmp0 (reload->hash, reload->known_hash) == 0) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	reload->records = classlimit_roster_parse_json_records (contents, length,
+		&reload->required_attendance, &reload->total_weeks, &reload->session_hours, &error);
+	if (reload->records == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/* Only what differs from the roster is touched, so editing one
+ * subject in the file updates one row.
+ */
+static void
+apply (ClasslimitLink *self,
+       Reload         *reload)
+{
+	/* As one change, which the roster announces so it can be recorded */
+	self->applying = TRUE;
+	classlimit_roster_merge (self->roster,
+		g_variant_new ("(iiim@a(siii)m@a(ssiii))", reload->required_attendance, reload->total_weeks,
+		               reload->session_hours, reload->records, NULL));
+	self->applying = FALSE;
+}
+
+static void schedule_reload (ClasslimitLink *self);
+
+static void
+on_reloaded (GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+	ClasslimitLink *self = CLASSLIMIT_LINK (source);
+	Reload *reload = g_task_get_task_data (G_TASK (result));
+	g_autoptr(GError) error = NULL;
+
+	self->reloading = FALSE;
+
+	if (!g_task_propagate_boolean (G_TASK (result), &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
+		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			g_warning ("Failed to reload %s: %s", g_file_peek_path (self->file), error->message);
+	} else if (g_cancellable_is_cancelled (self->cancellable)) {
+		return;
+	} else if (reload->n_writes != self->n_writes) {
+		/* We wrote the file meanwhile, so what was read is already stale */
+		self->reload_again = TRUE;
+	} else {
+		self->stamp = reload->stamp;
+		if (reload->hash != NULL) {
+			g_free (self->hash);
+			self->hash = g_steal_pointer (&reload->hash);
+		}
+		if (reload->records != NULL)
+			apply (self, reload);
+	}
+
+	if (self->reload_again && !g_cancellable_is_cancelled (self->cancellable)) {
+		self->reload_again = FALSE;
+		schedule_reload (self);
+	}
+}
+
+static gboolean
+reload_cb (gpointer user_data)
+{
+	ClasslimitLink *self = CLASSLIMIT_LINK (user_data);
+	g_autoptr(GTask) task = NULL;
+	Reload *reload;
+
+	self->reload_id = 0;
+
+	/* Parsed one at a time, the newest state wins once this one is done */
+	if (self->reloading) {
+		self->reload_again = TRUE;
+		return G_SOURCE_REMOVE;
+	}
+
+	reload = g_new0 (Reload, 1);
+	reload->known_hash = g_strdup (self->hash);
+	reload->known = self->stamp;
+	reload->n_writes = self->n_writes;
+
+	self->reloading = TRUE;
+	task = g_task_new (self, self->cancellable, on_reloaded, NULL);
+	g_task_set_source_tag (task, reload_cb);
+	g_task_set_task_data (task, reload, reload_free);
+	g_task_run_in_thread (task, reload_thread);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_reload (ClasslimitLink *self)
+{
+	g_clear_handle_id (&self->reload_id, g_source_remove);
+	self->reload_id = g_timeout_add (RELOAD_DELAY_MS, reload_cb, self);
+}
+
+static void
+on_file_changed (GFileMonitor      *monitor,
+                 GFile             *file,
+                 GFile             *other_file,
+                 GFileMonitorEvent  event,
+                 ClasslimitLink    *self)
+{
+	/* Replacing saves show up as a deletion followed by a creation */
+	switch (event) {
+	case G_FILE_MONITOR_EVENT_CHANGED:
+	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+	case G_FILE_MONITOR_EVENT_CREATED:
+	case G_FILE_MONITOR_EVENT_MOVED_IN:
+	case G_FILE_MONITOR_EVENT_RENAMED:
+		schedule_reload (self);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+on_stamp_queried (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+	g_autoptr(ClasslimitLink) self = user_data;
+	g_autoptr(GFileInfo) info = NULL;
+
+	info = g_file_query_info_finish (G_FILE (source), result, NULL);
+	if (info != NULL)
+		stamp_from_info (&self->stamp, info);
+}
+
+static void
+on_written (GObject      *source,
+            GAsyncResult *result,
+            gpointer      user_data)
+{
+	g_autoptr(ClasslimitLink) self = user_data;
+	g_autoptr(GError) error = NULL;
+
+	if (!g_file_replace_contents_finish (G_FILE (source), result, NULL, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("Failed to write %s: %s", g_file_peek_path (self->file), error->message);
+		return;
+	}
+
+	g_file_query_info_async (self->file, QUERY_ATTRIBUTES, G_FILE_QUERY_INFO_NONE,
+		G_PRIORITY_DEFAULT, self->cancellable, on_stamp_queried, g_object_ref (self));
+}
+
+static GBytes *
+export_roster (ClasslimitLink  *self,
+               char           **hash)
+{
+	char *contents;
+	gsize length;
+
+	contents = classlimit_roster_export_json (self->roster, &length);
+	*hash = g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) contents, length);
+
+	return g_bytes_new_take (contents, length);
+}
+
+static gboolean
+write_cb (gpointer user_data)
+{
+	ClasslimitLink *self = CLASSLIMIT_LINK (user_data);
+	g_autoptr(GBytes) bytes = NULL;
+	char *hash;
+
+	self->write_id = 0;
+
+	bytes = export_roster (self, &hash);
+	if (g_strcmp0 (hash, self->hash) == 0) {
+		g_free (hash);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* Remembered before writing, the monitor may well beat the callback */
+	g_free (self->hash);
+	self->hash = hash;
+	self->n_writes++;
+	g_file_replace_contents_bytes_async (self->file, bytes, NULL, FALSE, G_FILE_CREATE_NONE,
+		self->cancellable, on_written, g_object_ref (self));
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+on_roster_changed (ClasslimitLink *self)
+{
+	/* Already what the file says, or the file has not been read yet
+	 * and must not be overwritten before it is.
+	 */
+	if (self->applying || self->hash == NULL)
+		return;
+
+	if (self->write_id == 0)
+		self->write_id = g_timeout_add (WRITE_DELAY_MS, write_cb, self);
+}
+
+/**
+ * classlimit_link_close:
+ * @self: a #ClasslimitLink
+ *
+ * Stops watching the file. A pending write of the roster is flushed
+ * first, so the file never ends up behind the roster.
+ */
+void
+classlimit_link_close (ClasslimitLink *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_LINK (self));
+
+	if (self->roster == NULL)
+		return;
+
+	if (self->write_id != 0) {
+		g_autoptr(GBytes) bytes = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autofree char *hash = NULL;
+
+		g_clear_handle_id (&self->write_id, g_source_remove);
+		bytes = export_roster (self, &hash);
+		if (g_strcmp0 (hash, self->hash) != 0 &&
+		    !g_file_replace_contents (self->file, g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes),
+		                              NULL, FALSE, G_FILE_CREATE_NONE, NULL, NULL, &error))
+			g_warning ("Failed to write %s: %s", g_file_peek_path (self->file), error->message);
+	}
+
+	g_cancellable_cancel (self->cancellable);
+	g_clear_handle_id (&self->reload_id, g_source_remove);
+	if (self->monitor) {
+		g_signal_handlers_disconnect_by_data (self->monitor, self);
+		g_file_monitor_cancel (self->monitor);
+		g_clear_object (&self->monitor);
+	}
+	g_signal_handlers_disconnect_by_data (self->roster, self);
+	g_clear_object (&self->roster);
+}
+
+static void
+classlimit_link_dispose (GObject *object)
+{
+	ClasslimitLink *self = (ClasslimitLink *)object;
+
+	classlimit_link_close (self);
+
+	G_OBJECT_CLASS (classlimit_link_parent_class)->dispose (object);
+}
+
+static void
+classlimit_link_finalize (GObject *object)
+{
+	ClasslimitLink *self = (ClasslimitLink *)object;
+
+	g_clear_object (&self->file);
+	g_clear_object (&self->cancellable);
+	g_free (self->hash);
+
+	G_OBJECT_CLASS (classlimit_link_parent_class)->finalize (object);
+}
+
+static void
+classlimit_link_class_init (ClasslimitLinkClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = classlimit_link_dispose;
+	object_class->finalize = classlimit_link_finalize;
+}
+
+static void
+classlimit_link_init (ClasslimitLink *self)
+{
+	self->cancellable = g_cancellable_new ();
+}
+
+/**
+ * classlimit_link_new:
+ * @roster: the #ClasslimitRoster to keep in step
+ * @file: an exported roster
+ *
+ * Links @roster to @file. The file is read right away and again
+ * whenever it changes on disk, merging only the subjects that
+ * differ, and changes made to @roster are written back to it.
+ *
+ * Returns: (transfer full): a new #ClasslimitLink
+ */
+ClasslimitLink *
+classlimit_link_new (ClasslimitRoster *roster,
+                     GFile            *file)
+{
+	ClasslimitLink *self;
+	g_autoptr(GError) error = NULL;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (roster), NULL);
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	self = g_object_new (CLASSLIMIT_TYPE_LINK, NULL);
+	self->roster = g_object_ref (roster);
+	self->file = g_object_ref (file);
+
+	self->monitor = g_file_monitor_file (file, G_FILE_MONITOR_WATCH_MOVES, self->cancellable, &error);
+	if (self->monitor)
+		g_signal_connect (self->monitor, "changed", G_CALLBACK (on_file_changed), self);
+	else
+		g_warning ("Failed to watch %s: %s", g_file_peek_path (file), error->message);
+
+	g_signal_connect_swapped (roster, "changed", G_CALLBACK (on_roster_changed), self);
+
+	schedule_reload (self);
+
+	return self;
+}
+
+GFile *
+classlimit_link_get_file (ClasslimitLink *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_LINK (self), NULL);
+
+	return self->file;
+}
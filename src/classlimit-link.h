@@ -0,0 +1,38 @@
+/* classlimit-link.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "classlimit-roster.h"
+
+G_BEGIN_DECLS
+
+#define CLASSLIMIT_TYPE_LINK (classlimit_link_get_type())
+
+G_DECLARE_FINAL_TYPE (ClasslimitLink, classlimit_link, CLASSLIMIT, LINK, GObject)
+
+ClasslimitLink *classlimit_link_new      (ClasslimitRoster *roster,
+                                          GFile            *file);
+GFile          *classlimit_link_get_file (ClasslimitLink   *self);
+void            classlimit_link_close    (ClasslimitLink   *self);
+
+G_END_DECLS
@@ -0,0 +1,219 @@
+/* classlimit-policy.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "classlimit-policy.h"
+
+typedef struct {
+	GPatternSpec *spec;
+	guint         rule;
+} Pattern;
+
+/* Overrides as stored; 0 inherits the roster default */
+typedef struct {
+	int required_attendance;
+	int session_hours;
+	int total_weeks;
+} Overrides;
+
+struct _ClasslimitPolicySet
+{
+	/* Subject name -> rule + 1, for subjects a policy names outright */
+	GHashTable *by_name;
+	/* Group patterns such as "Lab *", tried in policy order */
+	GArray     *patterns;
+	GArray     *overrides;
+	GArray     *rules;
+};
+
+static void
+clear_pattern (gpointer data)
+{
+	Pattern *pattern = data;
+
+	g_pattern_spec_free (pattern->spec);
+}
+
+/**
+ * classlimit_policy_set_new:
+ * @policies: an `a(ssiii)` list of policies, as stored in GSettings
+ *
+ * Compiles @policies into lookup tables. Each policy is a name, a
+ * semicolon-separated list of subject names or glob patterns, and its
+ * required attendance, hours per session and total weeks, where 0 means
+ * the roster's own value. The first policy to name a subject wins, and
+ * naming a subject outright wins over matching it by pattern.
+ *
+ * The rules stay unresolved until classlimit_policy_set_resolve().
+ *
+ * Returns: (transfer full): a new #ClasslimitPolicySet
+ */
+ClasslimitPolicySet *
+classlimit_policy_set_new (GVariant *policies)
+{
+	ClasslimitPolicySet *self;
+	Overrides inherit = { 0, 0, 0 };
+	GVariantIter iter;
+	const char *subjects;
+	Overrides o;
+
+	g_return_val_if_fail (policies == NULL ||
+	                      g_variant_is_of_type (policies, G_VARIANT_TYPE ("a(ssiii)")), NULL);
+
+	self = g_new0 (ClasslimitPolicySet, 1);
+	self->by_name = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	self->patterns = g_array_new (FALSE, FALSE, sizeof (Pattern));
+	g_array_set_clear_func (self->patterns, clear_pattern);
+	self->overrides = g_array_new (FALSE, FALSE, sizeof (Overrides));
+	self->rules = g_array_new (FALSE, TRUE, sizeof (ClasslimitRule));
+
+	g_array_append_val (self->overrides, inherit);
+
+	if (policies != NULL) {
+		g_variant_iter_init (&iter, policies);
+		while (g_variant_iter_next (&iter, "(&s&siii)", NULL, &subjects,
+		                            &o.required_attendance, &o.session_hours, &o.total_weeks)) {
+			g_auto(GStrv) entries = g_strsplit (subjects, ";", -1);
+			guint rule = self->overrides->len;
+			guint i;
+
+			g_array_append_val (self->overrides, o);
+
+			for (i = 0; entries[i] != NULL; i++) {
+				char *entry = g_strstrip (entries[i]);
+
+				if (*entry == '\0')
+					continue;
+
+				if (strpbrk (entry, "*?") != NULL) {
+					Pattern pattern = { g_pattern_spec_new (entry), rule };
+
+					g_array_append_val (self->patterns, pattern);
+				} else if (!g_hash_table_contains (self->by_name, entry)) {
+					g_hash_table_insert (self->by_name, g_strdup (entry), GUINT_TO_POINTER (rule + 1));
+				}
+			}
+		}
+	}
+
+	g_array_set_size (self->rules, self->overrides->len);
+
+	return self;
+}
+
+void
+classlimit_policy_set_free (ClasslimitPolicySet *self)
+{
+	if (self == NULL)
+		return;
+
+	g_hash_table_unref (self->by_name);
+	g_array_unref (self->patterns);
+	g_array_unref (self->overrides);
+	g_array_unref (self->rules);
+	g_free (self);
+}
+
+guint
+classlimit_policy_set_get_n_rules (ClasslimitPolicySet *self)
+{
+	g_return_val_if_fail (self != NULL, 0);
+
+	return self->rules->len;
+}
+
+/**
+ * classlimit_policy_set_match:
+ * @self: a #ClasslimitPolicySet
+ * @name: a subject name
+ *
+ * Finds the rule for the subject called @name. Subject names never
+ * change, so callers only need to do this when the policies do.
+ *
+ * Returns: an index into classlimit_policy_set_get_rules()
+ */
+guint
+classlimit_policy_set_match (ClasslimitPolicySet *self,
+                             const char          *name)
+{
+	gpointer rule;
+	gsize length;
+	guint i;
+
+	g_return_val_if_fail (self != NULL, CLASSLIMIT_POLICY_DEFAULT);
+	g_return_val_if_fail (name != NULL, CLASSLIMIT_POLICY_DEFAULT);
+
+	rule = g_hash_table_lookup (self->by_name, name);
+	if (rule != NULL)
+		return GPOINTER_TO_UINT (rule) - 1;
+
+	length = strlen (name);
+	for (i = 0; i < self->patterns->len; i++) {
+		const Pattern *pattern = &g_array_index (self->patterns, Pattern, i);
+
+		if (g_pattern_spec_match (pattern->spec, length, name, NULL))
+			return pattern->rule;
+	}
+
+	return CLASSLIMIT_POLICY_DEFAULT;
+}
+
+/**
+ * classlimit_policy_set_resolve:
+ * @self: a #ClasslimitPolicySet
+ * @required_attendance: the roster's required attendance
+ * @total_weeks: the roster's total weeks
+ * @session_hours: the roster's hours per session
+ *
+ * Fills in every inherited value and clamps the result, so evaluating
+ * a rule is plain arithmetic.
+ */
+void
+classlimit_policy_set_resolve (ClasslimitPolicySet *self,
+                               int                  required_attendance,
+                               int                  total_weeks,
+                               int                  session_hours)
+{
+	guint i;
+
+	g_return_if_fail (self != NULL);
+
+	for (i = 0; i < self->overrides->len; i++) {
+		const Overrides *o = &g_array_index (self->overrides, Overrides, i);
+		ClasslimitRule *rule = &g_array_index (self->rules, ClasslimitRule, i);
+
+		rule->required_attendance = o->required_attendance > 0 ? o->required_attendance : required_attendance;
+		rule->total_weeks = o->total_weeks > 0 ? o->total_weeks : total_weeks;
+		rule->session_hours = o->session_hours > 0 ? o->session_hours : session_hours;
+		rule->allowed_pct = 100 - CLAMP (rule->required_attendance, 1, 100);
+		rule->session_hours = MAX (rule->session_hours, 1);
+	}
+}
+
+const ClasslimitRule *
+classlimit_policy_set_get_rules (ClasslimitPolicySet *self)
+{
+	g_return_val_if_fail (self != NULL, NULL);
+
+	return (const ClasslimitRule *) (gpointer) self->rules->data;
+}
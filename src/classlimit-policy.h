@@ -0,0 +1,77 @@
+/* classlimit-policy.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Rule 0 is the roster's own parameters, for subjects no policy names */
+#define CLASSLIMIT_POLICY_DEFAULT 0
+
+/* A policy with every threshold resolved against the roster defaults.
+ * A session of one hour is an allowance in hours.
+ */
+typedef struct {
+	int required_attendance;
+	int total_weeks;
+	int session_hours;
+	int allowed_pct;
+} ClasslimitRule;
+
+typedef struct _ClasslimitPolicySet ClasslimitPolicySet;
+
+ClasslimitPolicySet  *classlimit_policy_set_new         (GVariant            *policies);
+void                  classlimit_policy_set_free        (ClasslimitPolicySet *self);
+guint                 classlimit_policy_set_get_n_rules (ClasslimitPolicySet *self);
+guint                 classlimit_policy_set_match       (ClasslimitPolicySet *self,
+                                                         const char          *name);
+void                  classlimit_policy_set_resolve     (ClasslimitPolicySet *self,
+                                                         int                  required_attendance,
+                                                         int                  total_weeks,
+                                                         int                  session_hours);
+const ClasslimitRule *classlimit_policy_set_get_rules   (ClasslimitPolicySet *self);
+
+/* Allowed skips in the rule's unit, with no branches on the unit */
+static inline int
+classlimit_rule_evaluate (const ClasslimitRule *rule,
+                          int                   weekly_hours,
+                          int                  *total_classes)
+{
+	int total = weekly_hours * rule->total_weeks;
+
+	*total_classes = total;
+
+	return (total * rule->allowed_pct) / 100 / rule->session_hours;
+}
+
+static inline gboolean
+classlimit_rule_equal (const ClasslimitRule *a,
+                       const ClasslimitRule *b)
+{
+	return a->required_attendance == b->required_attendance &&
+	       a->total_weeks == b->total_weeks &&
+	       a->session_hours == b->session_hours;
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ClasslimitPolicySet, classlimit_policy_set_free)
+
+G_END_DECLS
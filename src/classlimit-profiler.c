@@ -0,0 +1,140 @@
+/* classlimit-profiler.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#if HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+#include "classlimit-profiler.h"
+
+/* Durations are bucketed by power of two microseconds, which is plenty
+ * of resolution for a p99 estimate and keeps every probe a fixed size.
+ */
+#define N_BUCKETS 40
+
+typedef struct {
+	guint64 calls;
+	guint64 rows;
+	gint64  total_usec;
+	gint64  max_usec;
+	guint64 buckets[N_BUCKETS];
+} Probe;
+
+static Probe probes[CLASSLIMIT_N_PROBES];
+
+static const char *probe_names[CLASSLIMIT_N_PROBES] = {
+	[CLASSLIMIT_PROBE_LOAD]          = "load",
+	[CLASSLIMIT_PROBE_SAVE]          = "save",
+	[CLASSLIMIT_PROBE_CALCULATE]     = "calculate",
+	[CLASSLIMIT_PROBE_CLEAR_RESULTS] = "clear-results",
+	[CLASSLIMIT_PROBE_IMPORT]        = "import",
+	[CLASSLIMIT_PROBE_EXPORT]        = "export",
+};
+
+gint64
+classlimit_profiler_begin (void)
+{
+	return g_get_monotonic_time ();
+}
+
+void
+classlimit_profiler_end (ClasslimitProbe probe,
+                         gint64          begin,
+                         guint           rows)
+{
+	Probe *p;
+	gint64 duration;
+	guint bucket;
+
+	g_return_if_fail (probe < CLASSLIMIT_N_PROBES);
+
+	duration = MAX (g_get_monotonic_time () - begin, 0);
+	bucket = MIN (duration > 0 ? g_bit_storage ((gulong) duration) : 0, N_BUCKETS - 1);
+
+	p = &probes[probe];
+	p->calls++;
+	p->rows += rows;
+	p->total_usec += duration;
+	p->max_usec = MAX (p->max_usec, duration);
+	p->buckets[bucket]++;
+
+#if HAVE_SYSPROF
+	/* Both clocks are CLOCK_MONOTONIC, sysprof just wants nanoseconds */
+	sysprof_collector_mark_printf (begin * 1000, duration * 1000,
+	                               "classlimit", probe_names[probe],
+	                               "%u rows", rows);
+#endif
+}
+
+const char *
+classlimit_profiler_probe_name (ClasslimitProbe probe)
+{
+	g_return_val_if_fail (probe < CLASSLIMIT_N_PROBES, NULL);
+
+	return probe_names[probe];
+}
+
+void
+classlimit_profiler_get_stats (ClasslimitProbe       probe,
+                               ClasslimitProbeStats *stats)
+{
+	const Probe *p;
+	guint64 threshold;
+	guint64 seen = 0;
+	guint i;
+
+	g_return_if_fail (probe < CLASSLIMIT_N_PROBES);
+	g_return_if_fail (stats != NULL);
+
+	p = &probes[probe];
+	stats->calls = p->calls;
+	stats->rows = p->rows;
+	stats->total_usec = p->total_usec;
+	stats->max_usec = p->max_usec;
+	stats->p99_usec = 0;
+
+	/* Report the upper edge of the bucket holding the 99th percentile,
+	 * clamped to the worst sample we actually observed.
+	 */
+	threshold = (p->calls * 99 + 99) / 100;
+	for (i = 0; i < N_BUCKETS && p->calls > 0; i++) {
+		seen += p->buckets[i];
+		if (seen >= threshold) {
+			stats->p99_usec = MIN (i > 0 ? ((gint64) 1 << i) - 1 : 0, p->max_usec);
+			break;
+		}
+	}
+}
+
+void
+classlimit_profiler_reset (void)
+{
+	memset (probes, 0, sizeof probes);
+}
+
+gboolean
+classlimit_profiler_debug_enabled (void)
+{
+	const char *env = g_getenv ("CLASSLIMIT_DEBUG");
+
+	return env != NULL && *env != '\0' && g_strcmp0 (env, "0") != 0;
+}
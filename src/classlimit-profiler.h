@@ -0,0 +1,55 @@
+/* classlimit-profiler.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	CLASSLIMIT_PROBE_LOAD,
+	CLASSLIMIT_PROBE_SAVE,
+	CLASSLIMIT_PROBE_CALCULATE,
+	CLASSLIMIT_PROBE_CLEAR_RESULTS,
+	CLASSLIMIT_PROBE_IMPORT,
+	CLASSLIMIT_PROBE_EXPORT,
+	CLASSLIMIT_N_PROBES
+} ClasslimitProbe;
+
+typedef struct {
+	guint64 calls;
+	guint64 rows;
+	gint64  total_usec;
+	gint64  max_usec;
+	gint64  p99_usec;
+} ClasslimitProbeStats;
+
+gint64       classlimit_profiler_begin         (void);
+void         classlimit_profiler_end           (ClasslimitProbe       probe,
+                                                gint64                begin,
+                                                guint                 rows);
+const char  *classlimit_profiler_probe_name    (ClasslimitProbe       probe);
+void         classlimit_profiler_get_stats     (ClasslimitProbe       probe,
+                                                ClasslimitProbeStats *stats);
+void         classlimit_profiler_reset         (void);
+gboolean     classlimit_profiler_debug_enabled (void);
+
+G_END_DECLS
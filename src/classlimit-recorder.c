@@ -0,0 +1,86 @@
+/* classlimit-recorder.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "classlimit-recorder.h"
+
+struct _ClasslimitRecorder
+{
+	GOutputStream *stream;
+	gint64         start;
+};
+
+ClasslimitRecorder *
+classlimit_recorder_new (const char  *path,
+                         GError     **error)
+{
+	g_autoptr(GFile) file = NULL;
+	GFileOutputStream *stream;
+	ClasslimitRecorder *self;
+
+	g_return_val_if_fail (path != NULL, NULL);
+
+	file = g_file_new_for_path (path);
+	stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (stream == NULL)
+		return NULL;
+
+	self = g_new0 (ClasslimitRecorder, 1);
+	self->stream = G_OUTPUT_STREAM (stream);
+	self->start = g_get_monotonic_time ();
+
+	g_output_stream_write_all (self->stream, "# classlimit-actions 1\n",
+	                           strlen ("# classlimit-actions 1\n"), NULL, NULL, NULL);
+
+	return self;
+}
+
+/* Stamps the action relative to the start of the recording and writes
+ * it out straight away, so a session that ends in a hang or a crash
+ * still leaves a usable log behind.
+ */
+void
+classlimit_recorder_log (ClasslimitRecorder *self,
+                         ClasslimitAction   *action)
+{
+	g_autofree char *line = NULL;
+	g_autoptr(GError) error = NULL;
+
+	g_return_if_fail (self != NULL);
+	g_return_if_fail (action != NULL);
+
+	action->time = g_get_monotonic_time () - self->start;
+	line = classlimit_action_to_string (action);
+
+	if (!g_output_stream_printf (self->stream, NULL, NULL, &error, "%s\n", line))
+		g_warning ("Failed to record action: %s", error->message);
+}
+
+void
+classlimit_recorder_free (ClasslimitRecorder *self)
+{
+	if (self == NULL)
+		return;
+
+	g_output_stream_close (self->stream, NULL, NULL);
+	g_object_unref (self->stream);
+	g_free (self);
+}
@@ -0,0 +1,37 @@
+/* classlimit-recorder.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "classlimit-action.h"
+
+G_BEGIN_DECLS
+
+typedef struct _ClasslimitRecorder ClasslimitRecorder;
+
+ClasslimitRecorder *classlimit_recorder_new  (const char          *path,
+                                              GError             **error);
+void                classlimit_recorder_log  (ClasslimitRecorder  *self,
+                                              ClasslimitAction    *action);
+void                classlimit_recorder_free (ClasslimitRecorder  *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ClasslimitRecorder, classlimit_recorder_free)
+
+G_END_DECLS
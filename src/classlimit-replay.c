@@ -0,0 +1,366 @@
+/* classlimit-replay.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#define G_SETTINGS_ENABLE_BACKEND
+#include <gio/gsettingsbackend.h>
+#include <glib/gstdio.h>
+
+#include "classlimit-action.h"
+
+static int n_generate = 0;
+static int seed = 0;
+static char *output_path = NULL;
+
+static GOptionEntry entries[] = {
+	{ "generate", 'g', 0, G_OPTION_ARG_INT, &n_generate, "Replay N synthetic actions instead of FILE", "N" },
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &seed, "Seed for the synthetic action generator", "SEED" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_path, "Write the synthetic actions to PATH", "PATH" },
+	{ NULL }
+};
+
+#define N_IMPORTED 24
+
+/* The export that synthetic import actions load */
+static gboolean
+write_import (const char  *path,
+              GError     **error)
+{
+	g_autoptr(GString) str = g_string_new ("{\"version\": 1, \"subjects\": [");
+	guint i;
+
+	for (i = 0; i < N_IMPORTED; i++)
+		g_string_append_printf (str, "%s{\"name\": \"Imported %u\", \"weekly_hours\": %u, \"current_skips\": %u}",
+		                        i > 0 ? ", " : "", i, 1 + i % 6, i % 3);
+	g_string_append (str, "]}\n");
+
+	return g_file_set_contents (path, str->str, str->len, error);
+}
+
+/* One random position, then each later one with a chance of one in four */
+static GArray *
+pick_positions (GRand *rand,
+                guint  n_subjects)
+{
+	GArray *positions = g_array_new (FALSE, FALSE, sizeof (guint));
+	guint i = g_rand_int_range (rand, 0, n_subjects);
+
+	g_array_append_val (positions, i);
+	for (i++; i < n_subjects; i++) {
+		if (g_rand_int_range (rand, 0, 4) == 0)
+			g_array_append_val (positions, i);
+	}
+
+	return positions;
+}
+
+/* Produces a plausible session: mostly adds and skip clicks, some
+ * removals, bulk edits, parameter tweaks and calculations, the odd
+ * paste, policy change or import of @import_path, and the odd reset.
+ * Positions always refer to a subject that exists at that point.
+ */
+static GArray *
+generate_actions (guint        n_actions,
+                  guint32      generator_seed,
+                  const char  *import_path)
+{
+	g_autoptr(GRand) rand = g_rand_new_with_seed (generator_seed);
+	GArray *actions = g_array_sized_new (FALSE, TRUE, sizeof (ClasslimitAction), n_actions);
+	guint n_subjects = 0;
+	guint i;
+
+	g_array_set_clear_func (actions, (GDestroyNotify) classlimit_action_clear);
+
+	for (i = 0; i < n_actions; i++) {
+		ClasslimitAction action = { 0 };
+		int dice = g_rand_int_range (rand, 0, 1000);
+
+		action.time = (gint64) i * 1000;
+
+		if (n_subjects == 0 || dice < 250) {
+			action.kind = CLASSLIMIT_ACTION_ADD;
+			action.value = g_rand_int_range (rand, 1, 8);
+			action.text = g_strdup_printf ("Subject %u", i);
+			n_subjects++;
+		} else if (dice < 500) {
+			action.kind = CLASSLIMIT_ACTION_SKIP_INCREMENT;
+		} else if (dice < 580) {
+			action.kind = CLASSLIMIT_ACTION_SKIP_DECREMENT;
+		} else if (dice < 620) {
+			action.kind = CLASSLIMIT_ACTION_SKIP_RESET;
+		} else if (dice < 700) {
+			action.kind = CLASSLIMIT_ACTION_REMOVE;
+		} else if (dice < 720) {
+			action.kind = CLASSLIMIT_ACTION_SET_ATTENDANCE;
+			action.value = g_rand_int_range (rand, 50, 101);
+		} else if (dice < 740) {
+			action.kind = CLASSLIMIT_ACTION_SET_WEEKS;
+			action.value = g_rand_int_range (rand, 1, 61);
+		} else if (dice < 760) {
+			action.kind = CLASSLIMIT_ACTION_SET_SESSION_HOURS;
+			action.value = g_rand_int_range (rand, 1, 4);
+		} else if (dice < 800) {
+			action.kind = CLASSLIMIT_ACTION_BULK_ADD_SKIPS;
+			action.value = g_rand_boolean (rand) ? 1 : -1;
+		} else if (dice < 815) {
+			action.kind = CLASSLIMIT_ACTION_BULK_RESET_SKIPS;
+		} else if (dice < 830) {
+			action.kind = CLASSLIMIT_ACTION_BULK_SET_HOURS;
+			action.value = g_rand_int_range (rand, 1, 8);
+		} else if (dice < 845) {
+			action.kind = CLASSLIMIT_ACTION_BULK_REMOVE;
+		} else if (dice < 855) {
+			action.kind = CLASSLIMIT_ACTION_SET_POLICIES;
+			action.text = g_strdup_printf ("[('Labs', 'Subject %u*', %d, %d, 0)]",
+			                               g_rand_int_range (rand, 1, 10),
+			                               g_rand_int_range (rand, 50, 101),
+			                               g_rand_int_range (rand, 0, 4));
+		} else if (dice < 875) {
+			GString *text = g_string_new (NULL);
+			guint n_lines = g_rand_int_range (rand, 1, 6);
+			guint j;
+
+			for (j = 0; j < n_lines; j++)
+				g_string_append_printf (text, "Pasted %u.%u\t%d\n", i, j, g_rand_int_range (rand, 1, 8));
+			action.kind = CLASSLIMIT_ACTION_PASTE;
+			action.text = g_string_free (text, FALSE);
+			n_subjects += n_lines;
+		} else if (dice < 880) {
+			action.kind = CLASSLIMIT_ACTION_IMPORT;
+			action.text = g_strdup (import_path);
+			n_subjects = N_IMPORTED;
+		} else if (dice < 999) {
+			action.kind = CLASSLIMIT_ACTION_CALCULATE;
+		} else {
+			action.kind = CLASSLIMIT_ACTION_RESET_ALL;
+			n_subjects = 0;
+		}
+
+		if (action.kind == CLASSLIMIT_ACTION_REMOVE ||
+		    action.kind == CLASSLIMIT_ACTION_SKIP_INCREMENT ||
+		    action.kind == CLASSLIMIT_ACTION_SKIP_DECREMENT ||
+		    action.kind == CLASSLIMIT_ACTION_SKIP_RESET)
+			action.position = g_rand_int_range (rand, 0, n_subjects);
+		if (action.kind == CLASSLIMIT_ACTION_REMOVE)
+			n_subjects--;
+
+		if (action.kind == CLASSLIMIT_ACTION_BULK_ADD_SKIPS ||
+		    action.kind == CLASSLIMIT_ACTION_BULK_RESET_SKIPS ||
+		    action.kind == CLASSLIMIT_ACTION_BULK_SET_HOURS ||
+		    action.kind == CLASSLIMIT_ACTION_BULK_REMOVE)
+			action.positions = pick_positions (rand, n_subjects);
+		if (action.kind == CLASSLIMIT_ACTION_BULK_REMOVE)
+			n_subjects -= action.positions->len;
+
+		g_array_append_val (actions, action);
+	}
+
+	return actions;
+}
+
+static gboolean
+write_actions (GArray      *actions,
+               const char  *path,
+               GError     **error)
+{
+	g_autoptr(GString) str = g_string_new ("# classlimit-actions 1\n");
+	guint i;
+
+	for (i = 0; i < actions->len; i++) {
+		g_autofree char *line = classlimit_action_to_string (&g_array_index (actions, ClasslimitAction, i));
+
+		g_string_append (str, line);
+		g_string_append_c (str, '\n');
+	}
+
+	return g_file_set_contents (path, str->str, str->len, error);
+}
+
+static int
+compare_duration (gconstpointer a,
+                  gconstpointer b)
+{
+	gint64 da = *(const gint64 *) a;
+	gint64 db = *(const gint64 *) b;
+
+	return (da > db) - (da < db);
+}
+
+static void
+print_report (GArray **durations)
+{
+	guint kind;
+
+	g_print ("%-18s %8s %10s %10s %10s %10s %10s\n",
+	         "action", "count", "total ms", "mean us", "p50 us", "p99 us", "max us");
+
+	for (kind = 0; kind < CLASSLIMIT_N_ACTIONS; kind++) {
+		GArray *d = durations[kind];
+		gint64 total = 0;
+		guint i;
+
+		if (d->len == 0)
+			continue;
+
+		g_array_sort (d, compare_duration);
+		for (i = 0; i < d->len; i++)
+			total += g_array_index (d, gint64, i);
+
+		g_print ("%-18s %8u %10.2f %10.1f %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT "\n",
+		         classlimit_action_kind_to_string (kind),
+		         d->len,
+		         total / 1000.0,
+		         (double) total / d->len,
+		         g_array_index (d, gint64, d->len / 2),
+		         g_array_index (d, gint64, MIN (d->len - 1, (d->len * 99) / 100)),
+		         g_array_index (d, gint64, d->len - 1));
+	}
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_autoptr(GOptionContext) context = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GArray) actions = NULL;
+	g_auto(GStrv) lines = NULL;
+	g_autofree char *contents = NULL;
+	g_autofree char *import_path = NULL;
+	g_autoptr(GSettingsSchema) schema = NULL;
+	g_autoptr(GSettingsBackend) backend = NULL;
+	g_autoptr(GSettings) settings = NULL;
+	g_autoptr(ClasslimitRoster) roster = NULL;
+	GArray *durations[CLASSLIMIT_N_ACTIONS];
+	guint n_replayed = 0;
+	guint n_failed = 0;
+	guint n_actions;
+	gint64 begin;
+	guint i;
+
+	context = g_option_context_new ("[FILE] - replay recorded ClassLimit actions");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		return 1;
+	}
+
+	if (n_generate > 0) {
+		/* Kept next to a saved session, which refers to it by path */
+		if (output_path) {
+			import_path = g_strconcat (output_path, ".json", NULL);
+		} else {
+			int fd = g_file_open_tmp ("classlimit-replay-XXXXXX.json", &import_path, &error);
+
+			if (fd < 0) {
+				g_printerr ("%s\n", error->message);
+				return 1;
+			}
+			g_close (fd, NULL);
+		}
+
+		actions = generate_actions (n_generate, seed, import_path);
+		if (!write_import (import_path, &error) ||
+		    (output_path && !write_actions (actions, output_path, &error))) {
+			g_printerr ("%s\n", error->message);
+			return 1;
+		}
+		n_actions = actions->len;
+	} else if (argc == 2) {
+		/* Parsed as the replay reaches each line, so bulk positions
+		 * are checked against the roster they apply to
+		 */
+		if (!g_file_get_contents (argv[1], &contents, NULL, &error)) {
+			g_printerr ("%s\n", error->message);
+			return 1;
+		}
+		lines = g_strsplit (contents, "\n", -1);
+		n_actions = g_strv_length (lines);
+	} else {
+		g_autofree char *help = g_option_context_get_help (context, TRUE, NULL);
+		g_printerr ("%s", help);
+		return 1;
+	}
+
+	/* Same schema as the app, but kept in memory so replays are
+	 * repeatable and never touch the user's dconf database.
+	 */
+	schema = g_settings_schema_source_lookup (g_settings_schema_source_get_default (),
+	                                          "com.tomasps.classlimit", TRUE);
+	if (schema == NULL) {
+		g_printerr ("Schema com.tomasps.classlimit not found, set GSETTINGS_SCHEMA_DIR\n");
+		return 1;
+	}
+	backend = g_memory_settings_backend_new ();
+	settings = g_settings_new_full (schema, backend, NULL);
+	roster = classlimit_roster_new ();
+	classlimit_roster_load (roster, settings);
+
+	for (i = 0; i < CLASSLIMIT_N_ACTIONS; i++)
+		durations[i] = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	begin = g_get_monotonic_time ();
+	for (i = 0; i < n_actions; i++) {
+		ClasslimitAction parsed = { 0 };
+		const ClasslimitAction *action = &parsed;
+		ClasslimitTotals totals;
+		g_autoptr(GError) apply_error = NULL;
+		gint64 start;
+		gint64 duration;
+
+		if (lines == NULL) {
+			action = &g_array_index (actions, ClasslimitAction, i);
+		} else if (*lines[i] == '\0' || *lines[i] == '#') {
+			continue;
+		} else if (!classlimit_action_parse (&parsed, lines[i],
+		                                     g_list_model_get_n_items (G_LIST_MODEL (roster)),
+		                                     &apply_error)) {
+			g_printerr ("%s:%u: %s\n", argv[1], i + 1, apply_error->message);
+			n_replayed++;
+			n_failed++;
+			continue;
+		}
+
+		n_replayed++;
+		start = g_get_monotonic_time ();
+		if (classlimit_action_apply (action, roster, &totals, &apply_error)) {
+			duration = g_get_monotonic_time () - start;
+			g_array_append_val (durations[action->kind], duration);
+		} else {
+			g_printerr ("action %u (%s): %s\n", i,
+			            classlimit_action_kind_to_string (action->kind), apply_error->message);
+			n_failed++;
+		}
+		classlimit_action_clear (&parsed);
+	}
+
+	g_print ("Replayed %u actions in %.2f ms, %u failed, %u subjects at the end\n\n",
+	         n_replayed, (g_get_monotonic_time () - begin) / 1000.0, n_failed,
+	         g_list_model_get_n_items (G_LIST_MODEL (roster)));
+	print_report (durations);
+
+	for (i = 0; i < CLASSLIMIT_N_ACTIONS; i++)
+		g_array_unref (durations[i]);
+	if (import_path && output_path == NULL)
+		g_unlink (import_path);
+
+	return n_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,1766 @@
+/* classlimit-roster.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+#include <json-glib/json-glib.h>
+
+#include "classlimit-roster.h"
+#include "classlimit-profiler.h"
+
+#define DEFAULT_REQUIRED_ATTENDANCE 80
+#define DEFAULT_TOTAL_WEEKS 15
+#define DEFAULT_SESSION_HOURS 1
+
+struct _ClasslimitRoster
+{
+	GObject    parent_instance;
+
+	GPtrArray *subjects;
+	int        required_attendance;
+	int        total_weeks;
+	int        session_hours;
+
+	/* Per-subject rules, as stored and compiled */
+	GVariant  *policies;
+	ClasslimitPolicySet *policy_set;
+
+	/* Last calculation, see classlimit_roster_get_totals() */
+	ClasslimitTotals totals;
+	gboolean   totals_valid;
+	guint64    cache_hash;
+
+	/* Backing store, bound by classlimit_roster_load() */
+	GSettings *settings;
+	gulong     settings_changed_id;
+	guint      transaction_depth;
+	gboolean   saving;
+	guint      save_holds;
+	gboolean   save_pending;
+};
+
+static void list_model_iface_init (GListModelInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (ClasslimitRoster, classlimit_roster, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, list_model_iface_init))
+
+enum {
+	PROP_0,
+	PROP_REQUIRED_ATTENDANCE,
+	PROP_TOTAL_WEEKS,
+	PROP_SESSION_HOURS,
+	PROP_N_ITEMS,
+	N_PROPS
+};
+
+enum {
+	CHANGED,
+	CALCULATED,
+	MERGED,
+	N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+/* FNV-1a; stable across runs, unlike g_str_hash() plus pointer mixing */
+#define HASH_INIT G_GUINT64_CONSTANT (0xcbf29ce484222325)
+
+static guint64
+hash_bytes (guint64      hash,
+            gconstpointer data,
+            gsize        length)
+{
+	const guint8 *p = data;
+	gsize i;
+
+	for (i = 0; i < length; i++) {
+		hash ^= p[i];
+		hash *= G_GUINT64_CONSTANT (0x100000001b3);
+	}
+
+	return hash;
+}
+
+static guint64
+hash_int (guint64 hash,
+          gint64  value)
+{
+	return hash_bytes (hash, &value, sizeof value);
+}
+
+static inline const ClasslimitRule *
+get_rule (ClasslimitRoster  *self,
+          ClasslimitSubject *s)
+{
+	return &classlimit_policy_set_get_rules (self->policy_set)[classlimit_subject_get_policy (s)];
+}
+
+/* Everything one subject's results depend on */
+static guint64
+subject_key (ClasslimitRoster  *self,
+             ClasslimitSubject *s)
+{
+	const char *name = classlimit_subject_get_name (s);
+	const ClasslimitRule *rule = get_rule (self, s);
+	guint64 hash = hash_bytes (HASH_INIT, name, strlen (name) + 1);
+
+	hash = hash_int (hash, classlimit_subject_get_weekly_hours (s));
+	hash = hash_int (hash, rule->total_weeks);
+	hash = hash_int (hash, rule->required_attendance);
+	return hash_int (hash, rule->session_hours);
+}
+
+static guint64
+input_hash (ClasslimitRoster *self)
+{
+	guint64 hash = hash_int (HASH_INIT, self->subjects->len);
+	guint i;
+
+	hash = hash_int (hash, self->total_weeks);
+	hash = hash_int (hash, self->required_attendance);
+	hash = hash_int (hash, self->session_hours);
+	for (i = 0; i < self->subjects->len; i++)
+		hash = hash_int (hash, subject_key (self, g_ptr_array_index (self->subjects, i)));
+
+	return hash;
+}
+
+/* A parameter changed, so every rule inheriting it is resolved again.
+ * Subjects under a policy that overrides the parameter keep their results.
+ */
+static void
+resolve_rules (ClasslimitRoster *self)
+{
+	guint n_rules = classlimit_policy_set_get_n_rules (self->policy_set);
+	g_autofree ClasslimitRule *old_rules = NULL;
+	g_autofree gboolean *moved = NULL;
+	const ClasslimitRule *rules;
+	guint i;
+
+	old_rules = g_memdup2 (classlimit_policy_set_get_rules (self->policy_set),
+	                       n_rules * sizeof (ClasslimitRule));
+	classlimit_policy_set_resolve (self->policy_set, self->required_attendance,
+	                               self->total_weeks, self->session_hours);
+
+	rules = classlimit_policy_set_get_rules (self->policy_set);
+	moved = g_new (gboolean, n_rules);
+	for (i = 0; i < n_rules; i++)
+		moved[i] = !classlimit_rule_equal (&old_rules[i], &rules[i]);
+
+	for (i = 0; i < self->subjects->len; i++) {
+		ClasslimitSubject *s = g_ptr_array_index (self->subjects, i);
+
+		if (moved[classlimit_subject_get_policy (s)])
+			classlimit_subject_invalidate_results (s);
+	}
+
+	/* Session totals use the roster's own hours per session */
+	self->totals_valid = FALSE;
+}
+
+static GType
+classlimit_roster_get_item_type (GListModel *model)
+{
+	return CLASSLIMIT_TYPE_SUBJECT;
+}
+
+static guint
+classlimit_roster_get_n_items (GListModel *model)
+{
+	return CLASSLIMIT_ROSTER (model)->subjects->len;
+}
+
+static gpointer
+classlimit_roster_get_item (GListModel *model,
+                            guint       position)
+{
+	ClasslimitRoster *self = CLASSLIMIT_ROSTER (model);
+
+	if (position >= self->subjects->len)
+		return NULL;
+
+	return g_object_ref (g_ptr_array_index (self->subjects, position));
+}
+
+static void
+list_model_iface_init (GListModelInterface *iface)
+{
+	iface->get_item_type = classlimit_roster_get_item_type;
+	iface->get_n_items = classlimit_roster_get_n_items;
+	iface->get_item = classlimit_roster_get_item;
+}
+
+/* Replaces n_removed subjects at position with the (owned) additions and
+ * tells listeners about it with a single items-changed.
+ */
+static void
+splice (ClasslimitRoster   *self,
+        guint               position,
+        guint               n_removed,
+        ClasslimitSubject **additions,
+        guint               n_added)
+{
+	guint i;
+
+	for (i = 0; i < n_added; i++)
+		classlimit_subject_set_policy (additions[i],
+			classlimit_policy_set_match (self->policy_set, classlimit_subject_get_name (additions[i])));
+
+	g_ptr_array_remove_range (self->subjects, position, n_removed);
+	if (n_added > 0) {
+		guint old_len = self->subjects->len;
+
+		g_ptr_array_set_size (self->subjects, old_len + n_added);
+		memmove (&self->subjects->pdata[position + n_added],
+		         &self->subjects->pdata[position],
+		         (old_len - position) * sizeof (gpointer));
+		memcpy (&self->subjects->pdata[position], additions, n_added * sizeof (gpointer));
+	}
+
+	if (n_removed > 0 || n_added > 0)
+		self->totals_valid = FALSE;
+
+	g_list_model_items_changed (G_LIST_MODEL (self), position, n_removed, n_added);
+	if (n_removed != n_added)
+		g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_ITEMS]);
+}
+
+static void
+classlimit_roster_finalize (GObject *object)
+{
+	ClasslimitRoster *self = (ClasslimitRoster *)object;
+
+	g_clear_pointer (&self->subjects, g_ptr_array_unref);
+	g_clear_pointer (&self->policies, g_variant_unref);
+	g_clear_pointer (&self->policy_set, classlimit_policy_set_free);
+	if (self->settings)
+		g_clear_signal_handler (&self->settings_changed_id, self->settings);
+	g_clear_object (&self->settings);
+
+	G_OBJECT_CLASS (classlimit_roster_parent_class)->finalize (object);
+}
+
+static void
+classlimit_roster_get_property (GObject    *object,
+                                guint       prop_id,
+                                GValue     *value,
+                                GParamSpec *pspec)
+{
+	ClasslimitRoster *self = CLASSLIMIT_ROSTER (object);
+
+	switch (prop_id) {
+	case PROP_REQUIRED_ATTENDANCE:
+		g_value_set_int (value, self->required_attendance);
+		break;
+	case PROP_TOTAL_WEEKS:
+		g_value_set_int (value, self->total_weeks);
+		break;
+	case PROP_SESSION_HOURS:
+		g_value_set_int (value, self->session_hours);
+		break;
+	case PROP_N_ITEMS:
+		g_value_set_uint (value, self->subjects->len);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_roster_set_property (GObject      *object,
+                                guint         prop_id,
+                                const GValue *value,
+                                GParamSpec   *pspec)
+{
+	ClasslimitRoster *self = CLASSLIMIT_ROSTER (object);
+
+	switch (prop_id) {
+	case PROP_REQUIRED_ATTENDANCE:
+		classlimit_roster_set_required_attendance (self, g_value_get_int (value));
+		break;
+	case PROP_TOTAL_WEEKS:
+		classlimit_roster_set_total_weeks (self, g_value_get_int (value));
+		break;
+	case PROP_SESSION_HOURS:
+		classlimit_roster_set_session_hours (self, g_value_get_int (value));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_roster_class_init (ClasslimitRosterClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = classlimit_roster_finalize;
+	object_class->get_property = classlimit_roster_get_property;
+	object_class->set_property = classlimit_roster_set_property;
+
+	properties [PROP_REQUIRED_ATTENDANCE] =
+		g_param_spec_int ("required-attendance", NULL, NULL,
+		                  G_MININT, G_MAXINT, DEFAULT_REQUIRED_ATTENDANCE,
+		                  (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+	properties [PROP_TOTAL_WEEKS] =
+		g_param_spec_int ("total-weeks", NULL, NULL,
+		                  G_MININT, G_MAXINT, DEFAULT_TOTAL_WEEKS,
+		                  (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+	properties [PROP_SESSION_HOURS] =
+		g_param_spec_int ("session-hours", NULL, NULL,
+		                  G_MININT, G_MAXINT, DEFAULT_SESSION_HOURS,
+		                  (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+	properties [PROP_N_ITEMS] =
+		g_param_spec_uint ("n-items", NULL, NULL,
+		                   0, G_MAXUINT, 0,
+		                   (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_properties (object_class, N_PROPS, properties);
+
+	/**
+	 * ClasslimitRoster::changed:
+	 *
+	 * Emitted once per committed transaction, after it has been saved
+	 * unless saves are held, see classlimit_roster_hold_saves().
+	 */
+	signals [CHANGED] =
+		g_signal_new ("changed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 0);
+
+	/**
+	 * ClasslimitRoster::calculated:
+	 *
+	 * Emitted after classlimit_roster_calculate(), so every view can
+	 * show the new results.
+	 */
+	signals [CALCULATED] =
+		g_signal_new ("calculated",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 0);
+
+	/**
+	 * ClasslimitRoster::merged:
+	 * @change: the change, as taken by classlimit_roster_merge()
+	 *
+	 * Emitted when something other than the application changed the
+	 * roster: another process writing the settings, or an edit to a
+	 * linked file. Recording @change lets a replay follow along.
+	 */
+	signals [MERGED] =
+		g_signal_new ("merged",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 1, G_TYPE_VARIANT);
+}
+
+static void
+classlimit_roster_init (ClasslimitRoster *self)
+{
+	self->subjects = g_ptr_array_new_with_free_func (g_object_unref);
+	self->required_attendance = DEFAULT_REQUIRED_ATTENDANCE;
+	self->total_weeks = DEFAULT_TOTAL_WEEKS;
+	self->session_hours = DEFAULT_SESSION_HOURS;
+	self->policies = g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE ("(ssiii)"), NULL, 0));
+	self->policy_set = classlimit_policy_set_new (self->policies);
+	classlimit_policy_set_resolve (self->policy_set, self->required_attendance,
+	                               self->total_weeks, self->session_hours);
+}
+
+ClasslimitRoster *
+classlimit_roster_new (void)
+{
+	return g_object_new (CLASSLIMIT_TYPE_ROSTER, NULL);
+}
+
+int
+classlimit_roster_get_required_attendance (ClasslimitRoster *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), 0);
+
+	return self->required_attendance;
+}
+
+void
+classlimit_roster_set_required_attendance (ClasslimitRoster *self,
+                                           int               required_attendance)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	if (self->required_attendance == required_attendance)
+		return;
+
+	self->required_attendance = required_attendance;
+	resolve_rules (self);
+	g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_REQUIRED_ATTENDANCE]);
+}
+
+int
+classlimit_roster_get_total_weeks (ClasslimitRoster *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), 0);
+
+	return self->total_weeks;
+}
+
+void
+classlimit_roster_set_total_weeks (ClasslimitRoster *self,
+                                   int               total_weeks)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	if (self->total_weeks == total_weeks)
+		return;
+
+	self->total_weeks = total_weeks;
+	resolve_rules (self);
+	g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_TOTAL_WEEKS]);
+}
+
+int
+classlimit_roster_get_session_hours (ClasslimitRoster *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), 0);
+
+	return self->session_hours;
+}
+
+void
+classlimit_roster_set_session_hours (ClasslimitRoster *self,
+                                     int               session_hours)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	if (self->session_hours == session_hours)
+		return;
+
+	self->session_hours = session_hours;
+	resolve_rules (self);
+	g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_SESSION_HOURS]);
+}
+
+/**
+ * classlimit_roster_get_policies:
+ * @self: a #ClasslimitRoster
+ *
+ * Gets the attendance policies, see classlimit_policy_set_new() for
+ * the format.
+ *
+ * Returns: (transfer none): an `a(ssiii)` list of policies
+ */
+GVariant *
+classlimit_roster_get_policies (ClasslimitRoster *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), NULL);
+
+	return self->policies;
+}
+
+/**
+ * classlimit_roster_set_policies:
+ * @self: a #ClasslimitRoster
+ * @policies: an `a(ssiii)` list of policies
+ *
+ * Replaces the attendance policies. Only subjects that end up under a
+ * rule with different thresholds are recomputed by the next
+ * calculation.
+ */
+void
+classlimit_roster_set_policies (ClasslimitRoster *self,
+                                GVariant         *policies)
+{
+	g_autoptr(GVariant) owned = NULL;
+	g_autoptr(ClasslimitPolicySet) old_set = NULL;
+	const ClasslimitRule *old_rules;
+	const ClasslimitRule *rules;
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (g_variant_is_of_type (policies, G_VARIANT_TYPE ("a(ssiii)")));
+
+	owned = g_variant_ref_sink (policies);
+	if (g_variant_equal (self->policies, owned))
+		return;
+
+	g_clear_pointer (&self->policies, g_variant_unref);
+	self->policies = g_steal_pointer (&owned);
+
+	old_set = g_steal_pointer (&self->policy_set);
+	self->policy_set = classlimit_policy_set_new (self->policies);
+	classlimit_policy_set_resolve (self->policy_set, self->required_attendance,
+	                               self->total_weeks, self->session_hours);
+
+	old_rules = classlimit_policy_set_get_rules (old_set);
+	rules = classlimit_policy_set_get_rules (self->policy_set);
+	for (i = 0; i < self->subjects->len; i++) {
+		ClasslimitSubject *s = g_ptr_array_index (self->subjects, i);
+		guint policy = classlimit_policy_set_match (self->policy_set, classlimit_subject_get_name (s));
+
+		if (!classlimit_rule_equal (&old_rules[classlimit_subject_get_policy (s)], &rules[policy])) {
+			classlimit_subject_invalidate_results (s);
+			self->totals_valid = FALSE;
+		}
+		classlimit_subject_set_policy (s, policy);
+	}
+}
+
+/**
+ * classlimit_roster_get_rule:
+ * @self: a #ClasslimitRoster
+ * @subject: a subject in @self
+ *
+ * Gets the resolved rule @subject is evaluated against.
+ *
+ * Returns: (transfer none): the rule, valid until the policies or
+ *   parameters change
+ */
+const ClasslimitRule *
+classlimit_roster_get_rule (ClasslimitRoster  *self,
+                            ClasslimitSubject *subject)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), NULL);
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (subject), NULL);
+
+	return get_rule (self, subject);
+}
+
+ClasslimitSubject *
+classlimit_roster_get_subject (ClasslimitRoster *self,
+                               guint             position)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), NULL);
+
+	if (position >= self->subjects->len)
+		return NULL;
+
+	return g_ptr_array_index (self->subjects, position);
+}
+
+gboolean
+classlimit_roster_find (ClasslimitRoster  *self,
+                        ClasslimitSubject *subject,
+                        guint             *position)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), FALSE);
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (subject), FALSE);
+
+	return g_ptr_array_find (self->subjects, subject, position);
+}
+
+void
+classlimit_roster_append (ClasslimitRoster  *self,
+                          ClasslimitSubject *subject)
+{
+	ClasslimitSubject *additions[1];
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (CLASSLIMIT_IS_SUBJECT (subject));
+
+	additions[0] = g_object_ref (subject);
+	splice (self, self->subjects->len, 0, additions, 1);
+}
+
+/**
+ * classlimit_roster_append_many:
+ * @self: a #ClasslimitRoster
+ * @subjects: (array length=n_subjects): subjects to append
+ * @n_subjects: the number of subjects
+ *
+ * Appends @subjects with a single items-changed.
+ */
+void
+classlimit_roster_append_many (ClasslimitRoster   *self,
+                               ClasslimitSubject **subjects,
+                               guint               n_subjects)
+{
+	g_autofree ClasslimitSubject **additions = NULL;
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (subjects != NULL || n_subjects == 0);
+
+	if (n_subjects == 0)
+		return;
+
+	additions = g_new (ClasslimitSubject *, n_subjects);
+	for (i = 0; i < n_subjects; i++)
+		additions[i] = g_object_ref (subjects[i]);
+	splice (self, self->subjects->len, 0, additions, n_subjects);
+}
+
+/**
+ * classlimit_roster_set_subjects:
+ * @self: a #ClasslimitRoster
+ * @subjects: (array length=n_subjects): the new subjects
+ * @n_subjects: the number of subjects
+ *
+ * Replaces every subject with @subjects, keeping the parameters, with
+ * a single items-changed.
+ */
+void
+classlimit_roster_set_subjects (ClasslimitRoster   *self,
+                                ClasslimitSubject **subjects,
+                                guint               n_subjects)
+{
+	g_autofree ClasslimitSubject **additions = NULL;
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (subjects != NULL || n_subjects == 0);
+
+	additions = g_new (ClasslimitSubject *, MAX (n_subjects, 1));
+	for (i = 0; i < n_subjects; i++)
+		additions[i] = g_object_ref (subjects[i]);
+	splice (self, 0, self->subjects->len, additions, n_subjects);
+}
+
+void
+classlimit_roster_remove (ClasslimitRoster *self,
+                          guint             position)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (position < self->subjects->len);
+
+	splice (self, position, 1, NULL, 0);
+}
+
+void
+classlimit_roster_remove_all (ClasslimitRoster *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	if (self->subjects->len > 0)
+		splice (self, 0, self->subjects->len, NULL, 0);
+}
+
+/* In-place edits to a set of subjects are announced as one replacement
+ * of the range they span, so list views rebind and sort models re-sort
+ * once per bulk edit rather than once per subject.
+ */
+static void
+items_changed_in_place (ClasslimitRoster *self,
+                        const guint      *positions,
+                        guint             n_positions)
+{
+	guint span = positions[n_positions - 1] - positions[0] + 1;
+
+	g_list_model_items_changed (G_LIST_MODEL (self), positions[0], span, span);
+}
+
+/**
+ * classlimit_roster_add_skips:
+ * @self: a #ClasslimitRoster
+ * @positions: (array length=n_positions): ascending subject positions
+ * @n_positions: the number of positions
+ * @delta: skips to add, may be negative
+ *
+ * Adds @delta to the skip count of every subject in @positions.
+ */
+void
+classlimit_roster_add_skips (ClasslimitRoster *self,
+                             const guint      *positions,
+                             guint             n_positions,
+                             int               delta)
+{
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (positions != NULL || n_positions == 0);
+
+	if (n_positions == 0 || delta == 0)
+		return;
+
+	for (i = 0; i < n_positions; i++) {
+		ClasslimitSubject *s = g_ptr_array_index (self->subjects, positions[i]);
+
+		classlimit_subject_set_current_skips (s, classlimit_subject_get_current_skips (s) + delta);
+	}
+
+	items_changed_in_place (self, positions, n_positions);
+}
+
+void
+classlimit_roster_reset_skips (ClasslimitRoster *self,
+                               const guint      *positions,
+                               guint             n_positions)
+{
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (positions != NULL || n_positions == 0);
+
+	if (n_positions == 0)
+		return;
+
+	for (i = 0; i < n_positions; i++)
+		classlimit_subject_set_current_skips (g_ptr_array_index (self->subjects, positions[i]), 0);
+
+	items_changed_in_place (self, positions, n_positions);
+}
+
+void
+classlimit_roster_set_weekly_hours (ClasslimitRoster *self,
+                                    const guint      *positions,
+                                    guint             n_positions,
+                                    int               weekly_hours)
+{
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (positions != NULL || n_positions == 0);
+
+	if (n_positions == 0)
+		return;
+
+	/* Only these subjects are recomputed by the next calculation */
+	for (i = 0; i < n_positions; i++)
+		classlimit_subject_set_weekly_hours (g_ptr_array_index (self->subjects, positions[i]), weekly_hours);
+	self->totals_valid = FALSE;
+
+	items_changed_in_place (self, positions, n_positions);
+}
+
+/**
+ * classlimit_roster_remove_many:
+ * @self: a #ClasslimitRoster
+ * @positions: (array length=n_positions): ascending subject positions
+ * @n_positions: the number of positions
+ *
+ * Removes the subjects at @positions in a single pass over the roster,
+ * with one items-changed covering the range they spanned.
+ */
+void
+classlimit_roster_remove_many (ClasslimitRoster *self,
+                               const guint      *positions,
+                               guint             n_positions)
+{
+	guint first, span;
+	guint i, j, k;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (positions != NULL || n_positions == 0);
+
+	if (n_positions == 0)
+		return;
+
+	first = positions[0];
+	span = positions[n_positions - 1] - first + 1;
+
+	/* Compact the survivors down over the removed subjects; the free
+	 * function is off so shrinking does not drop the moved references.
+	 */
+	g_ptr_array_set_free_func (self->subjects, NULL);
+	for (i = j = first, k = 0; i < self->subjects->len; i++) {
+		if (k < n_positions && positions[k] == i) {
+			g_object_unref (g_ptr_array_index (self->subjects, i));
+			k++;
+		} else {
+			self->subjects->pdata[j++] = self->subjects->pdata[i];
+		}
+	}
+	g_ptr_array_set_size (self->subjects, j);
+	g_ptr_array_set_free_func (self->subjects, g_object_unref);
+
+	self->totals_valid = FALSE;
+
+	g_list_model_items_changed (G_LIST_MODEL (self), first, span, span - n_positions);
+	g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_ITEMS]);
+}
+
+void
+classlimit_roster_reset (ClasslimitRoster *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	g_object_freeze_notify (G_OBJECT (self));
+	classlimit_roster_remove_all (self);
+	classlimit_roster_set_required_attendance (self, DEFAULT_REQUIRED_ATTENDANCE);
+	classlimit_roster_set_total_weeks (self, DEFAULT_TOTAL_WEEKS);
+	classlimit_roster_set_session_hours (self, DEFAULT_SESSION_HOURS);
+	classlimit_roster_set_policies (self, g_variant_new_array (G_VARIANT_TYPE ("(ssiii)"), NULL, 0));
+	g_object_thaw_notify (G_OBJECT (self));
+}
+
+/* Only subjects whose inputs changed since the last run are recomputed,
+ * and the totals are only summed again if anything did. Each subject
+ * is evaluated against its pre-resolved rule.
+ */
+void
+classlimit_roster_calculate (ClasslimitRoster *self,
+                             ClasslimitTotals *totals)
+{
+	const ClasslimitRule *rules;
+	int total_allowed_all = 0;
+	int total_classes_all = 0;
+	int allowed_sessions_all = 0;
+	int total_sessions_all = 0;
+	gboolean changed = !self->totals_valid;
+	guint first_changed = G_MAXUINT;
+	guint last_changed = 0;
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	rules = classlimit_policy_set_get_rules (self->policy_set);
+
+	for (i = 0; i < self->subjects->len; i++) {
+		ClasslimitSubject *s = g_ptr_array_index (self->subjects, i);
+
+		if (!classlimit_subject_get_results_valid (s)) {
+			int total_classes;
+			int allowed_skips = classlimit_rule_evaluate (&rules[classlimit_subject_get_policy (s)],
+			                                              classlimit_subject_get_weekly_hours (s),
+			                                              &total_classes);
+
+			classlimit_subject_set_results (s, total_classes, allowed_skips);
+			first_changed = MIN (first_changed, i);
+			last_changed = i;
+			changed = TRUE;
+		}
+	}
+
+	/* Views sorted by allowance re-sort just the recomputed range */
+	if (first_changed != G_MAXUINT)
+		g_list_model_items_changed (G_LIST_MODEL (self), first_changed,
+		                            last_changed - first_changed + 1,
+		                            last_changed - first_changed + 1);
+
+	/* Sessions are summed per subject, each in those of its own rule */
+	if (changed) {
+		for (i = 0; i < self->subjects->len; i++) {
+			ClasslimitSubject *s = g_ptr_array_index (self->subjects, i);
+			const ClasslimitRule *rule = &rules[classlimit_subject_get_policy (s)];
+			int total_classes = classlimit_subject_get_total_classes (s);
+
+			total_classes_all += total_classes;
+			total_allowed_all += (total_classes * rule->allowed_pct) / 100;
+			total_sessions_all += total_classes / rule->session_hours;
+			allowed_sessions_all += classlimit_subject_get_allowed_skips (s);
+		}
+
+		self->totals.total_classes = total_classes_all;
+		self->totals.allowed_skips = total_allowed_all;
+		self->totals.total_sessions = total_sessions_all;
+		self->totals.allowed_sessions = allowed_sessions_all;
+		self->totals_valid = TRUE;
+	}
+
+	if (totals)
+		*totals = self->totals;
+
+	g_signal_emit (self, signals [CALCULATED], 0);
+}
+
+/**
+ * classlimit_roster_get_totals:
+ * @self: a #ClasslimitRoster
+ * @totals: (out) (optional): return location for the totals
+ *
+ * Gets the totals of the last calculation, if it still matches the
+ * current subjects and parameters.
+ *
+ * Returns: %TRUE if the results are up to date
+ */
+gboolean
+classlimit_roster_get_totals (ClasslimitRoster *self,
+                              ClasslimitTotals *totals)
+{
+	guint i;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), FALSE);
+
+	if (!self->totals_valid)
+		return FALSE;
+
+	for (i = 0; i < self->subjects->len; i++) {
+		if (!classlimit_subject_get_results_valid (g_ptr_array_index (self->subjects, i)))
+			return FALSE;
+	}
+
+	if (totals)
+		*totals = self->totals;
+
+	return TRUE;
+}
+
+/* Reuses whatever cached per-subject results still match their inputs.
+ * The entries are stored in roster order, so the lookup table is only
+ * needed once subjects have been added, removed or changed.
+ */
+static void
+apply_results_cache (ClasslimitRoster *self,
+                     GSettings        *settings)
+{
+	g_autoptr(GVariant) cache = NULL;
+	g_autoptr(GVariant) entries = NULL;
+	g_autoptr(GHashTable) by_key = NULL;
+	g_autofree guint64 *keys = NULL;
+	ClasslimitTotals totals;
+	guint64 hash;
+	gsize n_entries;
+	guint i;
+
+	cache = g_settings_get_value (settings, "results-cache");
+	g_variant_get (cache, "(t(iiii)@a(tii))", &hash,
+	               &totals.total_classes, &totals.allowed_skips,
+	               &totals.total_sessions, &totals.allowed_sessions,
+	               &entries);
+
+	/* Never calculated, so there is nothing to show yet */
+	if (hash == 0)
+		return;
+
+	n_entries = g_variant_n_children (entries);
+	for (i = 0; i < self->subjects->len; i++) {
+		ClasslimitSubject *s = g_ptr_array_index (self->subjects, i);
+		guint64 key = subject_key (self, s);
+		guint64 entry_key;
+		int total_classes, allowed_skips;
+		gsize j = i;
+
+		if (i < n_entries)
+			g_variant_get_child (entries, i, "(tii)", &entry_key, NULL, NULL);
+		if (i >= n_entries || entry_key != key) {
+			gpointer index;
+
+			if (by_key == NULL) {
+				keys = g_new (guint64, n_entries);
+				by_key = g_hash_table_new (g_int64_hash, g_int64_equal);
+				for (j = 0; j < n_entries; j++) {
+					g_variant_get_child (entries, j, "(tii)", &keys[j], NULL, NULL);
+					g_hash_table_insert (by_key, &keys[j], GSIZE_TO_POINTER (j + 1));
+				}
+			}
+			index = g_hash_table_lookup (by_key, &key);
+			if (index == NULL)
+				continue;
+			j = GPOINTER_TO_SIZE (index) - 1;
+		}
+
+		g_variant_get_child (entries, j, "(tii)", NULL, &total_classes, &allowed_skips);
+		classlimit_subject_set_results (s, total_classes, allowed_skips);
+	}
+
+	if (hash == input_hash (self)) {
+		self->totals = totals;
+		self->totals_valid = TRUE;
+		self->cache_hash = hash;
+	} else {
+		/* Fill in whatever changed since the cache was written */
+		classlimit_roster_calculate (self, NULL);
+	}
+}
+
+/**
+ * classlimit_roster_save_results:
+ * @self: a #ClasslimitRoster
+ *
+ * Stores the results of the last calculation together with a hash of
+ * their inputs, so the next launch can show them without recalculating.
+ */
+void
+classlimit_roster_save_results (ClasslimitRoster *self)
+{
+	GVariantBuilder builder;
+	guint64 hash;
+	guint i;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	if (self->settings == NULL || !classlimit_roster_get_totals (self, NULL))
+		return;
+
+	hash = input_hash (self);
+	if (hash == self->cache_hash)
+		return;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(tii)"));
+	for (i = 0; i < self->subjects->len; i++) {
+		ClasslimitSubject *s = g_ptr_array_index (self->subjects, i);
+
+		g_variant_builder_add (&builder, "(tii)", subject_key (self, s),
+			classlimit_subject_get_total_classes (s),
+			classlimit_subject_get_allowed_skips (s));
+	}
+
+	g_settings_set_value (self->settings, "results-cache",
+		g_variant_new ("(t(iiii)a(tii))", hash,
+		               self->totals.total_classes, self->totals.allowed_skips,
+		               self->totals.total_sessions, self->totals.allowed_sessions,
+		               &builder));
+	self->cache_hash = hash;
+}
+
+static ClasslimitSubject *
+subject_from_record (const char *name,
+                     int         weekly_hours,
+                     int         current_skips,
+                     int         allowed_skips)
+{
+	ClasslimitSubject *s = classlimit_subject_new (name, weekly_hours);
+
+	/* Keep the stored allowance on screen until the next calculation */
+	classlimit_subject_set_current_skips (s, current_skips);
+	classlimit_subject_set_results (s, 0, allowed_skips);
+	classlimit_subject_invalidate_results (s);
+
+	return s;
+}
+
+/* Splices the incoming records in [first, first + n_added) over the
+ * n_removed subjects at position.
+ */
+static void
+splice_records (ClasslimitRoster *self,
+                guint             position,
+                guint             n_removed,
+                GVariant         *records,
+                gsize             first,
+                gsize             n_added)
+{
+	g_autofree ClasslimitSubject **additions = g_new (ClasslimitSubject *, n_added);
+	gsize i;
+
+	if (n_removed == 0 && n_added == 0)
+		return;
+
+	for (i = 0; i < n_added; i++) {
+		const char *name;
+		int weekly_hours, current_skips, allowed_skips;
+
+		g_variant_get_child (records, first + i, "(&siii)",
+		                     &name, &weekly_hours, &current_skips, &allowed_skips);
+		additions[i] = subject_from_record (name, weekly_hours, current_skips, allowed_skips);
+	}
+
+	splice (self, position, n_removed, additions, n_added);
+}
+
+/**
+ * classlimit_roster_merge_subjects:
+ * @self: a #ClasslimitRoster
+ * @records: an `a(siii)` list of subjects, as stored in GSettings
+ *
+ * Makes the roster match @records while keeping the subjects it
+ * already has. Subjects are matched by name, and the n-th subject of a
+ * given name by occurrence, so only the ones that were actually added,
+ * removed or edited produce list or property notifications. A reorder
+ * falls back to replacing the whole list with the same objects.
+ *
+ * Returns: %TRUE if anything changed
+ */
+gboolean
+classlimit_roster_merge_subjects (ClasslimitRoster *self,
+                                  GVariant         *records)
+{
+	g_autoptr(GHashTable) first_by_name = NULL;
+	g_autofree int *next_same = NULL;
+	g_autofree int *matches = NULL;
+	g_autoptr(GArray) updated = NULL;
+	gboolean in_order = TRUE;
+	gboolean changed = FALSE;
+	gsize n_records;
+	guint n_subjects;
+	guint position;
+	guint i, run;
+	gsize j, run_start;
+	int last = -1;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), FALSE);
+	g_return_val_if_fail (g_variant_is_of_type (records, G_VARIANT_TYPE ("a(siii)")), FALSE);
+
+	n_records = g_variant_n_children (records);
+	n_subjects = self->subjects->len;
+
+	/* Chain same-named subjects in order so duplicates pair up by occurrence */
+	first_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+	next_same = g_new (int, n_subjects);
+	for (i = n_subjects; i-- > 0;) {
+		const char *name = classlimit_subject_get_name (g_ptr_array_index (self->subjects, i));
+
+		next_same[i] = GPOINTER_TO_INT (g_hash_table_lookup (first_by_name, name)) - 1;
+		g_hash_table_insert (first_by_name, (gpointer) name, GINT_TO_POINTER (i + 1));
+	}
+
+	matches = g_new (int, n_records);
+	for (j = 0; j < n_records; j++) {
+		const char *name;
+		int match;
+
+		g_variant_get_child (records, j, "(&siii)", &name, NULL, NULL, NULL);
+		match = GPOINTER_TO_INT (g_hash_table_lookup (first_by_name, name)) - 1;
+		if (match >= 0) {
+			if (next_same[match] >= 0)
+				g_hash_table_insert (first_by_name, (gpointer) classlimit_subject_get_name (
+					g_ptr_array_index (self->subjects, match)), GINT_TO_POINTER (next_same[match] + 1));
+			else
+				g_hash_table_remove (first_by_name, name);
+			in_order &= match > last;
+			last = match;
+		}
+		matches[j] = match;
+	}
+
+	g_object_freeze_notify (G_OBJECT (self));
+
+	/* Field updates first, while matches still index the old array */
+	updated = g_array_new (FALSE, FALSE, sizeof (guint));
+	for (j = 0; j < n_records; j++) {
+		ClasslimitSubject *s;
+		int weekly_hours, current_skips;
+		guint match;
+
+		if (matches[j] < 0)
+			continue;
+
+		match = matches[j];
+		s = g_ptr_array_index (self->subjects, match);
+		g_variant_get_child (records, j, "(&siii)", NULL, &weekly_hours, &current_skips, NULL);
+		if (classlimit_subject_get_weekly_hours (s) != weekly_hours) {
+			classlimit_subject_set_weekly_hours (s, weekly_hours);
+			self->totals_valid = FALSE;
+		} else if (classlimit_subject_get_current_skips (s) == current_skips) {
+			continue;
+		}
+		classlimit_subject_set_current_skips (s, current_skips);
+		g_array_append_val (updated, match);
+	}
+	changed = updated->len > 0;
+
+	if (!in_order) {
+		g_autofree ClasslimitSubject **additions = g_new (ClasslimitSubject *, n_records);
+
+		for (j = 0; j < n_records; j++) {
+			if (matches[j] >= 0) {
+				additions[j] = g_object_ref (g_ptr_array_index (self->subjects, matches[j]));
+			} else {
+				const char *name;
+				int weekly_hours, current_skips, allowed_skips;
+
+				g_variant_get_child (records, j, "(&siii)",
+				                     &name, &weekly_hours, &current_skips, &allowed_skips);
+				additions[j] = subject_from_record (name, weekly_hours, current_skips, allowed_skips);
+			}
+		}
+		splice (self, 0, n_subjects, additions, n_records);
+		g_object_thaw_notify (G_OBJECT (self));
+
+		return TRUE;
+	}
+
+	/* Kept subjects are in order here, so the edited ones are too; each
+	 * run of neighbours is announced before the splices move them.
+	 */
+	for (i = 0; i < updated->len; i += run) {
+		const guint *first = &g_array_index (updated, guint, i);
+
+		for (run = 1; i + run < updated->len && first[run] == first[0] + run; run++)
+			;
+		items_changed_in_place (self, first, run);
+	}
+
+	/* Between two kept subjects everything old goes and everything new
+	 * comes in, as one splice per changed stretch.
+	 */
+	position = 0;
+	i = 0;
+	run_start = 0;
+	for (j = 0; j < n_records; j++) {
+		guint n_removed, n_added;
+
+		if (matches[j] < 0)
+			continue;
+
+		n_removed = matches[j] - i;
+		n_added = j - run_start;
+		splice_records (self, position, n_removed, records, run_start, n_added);
+		changed |= n_removed > 0 || n_added > 0;
+
+		position += n_added + 1;
+		i = matches[j] + 1;
+		run_start = j + 1;
+	}
+	if (i < n_subjects || run_start < n_records) {
+		splice_records (self, position, n_subjects - i, records, run_start, n_records - run_start);
+		changed = TRUE;
+	}
+
+	g_object_thaw_notify (G_OBJECT (self));
+
+	return changed;
+}
+
+/* Negative parameters and %NULL lists are left alone */
+static GVariant *
+new_change (int       required_attendance,
+            int       total_weeks,
+            int       session_hours,
+            GVariant *records,
+            GVariant *policies)
+{
+	return g_variant_ref_sink (g_variant_new ("(iiim@a(siii)m@a(ssiii))",
+		required_attendance, total_weeks, session_hours, records, policies));
+}
+
+/**
+ * classlimit_roster_merge:
+ * @self: a #ClasslimitRoster
+ * @change: a `(iiima(siii)ma(ssiii))` change: the required attendance,
+ *   total weeks and hours per session, each negative to keep the
+ *   current one, then optionally the subjects as records for
+ *   classlimit_roster_merge_subjects() and the policies
+ *
+ * Applies a change made outside the application, such as an edit to a
+ * linked file, as one transaction, and emits #ClasslimitRoster::merged
+ * if anything changed.
+ *
+ * Returns: %TRUE if anything changed
+ */
+gboolean
+classlimit_roster_merge (ClasslimitRoster *self,
+                         GVariant         *change)
+{
+	g_autoptr(GVariant) owned = NULL;
+	g_autoptr(GVariant) records = NULL;
+	g_autoptr(GVariant) policies = NULL;
+	int required_attendance, total_weeks, session_hours;
+	gboolean changed = FALSE;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), FALSE);
+	g_return_val_if_fail (g_variant_is_of_type (change, G_VARIANT_TYPE ("(iiima(siii)ma(ssiii))")), FALSE);
+
+	owned = g_variant_ref_sink (change);
+	g_variant_get (owned, "(iiim@a(siii)m@a(ssiii))", &required_attendance, &total_weeks,
+	               &session_hours, &records, &policies);
+
+	classlimit_roster_begin (self);
+	if (required_attendance >= 0 && required_attendance != self->required_attendance) {
+		classlimit_roster_set_required_attendance (self, required_attendance);
+		changed = TRUE;
+	}
+	if (total_weeks >= 0 && total_weeks != self->total_weeks) {
+		classlimit_roster_set_total_weeks (self, total_weeks);
+		changed = TRUE;
+	}
+	if (session_hours >= 0 && session_hours != self->session_hours) {
+		classlimit_roster_set_session_hours (self, session_hours);
+		changed = TRUE;
+	}
+	if (policies && !g_variant_equal (policies, self->policies)) {
+		classlimit_roster_set_policies (self, policies);
+		changed = TRUE;
+	}
+	if (records)
+		changed |= classlimit_roster_merge_subjects (self, records);
+	classlimit_roster_commit (self);
+
+	if (changed)
+		g_signal_emit (self, signals [MERGED], 0, owned);
+
+	return changed;
+}
+
+static void
+on_settings_changed (GSettings        *settings,
+                     const char       *key,
+                     ClasslimitRoster *self)
+{
+	g_autoptr(GVariant) change = NULL;
+	gboolean changed = FALSE;
+
+	/* Our own writes come back through here too */
+	if (self->saving)
+		return;
+
+	if (g_str_equal (key, "subjects")) {
+		g_autoptr(GVariant) records = g_settings_get_value (settings, key);
+
+		changed = classlimit_roster_merge_subjects (self, records);
+		change = new_change (-1, -1, -1, records, NULL);
+	} else if (g_str_equal (key, "policies")) {
+		g_autoptr(GVariant) policies = g_settings_get_value (settings, key);
+
+		changed = !g_variant_equal (policies, self->policies);
+		classlimit_roster_set_policies (self, policies);
+		change = new_change (-1, -1, -1, NULL, policies);
+	} else if (g_str_equal (key, "required-attendance")) {
+		int value = g_settings_get_int (settings, key);
+
+		changed = value != self->required_attendance;
+		classlimit_roster_set_required_attendance (self, value);
+		change = new_change (value, -1, -1, NULL, NULL);
+	} else if (g_str_equal (key, "total-weeks")) {
+		int value = g_settings_get_int (settings, key);
+
+		changed = value != self->total_weeks;
+		classlimit_roster_set_total_weeks (self, value);
+		change = new_change (-1, value, -1, NULL, NULL);
+	} else if (g_str_equal (key, "session-hours")) {
+		int value = g_settings_get_int (settings, key);
+
+		changed = value != self->session_hours;
+		classlimit_roster_set_session_hours (self, value);
+		change = new_change (-1, -1, value, NULL, NULL);
+	}
+
+	/* Already persisted, so views just need to catch up */
+	if (changed) {
+		g_signal_emit (self, signals [CHANGED], 0);
+		g_signal_emit (self, signals [MERGED], 0, change);
+	}
+}
+
+void
+classlimit_roster_load (ClasslimitRoster *self,
+                        GSettings        *settings)
+{
+	g_autoptr(GVariant) subjects_var = NULL;
+	g_autoptr(GVariant) policies = NULL;
+	g_autoptr(GPtrArray) loaded = NULL;
+	GVariantIter iter;
+	const gchar *name;
+	gint weekly_hours, current_skips, allowed_skips;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (G_IS_SETTINGS (settings));
+
+	if (self->settings != settings) {
+		if (self->settings)
+			g_clear_signal_handler (&self->settings_changed_id, self->settings);
+		g_set_object (&self->settings, settings);
+		self->settings_changed_id = g_signal_connect (settings, "changed",
+			G_CALLBACK (on_settings_changed), self);
+	}
+
+	subjects_var = g_settings_get_value (settings, "subjects");
+	loaded = g_ptr_array_sized_new (g_variant_n_children (subjects_var));
+
+	g_variant_iter_init (&iter, subjects_var);
+	while (g_variant_iter_next (&iter, "(&siii)", &name, &weekly_hours, &current_skips, &allowed_skips))
+		g_ptr_array_add (loaded, subject_from_record (name, weekly_hours, current_skips, allowed_skips));
+
+	g_object_freeze_notify (G_OBJECT (self));
+	classlimit_roster_set_required_attendance (self, g_settings_get_int (settings, "required-attendance"));
+	classlimit_roster_set_total_weeks (self, g_settings_get_int (settings, "total-weeks"));
+	classlimit_roster_set_session_hours (self, g_settings_get_int (settings, "session-hours"));
+	policies = g_settings_get_value (settings, "policies");
+	classlimit_roster_set_policies (self, policies);
+	splice (self, 0, self->subjects->len, (ClasslimitSubject **) loaded->pdata, loaded->len);
+	apply_results_cache (self, settings);
+	g_object_thaw_notify (G_OBJECT (self));
+}
+
+/**
+ * classlimit_roster_get_records:
+ * @self: a #ClasslimitRoster
+ *
+ * Gets the subjects as they are stored in GSettings.
+ *
+ * Returns: (transfer floating): an `a(siii)` list of subjects
+ */
+GVariant *
+classlimit_roster_get_records (ClasslimitRoster *self)
+{
+	GVariantBuilder builder;
+	guint i;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(siii)"));
+	for (i = 0; i < self->subjects->len; i++) {
+		ClasslimitSubject *s = g_ptr_array_index (self->subjects, i);
+
+		g_variant_builder_add (&builder, "(siii)",
+			classlimit_subject_get_name (s),
+			classlimit_subject_get_weekly_hours (s),
+			classlimit_subject_get_current_skips (s),
+			classlimit_subject_get_allowed_skips (s));
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+void
+classlimit_roster_save (ClasslimitRoster *self,
+                        GSettings        *settings)
+{
+	g_autoptr(GVariant) policies = NULL;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (G_IS_SETTINGS (settings));
+
+	self->saving = TRUE;
+
+	g_settings_set_value (settings, "subjects", classlimit_roster_get_records (self));
+
+	policies = g_settings_get_value (settings, "policies");
+	if (!g_variant_equal (policies, self->policies))
+		g_settings_set_value (settings, "policies", self->policies);
+
+	/* Reads come from the GSettings cache, writes go out to dconf */
+	if (g_settings_get_int (settings, "required-attendance") != self->required_attendance)
+		g_settings_set_int (settings, "required-attendance", self->required_attendance);
+	if (g_settings_get_int (settings, "total-weeks") != self->total_weeks)
+		g_settings_set_int (settings, "total-weeks", self->total_weeks);
+	if (g_settings_get_int (settings, "session-hours") != self->session_hours)
+		g_settings_set_int (settings, "session-hours", self->session_hours);
+
+	self->saving = FALSE;
+}
+
+/**
+ * classlimit_roster_begin:
+ * @self: a #ClasslimitRoster
+ *
+ * Starts a transaction. Transactions nest, and only committing the
+ * outermost one saves and emits #ClasslimitRoster::changed.
+ */
+void
+classlimit_roster_begin (ClasslimitRoster *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	self->transaction_depth++;
+}
+
+/**
+ * classlimit_roster_commit:
+ * @self: a #ClasslimitRoster
+ *
+ * Ends a transaction started with classlimit_roster_begin(). The
+ * outermost commit writes the roster to the settings it was loaded
+ * from once, however many changes the transaction made.
+ */
+void
+classlimit_roster_commit (ClasslimitRoster *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (self->transaction_depth > 0);
+
+	if (--self->transaction_depth > 0)
+		return;
+
+	self->save_pending = self->settings != NULL;
+	if (self->save_holds == 0)
+		classlimit_roster_flush (self);
+
+	g_signal_emit (self, signals [CHANGED], 0);
+}
+
+/**
+ * classlimit_roster_hold_saves:
+ * @self: a #ClasslimitRoster
+ *
+ * Stops commits from writing to the settings until the matching
+ * classlimit_roster_release_saves(), for bulk work that commits often.
+ * Changes are still announced as they are committed.
+ */
+void
+classlimit_roster_hold_saves (ClasslimitRoster *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	self->save_holds++;
+}
+
+/**
+ * classlimit_roster_release_saves:
+ * @self: a #ClasslimitRoster
+ *
+ * Undoes classlimit_roster_hold_saves(). Releasing the last hold saves
+ * whatever was committed meanwhile.
+ */
+void
+classlimit_roster_release_saves (ClasslimitRoster *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+	g_return_if_fail (self->save_holds > 0);
+
+	if (--self->save_holds == 0)
+		classlimit_roster_flush (self);
+}
+
+/**
+ * classlimit_roster_flush:
+ * @self: a #ClasslimitRoster
+ *
+ * Saves commits that were held back, even while saves are held.
+ */
+void
+classlimit_roster_flush (ClasslimitRoster *self)
+{
+	gint64 begin;
+
+	g_return_if_fail (CLASSLIMIT_IS_ROSTER (self));
+
+	if (!self->save_pending || self->settings == NULL)
+		return;
+
+	self->save_pending = FALSE;
+	begin = classlimit_profiler_begin ();
+	classlimit_roster_save (self, self->settings);
+	classlimit_profiler_end (CLASSLIMIT_PROBE_SAVE, begin, self->subjects->len);
+}
+
+static JsonObject *
+parse_root (JsonParser  *parser,
+            const char  *data,
+            gsize        length,
+            GError     **error)
+{
+	JsonNode *root;
+	JsonObject *obj;
+
+	if (!json_parser_load_from_data (parser, data, length, error))
+		return NULL;
+
+	root = json_parser_get_root (parser);
+	obj = root && JSON_NODE_HOLDS_OBJECT (root) ? json_node_get_object (root) : NULL;
+	if (obj == NULL ||
+	    !json_object_has_member (obj, "subjects") ||
+	    !JSON_NODE_HOLDS_ARRAY (json_object_get_member (obj, "subjects"))) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		                     "Expected an object with a \"subjects\" array");
+		return NULL;
+	}
+
+	return obj;
+}
+
+static GPtrArray *
+parse_subjects (JsonObject *obj)
+{
+	JsonArray *subjects = json_object_get_array_member (obj, "subjects");
+	GPtrArray *imported = g_ptr_array_new_full (json_array_get_length (subjects), g_object_unref);
+	guint i;
+
+	for (i = 0; i < json_array_get_length (subjects); i++) {
+		JsonNode *node = json_array_get_element (subjects, i);
+		JsonObject *subj_obj;
+		const char *name;
+		ClasslimitSubject *s;
+
+		if (!JSON_NODE_HOLDS_OBJECT (node))
+			continue;
+		subj_obj = json_node_get_object (node);
+		name = json_object_has_member (subj_obj, "name") ?
+			json_object_get_string_member (subj_obj, "name") : NULL;
+		if (name == NULL)
+			continue;
+
+		s = classlimit_subject_new (name,
+			json_object_has_member (subj_obj, "weekly_hours") ?
+				json_object_get_int_member (subj_obj, "weekly_hours") : 0);
+		if (json_object_has_member (subj_obj, "current_skips"))
+			classlimit_subject_set_current_skips (s, json_object_get_int_member (subj_obj, "current_skips"));
+		g_ptr_array_add (imported, s);
+	}
+
+	return imported;
+}
+
+/**
+ * classlimit_roster_parse_json:
+ * @data: the contents of an exported roster
+ * @length: the length of @data
+ * @error: return location for a #GError
+ *
+ * Parses the subjects out of an export without touching any roster,
+ * so it is safe to call from worker threads.
+ *
+ * Returns: (transfer full) (element-type ClasslimitSubject): the subjects,
+ *   or %NULL on error
+ */
+GPtrArray *
+classlimit_roster_parse_json (const char  *data,
+                              gsize        length,
+                              GError     **error)
+{
+	g_autoptr(JsonParser) parser = NULL;
+	JsonObject *obj;
+
+	g_return_val_if_fail (data != NULL, NULL);
+
+	parser = json_parser_new_immutable ();
+	obj = parse_root (parser, data, length, error);
+	if (obj == NULL)
+		return NULL;
+
+	return parse_subjects (obj);
+}
+
+static int
+get_int_member (JsonObject *obj,
+                const char *member)
+{
+	return json_object_has_member (obj, member) ? json_object_get_int_member (obj, member) : -1;
+}
+
+/**
+ * classlimit_roster_parse_json_records:
+ * @data: the contents of an exported roster
+ * @length: the length of @data
+ * @required_attendance: (out): the required attendance, or -1 if not set
+ * @total_weeks: (out): the number of weeks, or -1 if not set
+ * @session_hours: (out): the session length, or -1 if not set
+ * @error: return location for a #GError
+ *
+ * Like classlimit_roster_parse_json(), but returns the subjects as
+ * records for classlimit_roster_merge_subjects() rather than as
+ * objects, so that a large file costs no more than its changes.
+ *
+ * Returns: (transfer full): an `a(siii)` list of subjects, or %NULL on error
+ */
+GVariant *
+classlimit_roster_parse_json_records (const char  *data,
+                                      gsize        length,
+                                      int         *required_attendance,
+                                      int         *total_weeks,
+                                      int         *session_hours,
+                                      GError     **error)
+{
+	g_autoptr(JsonParser) parser = NULL;
+	GVariantBuilder builder;
+	JsonObject *obj;
+	JsonArray *subjects;
+	guint i;
+
+	g_return_val_if_fail (data != NULL, NULL);
+
+	parser = json_parser_new_immutable ();
+	obj = parse_root (parser, data, length, error);
+	if (obj == NULL)
+		return NULL;
+
+	*required_attendance = get_int_member (obj, "required_attendance");
+	*total_weeks = get_int_member (obj, "total_weeks");
+	*session_hours = get_int_member (obj, "session_hours");
+
+	subjects = json_object_get_array_member (obj, "subjects");
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(siii)"));
+	for (i = 0; i < json_array_get_length (subjects); i++) {
+		JsonNode *node = json_array_get_element (subjects, i);
+		JsonObject *subj_obj;
+		const char *name;
+
+		if (!JSON_NODE_HOLDS_OBJECT (node))
+			continue;
+		subj_obj = json_node_get_object (node);
+		name = json_object_has_member (subj_obj, "name") ?
+			json_object_get_string_member (subj_obj, "name") : NULL;
+		if (name == NULL)
+			continue;
+
+		g_variant_builder_add (&builder, "(siii)", name,
+			MAX (get_int_member (subj_obj, "weekly_hours"), 0),
+			MAX (get_int_member (subj_obj, "current_skips"), 0),
+			0);
+	}
+
+	return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+gboolean
+classlimit_roster_import_json (ClasslimitRoster  *self,
+                               const char        *data,
+                               gsize              length,
+                               GError           **error)
+{
+	g_autoptr(JsonParser) parser = NULL;
+	g_autoptr(GPtrArray) imported = NULL;
+	JsonObject *obj;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+
+	parser = json_parser_new ();
+	obj = parse_root (parser, data, length, error);
+	if (obj == NULL)
+		return FALSE;
+
+	/* Parse everything before touching the roster so a bad file leaves it intact */
+	imported = parse_subjects (obj);
+
+	g_object_freeze_notify (G_OBJECT (self));
+	if (json_object_has_member (obj, "required_attendance"))
+		classlimit_roster_set_required_attendance (self, json_object_get_int_member (obj, "required_attendance"));
+	if (json_object_has_member (obj, "total_weeks"))
+		classlimit_roster_set_total_weeks (self, json_object_get_int_member (obj, "total_weeks"));
+	if (json_object_has_member (obj, "session_hours"))
+		classlimit_roster_set_session_hours (self, json_object_get_int_member (obj, "session_hours"));
+	g_ptr_array_set_free_func (imported, NULL);
+	splice (self, 0, self->subjects->len, (ClasslimitSubject **) imported->pdata, imported->len);
+	g_object_thaw_notify (G_OBJECT (self));
+
+	return TRUE;
+}
+
+char *
+classlimit_roster_export_json (ClasslimitRoster *self,
+                               gsize            *length)
+{
+	g_autoptr(JsonBuilder) builder = NULL;
+	g_autoptr(JsonGenerator) gen = NULL;
+	g_autoptr(JsonNode) root = NULL;
+	guint i;
+
+	g_return_val_if_fail (CLASSLIMIT_IS_ROSTER (self), NULL);
+
+	builder = json_builder_new ();
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "version");
+	json_builder_add_int_value (builder, 1);
+	json_builder_set_member_name (builder, "required_attendance");
+	json_builder_add_int_value (builder, self->required_attendance);
+	json_builder_set_member_name (builder, "total_weeks");
+	json_builder_add_int_value (builder, self->total_weeks);
+	json_builder_set_member_name (builder, "session_hours");
+	json_builder_add_int_value (builder, self->session_hours);
+	json_builder_set_member_name (builder, "subjects");
+	json_builder_begin_array (builder);
+
+	for (i = 0; i < self->subjects->len; i++) {
+		ClasslimitSubject *s = g_ptr_array_index (self->subjects, i);
+
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "name");
+		json_builder_add_string_value (builder, classlimit_subject_get_name (s));
+		json_builder_set_member_name (builder, "weekly_hours");
+		json_builder_add_int_value (builder, classlimit_subject_get_weekly_hours (s));
+		json_builder_set_member_name (builder, "current_skips");
+		json_builder_add_int_value (builder, classlimit_subject_get_current_skips (s));
+		json_builder_end_object (builder);
+	}
+
+	json_builder_end_array (builder);
+	json_builder_end_object (builder);
+
+	root = json_builder_get_root (builder);
+	gen = json_generator_new ();
+	json_generator_set_root (gen, root);
+	json_generator_set_pretty (gen, TRUE);
+
+	return json_generator_to_data (gen, length);
+}
@@ -0,0 +1,125 @@
+/* classlimit-roster.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "classlimit-policy.h"
+#include "classlimit-subject.h"
+
+G_BEGIN_DECLS
+
+#define CLASSLIMIT_TYPE_ROSTER (classlimit_roster_get_type())
+
+G_DECLARE_FINAL_TYPE (ClasslimitRoster, classlimit_roster, CLASSLIMIT, ROSTER, GObject)
+
+/* Classes are hours. Sessions add up each subject in the sessions of
+ * its own rule, so they only share a unit when the rules do.
+ */
+typedef struct {
+	int total_classes;
+	int allowed_skips;
+	int total_sessions;
+	int allowed_sessions;
+} ClasslimitTotals;
+
+ClasslimitRoster  *classlimit_roster_new                     (void);
+int                classlimit_roster_get_required_attendance (ClasslimitRoster  *self);
+void               classlimit_roster_set_required_attendance (ClasslimitRoster  *self,
+                                                              int                required_attendance);
+int                classlimit_roster_get_total_weeks         (ClasslimitRoster  *self);
+void               classlimit_roster_set_total_weeks         (ClasslimitRoster  *self,
+                                                              int                total_weeks);
+int                classlimit_roster_get_session_hours       (ClasslimitRoster  *self);
+void               classlimit_roster_set_session_hours       (ClasslimitRoster  *self,
+                                                              int                session_hours);
+GVariant          *classlimit_roster_get_policies            (ClasslimitRoster  *self);
+void               classlimit_roster_set_policies            (ClasslimitRoster  *self,
+                                                              GVariant          *policies);
+const ClasslimitRule *classlimit_roster_get_rule            (ClasslimitRoster  *self,
+                                                              ClasslimitSubject *subject);
+ClasslimitSubject *classlimit_roster_get_subject             (ClasslimitRoster  *self,
+                                                              guint              position);
+gboolean           classlimit_roster_find                    (ClasslimitRoster  *self,
+                                                              ClasslimitSubject *subject,
+                                                              guint             *position);
+void               classlimit_roster_append                  (ClasslimitRoster  *self,
+                                                              ClasslimitSubject *subject);
+void               classlimit_roster_append_many             (ClasslimitRoster  *self,
+                                                              ClasslimitSubject **subjects,
+                                                              guint              n_subjects);
+void               classlimit_roster_set_subjects            (ClasslimitRoster  *self,
+                                                              ClasslimitSubject **subjects,
+                                                              guint              n_subjects);
+void               classlimit_roster_remove                  (ClasslimitRoster  *self,
+                                                              guint              position);
+void               classlimit_roster_remove_all              (ClasslimitRoster  *self);
+void               classlimit_roster_remove_many             (ClasslimitRoster  *self,
+                                                              const guint       *positions,
+                                                              guint              n_positions);
+void               classlimit_roster_add_skips               (ClasslimitRoster  *self,
+                                                              const guint       *positions,
+                                                              guint              n_positions,
+                                                              int                delta);
+void               classlimit_roster_reset_skips             (ClasslimitRoster  *self,
+                                                              const guint       *positions,
+                                                              guint              n_positions);
+void               classlimit_roster_set_weekly_hours        (ClasslimitRoster  *self,
+                                                              const guint       *positions,
+                                                              guint              n_positions,
+                                                              int                weekly_hours);
+void               classlimit_roster_reset                   (ClasslimitRoster  *self);
+void               classlimit_roster_calculate               (ClasslimitRoster  *self,
+                                                              ClasslimitTotals  *totals);
+gboolean           classlimit_roster_get_totals              (ClasslimitRoster  *self,
+                                                              ClasslimitTotals  *totals);
+void               classlimit_roster_save_results            (ClasslimitRoster  *self);
+void               classlimit_roster_load                    (ClasslimitRoster  *self,
+                                                              GSettings         *settings);
+void               classlimit_roster_save                    (ClasslimitRoster  *self,
+                                                              GSettings         *settings);
+GVariant          *classlimit_roster_get_records             (ClasslimitRoster  *self);
+gboolean           classlimit_roster_merge_subjects          (ClasslimitRoster  *self,
+                                                              GVariant          *records);
+gboolean           classlimit_roster_merge                   (ClasslimitRoster  *self,
+                                                              GVariant          *change);
+void               classlimit_roster_begin                   (ClasslimitRoster  *self);
+void               classlimit_roster_commit                  (ClasslimitRoster  *self);
+void               classlimit_roster_hold_saves              (ClasslimitRoster  *self);
+void               classlimit_roster_release_saves           (ClasslimitRoster  *self);
+void               classlimit_roster_flush                   (ClasslimitRoster  *self);
+GPtrArray         *classlimit_roster_parse_json              (const char        *data,
+                                                              gsize              length,
+                                                              GError           **error);
+GVariant          *classlimit_roster_parse_json_records      (const char        *data,
+                                                              gsize              length,
+                                                              int               *required_attendance,
+                                                              int               *total_weeks,
+                                                              int               *session_hours,
+                                                              GError           **error);
+gboolean           classlimit_roster_import_json             (ClasslimitRoster  *self,
+                                                              const char        *data,
+                                                              gsize              length,
+                                                              GError           **error);
+char              *classlimit_roster_export_json             (ClasslimitRoster  *self,
+                                                              gsize             *length);
+
+G_END_DECLS
@@ -0,0 +1,472 @@
+/* classlimit-search-index.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+
+#include "classlimit-search-index.h"
+
+/* The whole index is one GVariant of type (ta(su)a(sii)):
+ *
+ *   t        stamp of the stored subjects and results it was built from
+ *   a(su)    folded name tokens and their ASCII alternates, sorted, each
+ *            with the position of its subject
+ *   a(sii)   name, allowed skips and remaining skips per subject
+ *
+ * so a cached copy can be mapped and searched in place, with a binary
+ * search per term and no parsing at all. Both the stamp and the index
+ * come straight from the settings values, so answering the shell never
+ * builds a roster.
+ */
+#define INDEX_TYPE G_VARIANT_TYPE ("(ta(su)a(sii))")
+
+/* More than the shell will ever show, but bounds the D-Bus reply */
+#define MAX_RESULTS 64
+
+struct _ClasslimitSearchIndex
+{
+	gatomicrefcount  ref_count;
+	GVariant        *data;
+	GVariant        *tokens;
+	GVariant        *subjects;
+};
+
+typedef struct {
+	char  *token;
+	guint  position;
+} Entry;
+
+static int
+compare_entries (gconstpointer a,
+                 gconstpointer b)
+{
+	const Entry *ea = a;
+	const Entry *eb = b;
+	int cmp = strcmp (ea->token, eb->token);
+
+	if (cmp != 0)
+		return cmp;
+
+	return (ea->position > eb->position) - (ea->position < eb->position);
+}
+
+/* FNV-1a over the serialized values, which is far cheaper than
+ * comparing them to anything built from them
+ */
+static guint64
+hash_value (guint64   hash,
+            GVariant *value)
+{
+	const guint8 *data = g_variant_get_data (value);
+	gsize size = g_variant_get_size (value);
+	gsize i;
+
+	for (i = 0; i < size; i++)
+		hash = (hash ^ data[i]) * G_GUINT64_CONSTANT (0x100000001b3);
+
+	return hash ^ size;
+}
+
+static guint64
+settings_stamp (GVariant *subjects,
+                GVariant *results)
+{
+	return hash_value (hash_value (G_GUINT64_CONSTANT (0xcbf29ce484222325), subjects), results);
+}
+
+static ClasslimitSearchIndex *
+search_index_new (GVariant *data)
+{
+	ClasslimitSearchIndex *self = g_new0 (ClasslimitSearchIndex, 1);
+
+	g_atomic_ref_count_init (&self->ref_count);
+	self->data = g_variant_ref_sink (data);
+	self->tokens = g_variant_get_child_value (data, 1);
+	self->subjects = g_variant_get_child_value (data, 2);
+
+	return self;
+}
+
+/**
+ * classlimit_search_index_new:
+ * @subjects: the `a(siii)` subjects setting
+ * @results: the `(t(iiii)a(tii))` results-cache setting
+ *
+ * Builds the index from the stored subjects. Allowances come from the
+ * last calculation while its results still line up with the subjects,
+ * and from the subjects themselves otherwise.
+ *
+ * Returns: (transfer full): the index
+ */
+ClasslimitSearchIndex *
+classlimit_search_index_new (GVariant *subjects,
+                             GVariant *results)
+{
+	g_autoptr(GArray) entries = NULL;
+	g_autoptr(GVariant) cached = NULL;
+	GVariantBuilder tokens;
+	GVariantBuilder names;
+	guint64 hash;
+	gsize n_subjects;
+	gsize i;
+
+	g_return_val_if_fail (g_variant_is_of_type (subjects, G_VARIANT_TYPE ("a(siii)")), NULL);
+	g_return_val_if_fail (g_variant_is_of_type (results, G_VARIANT_TYPE ("(t(iiii)a(tii))")), NULL);
+
+	n_subjects = g_variant_n_children (subjects);
+	g_variant_get (results, "(t(iiii)@a(tii))", &hash, NULL, NULL, NULL, NULL, &cached);
+	if (hash == 0 || g_variant_n_children (cached) != n_subjects)
+		g_clear_pointer (&cached, g_variant_unref);
+
+	entries = g_array_sized_new (FALSE, FALSE, sizeof (Entry), n_subjects * 2);
+	g_variant_builder_init (&names, G_VARIANT_TYPE ("a(sii)"));
+
+	for (i = 0; i < n_subjects; i++) {
+		g_auto(GStrv) folded = NULL;
+		g_auto(GStrv) alternates = NULL;
+		const char *name;
+		int current_skips, allowed_skips;
+		guint j;
+
+		g_variant_get_child (subjects, i, "(&siii)", &name, NULL, &current_skips, &allowed_skips);
+		if (cached)
+			g_variant_get_child (cached, i, "(tii)", NULL, NULL, &allowed_skips);
+
+		folded = g_str_tokenize_and_fold (name, NULL, &alternates);
+		for (j = 0; folded[j]; j++) {
+			Entry entry = { g_steal_pointer (&folded[j]), i };
+			g_array_append_val (entries, entry);
+		}
+		for (j = 0; alternates[j]; j++) {
+			Entry entry = { g_steal_pointer (&alternates[j]), i };
+			g_array_append_val (entries, entry);
+		}
+
+		g_variant_builder_add (&names, "(sii)", name, allowed_skips, allowed_skips - current_skips);
+	}
+
+	g_array_sort (entries, compare_entries);
+
+	g_variant_builder_init (&tokens, G_VARIANT_TYPE ("a(su)"));
+	for (i = 0; i < entries->len; i++) {
+		Entry *entry = &g_array_index (entries, Entry, i);
+
+		/* A name repeating a word only needs it once */
+		if (i == 0 || compare_entries (entry, entry - 1) != 0)
+			g_variant_builder_add (&tokens, "(su)", entry->token, entry->position);
+	}
+	for (i = 0; i < entries->len; i++)
+		g_free (g_array_index (entries, Entry, i).token);
+
+	return search_index_new (g_variant_new ("(ta(su)a(sii))", settings_stamp (subjects, results),
+	                                        &tokens, &names));
+}
+
+/**
+ * classlimit_search_index_load:
+ * @path: where classlimit_search_index_save() wrote the index
+ * @subjects: the `a(siii)` subjects setting
+ * @results: the `(t(iiii)a(tii))` results-cache setting
+ * @error: return location for a #GError
+ *
+ * Maps a saved index, as long as it was built from these very settings
+ * values.
+ *
+ * Returns: (transfer full): the index, or %NULL if it is missing or stale
+ */
+ClasslimitSearchIndex *
+classlimit_search_index_load (const char  *path,
+                              GVariant    *subjects,
+                              GVariant    *results,
+                              GError     **error)
+{
+	g_autoptr(GMappedFile) file = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) data = NULL;
+	guint64 stamp;
+
+	g_return_val_if_fail (path != NULL, NULL);
+	g_return_val_if_fail (subjects != NULL, NULL);
+	g_return_val_if_fail (results != NULL, NULL);
+
+	if (!(file = g_mapped_file_new (path, FALSE, error)))
+		return NULL;
+
+	bytes = g_mapped_file_get_bytes (file);
+	data = g_variant_ref_sink (g_variant_new_from_bytes (INDEX_TYPE, bytes, FALSE));
+	g_variant_get_child (data, 0, "t", &stamp);
+	if (stamp != settings_stamp (subjects, results)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+		             "Search index %s is out of date", path);
+		return NULL;
+	}
+
+	return search_index_new (data);
+}
+
+gboolean
+classlimit_search_index_save (ClasslimitSearchIndex  *self,
+                              const char             *path,
+                              GError                **error)
+{
+	g_autofree char *dir = NULL;
+
+	g_return_val_if_fail (self != NULL, FALSE);
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	dir = g_path_get_dirname (path);
+	if (g_mkdir_with_parents (dir, 0700) != 0) {
+		int saved_errno = errno;
+
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+		             "Could not create %s: %s", dir, g_strerror (saved_errno));
+		return FALSE;
+	}
+
+	return g_file_set_contents (path, g_variant_get_data (self->data),
+	                            g_variant_get_size (self->data), error);
+}
+
+char *
+classlimit_search_index_get_cache_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "classlimit", "search-index.gvariant", NULL);
+}
+
+ClasslimitSearchIndex *
+classlimit_search_index_ref (ClasslimitSearchIndex *self)
+{
+	g_return_val_if_fail (self != NULL, NULL);
+
+	g_atomic_ref_count_inc (&self->ref_count);
+
+	return self;
+}
+
+void
+classlimit_search_index_unref (ClasslimitSearchIndex *self)
+{
+	g_return_if_fail (self != NULL);
+
+	if (g_atomic_ref_count_dec (&self->ref_count)) {
+		g_variant_unref (self->tokens);
+		g_variant_unref (self->subjects);
+		g_variant_unref (self->data);
+		g_free (self);
+	}
+}
+
+/* Folds the shell's terms the same way the names were folded */
+static GStrv
+fold_terms (const char * const *terms)
+{
+	g_autoptr(GStrvBuilder) builder = g_strv_builder_new ();
+	guint i;
+
+	for (i = 0; terms[i]; i++) {
+		g_auto(GStrv) folded = g_str_tokenize_and_fold (terms[i], NULL, NULL);
+		guint j;
+
+		for (j = 0; folded[j]; j++)
+			g_strv_builder_add (builder, folded[j]);
+	}
+
+	return g_strv_builder_end (builder);
+}
+
+/* First token that is >= prefix */
+static gsize
+lower_bound (GVariant   *tokens,
+             const char *prefix)
+{
+	gsize low = 0;
+	gsize high = g_variant_n_children (tokens);
+
+	while (low < high) {
+		gsize mid = low + (high - low) / 2;
+		const char *token;
+
+		g_variant_get_child (tokens, mid, "(&su)", &token, NULL);
+		if (strcmp (token, prefix) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/**
+ * classlimit_search_index_lookup:
+ * @self: a #ClasslimitSearchIndex
+ * @terms: the search terms
+ *
+ * Finds the subjects with a word starting with each of @terms, in
+ * roster order.
+ *
+ * Returns: (transfer full): result identifiers
+ */
+char **
+classlimit_search_index_lookup (ClasslimitSearchIndex *self,
+                                const char * const    *terms)
+{
+	g_autoptr(GStrvBuilder) results = g_strv_builder_new ();
+	g_auto(GStrv) folded = NULL;
+	g_autofree guint16 *hits = NULL;
+	gsize n_subjects;
+	guint n_terms;
+	guint n_results = 0;
+	gsize i;
+
+	g_return_val_if_fail (self != NULL, NULL);
+	g_return_val_if_fail (terms != NULL, NULL);
+
+	folded = fold_terms (terms);
+	n_terms = MIN (g_strv_length (folded), G_MAXUINT16);
+	n_subjects = g_variant_n_children (self->subjects);
+	if (n_terms == 0 || n_subjects == 0)
+		return g_strv_builder_end (results);
+
+	/* hits[i] counts the terms matched so far, so each term only
+	 * advances subjects that matched all previous ones.
+	 */
+	hits = g_new0 (guint16, n_subjects);
+	for (i = 0; i < n_terms; i++) {
+		gsize prefix_len = strlen (folded[i]);
+		gsize n_tokens = g_variant_n_children (self->tokens);
+		gsize t;
+
+		for (t = lower_bound (self->tokens, folded[i]); t < n_tokens; t++) {
+			const char *token;
+			guint32 position;
+
+			g_variant_get_child (self->tokens, t, "(&su)", &token, &position);
+			if (strncmp (token, folded[i], prefix_len) != 0)
+				break;
+			if (position < n_subjects && hits[position] == i)
+				hits[position] = i + 1;
+		}
+	}
+
+	for (i = 0; i < n_subjects && n_results < MAX_RESULTS; i++) {
+		if (hits[i] == n_terms) {
+			char id[24];
+
+			g_snprintf (id, sizeof id, "%" G_GSIZE_FORMAT, i);
+			g_strv_builder_add (results, id);
+			n_results++;
+		}
+	}
+
+	return g_strv_builder_end (results);
+}
+
+static gboolean
+parse_id (ClasslimitSearchIndex *self,
+          const char            *id,
+          gsize                 *position)
+{
+	gsize n_subjects = g_variant_n_children (self->subjects);
+	guint64 value;
+
+	if (n_subjects == 0 ||
+	    !g_ascii_string_to_unsigned (id, 10, 0, n_subjects - 1, &value, NULL))
+		return FALSE;
+
+	*position = value;
+	return TRUE;
+}
+
+/**
+ * classlimit_search_index_filter:
+ * @self: a #ClasslimitSearchIndex
+ * @ids: earlier results
+ * @terms: the refined search terms
+ *
+ * Narrows down earlier results instead of searching the whole index
+ * again, as the shell asks for while the user keeps typing.
+ *
+ * Returns: (transfer full): the identifiers in @ids that still match
+ */
+char **
+classlimit_search_index_filter (ClasslimitSearchIndex *self,
+                                const char * const    *ids,
+                                const char * const    *terms)
+{
+	g_autoptr(GStrvBuilder) results = g_strv_builder_new ();
+	g_auto(GStrv) folded = NULL;
+	guint i;
+
+	g_return_val_if_fail (self != NULL, NULL);
+	g_return_val_if_fail (ids != NULL, NULL);
+	g_return_val_if_fail (terms != NULL, NULL);
+
+	folded = fold_terms (terms);
+
+	for (i = 0; ids[i]; i++) {
+		g_auto(GStrv) words = NULL;
+		g_auto(GStrv) alternates = NULL;
+		const char *name;
+		gsize position;
+		gboolean matches = TRUE;
+		guint t, w;
+
+		if (!parse_id (self, ids[i], &position))
+			continue;
+
+		g_variant_get_child (self->subjects, position, "(&sii)", &name, NULL, NULL);
+		words = g_str_tokenize_and_fold (name, NULL, &alternates);
+		for (t = 0; folded[t] && matches; t++) {
+			matches = FALSE;
+			for (w = 0; words[w] && !matches; w++)
+				matches = g_str_has_prefix (words[w], folded[t]);
+			for (w = 0; alternates[w] && !matches; w++)
+				matches = g_str_has_prefix (alternates[w], folded[t]);
+		}
+
+		if (matches)
+			g_strv_builder_add (results, ids[i]);
+	}
+
+	return g_strv_builder_end (results);
+}
+
+gboolean
+classlimit_search_index_get_subject (ClasslimitSearchIndex  *self,
+                                     const char             *id,
+                                     const char            **name,
+                                     int                    *allowed_skips,
+                                     int                    *remaining)
+{
+	gsize position;
+
+	g_return_val_if_fail (self != NULL, FALSE);
+	g_return_val_if_fail (id != NULL, FALSE);
+
+	if (!parse_id (self, id, &position))
+		return FALSE;
+
+	/* The name points into the index, which the caller keeps alive */
+	g_variant_get_child (self->subjects, position, "(&sii)", name, allowed_skips, remaining);
+
+	return TRUE;
+}
@@ -0,0 +1,54 @@
+/* classlimit-search-index.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ClasslimitSearchIndex ClasslimitSearchIndex;
+
+ClasslimitSearchIndex *classlimit_search_index_new            (GVariant                    *subjects,
+                                                               GVariant                    *results);
+ClasslimitSearchIndex *classlimit_search_index_load           (const char                  *path,
+                                                               GVariant                    *subjects,
+                                                               GVariant                    *results,
+                                                               GError                     **error);
+gboolean               classlimit_search_index_save           (ClasslimitSearchIndex       *self,
+                                                               const char                  *path,
+                                                               GError                     **error);
+ClasslimitSearchIndex *classlimit_search_index_ref            (ClasslimitSearchIndex       *self);
+void                   classlimit_search_index_unref          (ClasslimitSearchIndex       *self);
+char                 **classlimit_search_index_lookup         (ClasslimitSearchIndex       *self,
+                                                               const char * const          *terms);
+char                 **classlimit_search_index_filter         (ClasslimitSearchIndex       *self,
+                                                               const char * const          *ids,
+                                                               const char * const          *terms);
+gboolean               classlimit_search_index_get_subject    (ClasslimitSearchIndex       *self,
+                                                               const char                  *id,
+                                                               const char                 **name,
+                                                               int                         *allowed_skips,
+                                                               int                         *remaining);
+char                  *classlimit_search_index_get_cache_path (void);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ClasslimitSearchIndex, classlimit_search_index_unref)
+
+G_END_DECLS
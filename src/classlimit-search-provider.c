@@ -0,0 +1,363 @@
+/* classlimit-search-provider.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+#include <glib/gi18n.h>
+
+#define G_SETTINGS_ENABLE_BACKEND
+#include <gio/gsettingsbackend.h>
+
+#include "classlimit-search-provider.h"
+#include "classlimit-search-index.h"
+#include "classlimit-shell-search-provider-generated.h"
+
+/* Answers org.gnome.Shell.SearchProvider2 from the search index alone,
+ * so the overview never waits for a window or any widgets. The index is
+ * mapped from the cache when it was built from the stored subjects and
+ * results as they are now, and rebuilt from those and written back
+ * otherwise. The roster itself is only loaded once a result is opened.
+ */
+
+#define SAVE_DELAY_SECONDS 2
+
+struct _ClasslimitSearchProvider
+{
+	GObject                          parent_instance;
+
+	GApplication                    *application;
+	ClasslimitShellSearchProvider2  *skeleton;
+	GSettingsBackend                *backend;
+	GSettings                       *settings;
+	ClasslimitSearchIndex           *index;
+	guint                            save_id;
+};
+
+G_DEFINE_FINAL_TYPE (ClasslimitSearchProvider, classlimit_search_provider, G_TYPE_OBJECT)
+
+static ClasslimitSearchIndex *
+build_index (ClasslimitSearchProvider *self)
+{
+	g_autoptr(GVariant) subjects = g_settings_get_value (self->settings, "subjects");
+	g_autoptr(GVariant) results = g_settings_get_value (self->settings, "results-cache");
+
+	return classlimit_search_index_new (subjects, results);
+}
+
+static gboolean
+save_index_cb (gpointer user_data)
+{
+	ClasslimitSearchProvider *self = CLASSLIMIT_SEARCH_PROVIDER (user_data);
+	g_autofree char *path = classlimit_search_index_get_cache_path ();
+	g_autoptr(GError) error = NULL;
+
+	self->save_id = 0;
+
+	if (self->index == NULL)
+		self->index = build_index (self);
+	if (!classlimit_search_index_save (self->index, path, &error))
+		g_warning ("Failed to save search index: %s", error->message);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+on_settings_changed (ClasslimitSearchProvider *self)
+{
+	/* Rebuilt on the next query, and written out once edits settle */
+	g_clear_pointer (&self->index, classlimit_search_index_unref);
+	g_clear_handle_id (&self->save_id, g_source_remove);
+	self->save_id = g_timeout_add_seconds (SAVE_DELAY_SECONDS, save_index_cb, self);
+}
+
+static ClasslimitSearchIndex *
+ensure_index (ClasslimitSearchProvider *self)
+{
+	g_autoptr(GVariant) subjects = NULL;
+	g_autoptr(GVariant) results = NULL;
+	g_autofree char *path = NULL;
+
+	if (self->index)
+		return self->index;
+
+	/* Whoever holds the roster writes every change through the same
+	 * backend, so these see them too
+	 */
+	if (self->settings == NULL) {
+		if (self->backend)
+			self->settings = g_settings_new_with_backend ("com.tomasps.classlimit", self->backend);
+		else
+			self->settings = g_settings_new ("com.tomasps.classlimit");
+		g_signal_connect_object (self->settings, "changed::subjects",
+			G_CALLBACK (on_settings_changed), self, G_CONNECT_SWAPPED);
+		g_signal_connect_object (self->settings, "changed::results-cache",
+			G_CALLBACK (on_settings_changed), self, G_CONNECT_SWAPPED);
+	}
+
+	subjects = g_settings_get_value (self->settings, "subjects");
+	results = g_settings_get_value (self->settings, "results-cache");
+	path = classlimit_search_index_get_cache_path ();
+	self->index = classlimit_search_index_load (path, subjects, results, NULL);
+	if (self->index == NULL) {
+		self->index = classlimit_search_index_new (subjects, results);
+		if (self->save_id == 0)
+			self->save_id = g_idle_add (save_index_cb, self);
+	}
+
+	return self->index;
+}
+
+static gboolean
+handle_get_initial_result_set (ClasslimitShellSearchProvider2 *skeleton,
+                               GDBusMethodInvocation          *invocation,
+                               const char * const             *terms,
+                               ClasslimitSearchProvider       *self)
+{
+	g_auto(GStrv) results = NULL;
+
+	g_application_hold (self->application);
+	results = classlimit_search_index_lookup (ensure_index (self), terms);
+	classlimit_shell_search_provider2_complete_get_initial_result_set (skeleton, invocation,
+		(const char * const *) results);
+	g_application_release (self->application);
+
+	return TRUE;
+}
+
+static gboolean
+handle_get_subsearch_result_set (ClasslimitShellSearchProvider2 *skeleton,
+                                 GDBusMethodInvocation          *invocation,
+                                 const char * const             *previous_results,
+                                 const char * const             *terms,
+                                 ClasslimitSearchProvider       *self)
+{
+	g_auto(GStrv) results = NULL;
+
+	g_application_hold (self->application);
+	results = classlimit_search_index_filter (ensure_index (self), previous_results, terms);
+	classlimit_shell_search_provider2_complete_get_subsearch_result_set (skeleton, invocation,
+		(const char * const *) results);
+	g_application_release (self->application);
+
+	return TRUE;
+}
+
+static gboolean
+handle_get_result_metas (ClasslimitShellSearchProvider2 *skeleton,
+                         GDBusMethodInvocation          *invocation,
+                         const char * const             *identifiers,
+                         ClasslimitSearchProvider       *self)
+{
+	ClasslimitSearchIndex *index;
+	g_autoptr(GIcon) icon = g_themed_icon_new ("com.tomasps.classlimit");
+	g_autofree char *icon_string = g_icon_to_string (icon);
+	GVariantBuilder metas;
+	guint i;
+
+	g_application_hold (self->application);
+	index = ensure_index (self);
+
+	g_variant_builder_init (&metas, G_VARIANT_TYPE ("aa{sv}"));
+	for (i = 0; identifiers[i]; i++) {
+		g_autofree char *description = NULL;
+		const char *name;
+		int allowed_skips, remaining;
+
+		if (!classlimit_search_index_get_subject (index, identifiers[i], &name, &allowed_skips, &remaining))
+			continue;
+
+		if (allowed_skips == 0)
+			description = g_strdup (_("Allowed skips not calculated yet"));
+		else if (remaining < 0)
+			description = g_strdup_printf (ngettext ("%d skip over the limit", "%d skips over the limit", -remaining), -remaining);
+		else
+			description = g_strdup_printf (ngettext ("%d skip remaining", "%d skips remaining", remaining), remaining);
+
+		g_variant_builder_open (&metas, G_VARIANT_TYPE ("a{sv}"));
+		g_variant_builder_add (&metas, "{sv}", "id", g_variant_new_string (identifiers[i]));
+		g_variant_builder_add (&metas, "{sv}", "name", g_variant_new_string (name));
+		g_variant_builder_add (&metas, "{sv}", "description", g_variant_new_string (description));
+		g_variant_builder_add (&metas, "{sv}", "gicon", g_variant_new_string (icon_string));
+		g_variant_builder_close (&metas);
+	}
+
+	classlimit_shell_search_provider2_complete_get_result_metas (skeleton, invocation,
+		g_variant_builder_end (&metas));
+	g_application_release (self->application);
+
+	return TRUE;
+}
+
+static gboolean
+handle_activate_result (ClasslimitShellSearchProvider2 *skeleton,
+                        GDBusMethodInvocation          *invocation,
+                        const char                     *identifier,
+                        const char * const             *terms,
+                        guint                           timestamp,
+                        ClasslimitSearchProvider       *self)
+{
+	guint64 position;
+
+	/* The first point at which the roster and a window are needed. The
+	 * identifier is the subject's position in the roster.
+	 */
+	if (g_ascii_string_to_unsigned (identifier, 10, 0, G_MAXUINT32, &position, NULL))
+		g_action_group_activate_action (G_ACTION_GROUP (self->application), "show-subject",
+		                                g_variant_new_uint32 ((guint32) position));
+	else
+		g_application_activate (self->application);
+	classlimit_shell_search_provider2_complete_activate_result (skeleton, invocation);
+
+	return TRUE;
+}
+
+static gboolean
+handle_launch_search (ClasslimitShellSearchProvider2 *skeleton,
+                      GDBusMethodInvocation          *invocation,
+                      const char * const             *terms,
+                      guint                           timestamp,
+                      ClasslimitSearchProvider       *self)
+{
+	g_application_activate (self->application);
+	classlimit_shell_search_provider2_complete_launch_search (skeleton, invocation);
+
+	return TRUE;
+}
+
+static void
+release_state (ClasslimitSearchProvider *self)
+{
+	/* Don't lose pending edits to the index on the way out */
+	if (self->save_id != 0) {
+		g_clear_handle_id (&self->save_id, g_source_remove);
+		if (self->settings)
+			save_index_cb (self);
+	}
+
+	g_clear_pointer (&self->index, classlimit_search_index_unref);
+	if (self->settings) {
+		g_signal_handlers_disconnect_by_data (self->settings, self);
+		g_clear_object (&self->settings);
+	}
+}
+
+static void
+classlimit_search_provider_dispose (GObject *object)
+{
+	ClasslimitSearchProvider *self = CLASSLIMIT_SEARCH_PROVIDER (object);
+
+	release_state (self);
+	g_clear_object (&self->skeleton);
+	g_clear_object (&self->backend);
+
+	G_OBJECT_CLASS (classlimit_search_provider_parent_class)->dispose (object);
+}
+
+static void
+classlimit_search_provider_class_init (ClasslimitSearchProviderClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = classlimit_search_provider_dispose;
+}
+
+static void
+classlimit_search_provider_init (ClasslimitSearchProvider *self)
+{
+	self->skeleton = classlimit_shell_search_provider2_skeleton_new ();
+
+	g_signal_connect (self->skeleton, "handle-get-initial-result-set",
+		G_CALLBACK (handle_get_initial_result_set), self);
+	g_signal_connect (self->skeleton, "handle-get-subsearch-result-set",
+		G_CALLBACK (handle_get_subsearch_result_set), self);
+	g_signal_connect (self->skeleton, "handle-get-result-metas",
+		G_CALLBACK (handle_get_result_metas), self);
+	g_signal_connect (self->skeleton, "handle-activate-result",
+		G_CALLBACK (handle_activate_result), self);
+	g_signal_connect (self->skeleton, "handle-launch-search",
+		G_CALLBACK (handle_launch_search), self);
+}
+
+/**
+ * classlimit_search_provider_new:
+ * @application: the application to hold while answering, with an
+ *   `app.show-subject` action taking a roster position
+ * @backend: (nullable): where the settings live, or %NULL for the default
+ *
+ * Returns: (transfer full): a new #ClasslimitSearchProvider
+ */
+ClasslimitSearchProvider *
+classlimit_search_provider_new (GApplication     *application,
+                                GSettingsBackend *backend)
+{
+	ClasslimitSearchProvider *self;
+
+	g_return_val_if_fail (G_IS_APPLICATION (application), NULL);
+	g_return_val_if_fail (backend == NULL || G_IS_SETTINGS_BACKEND (backend), NULL);
+
+	self = g_object_new (CLASSLIMIT_TYPE_SEARCH_PROVIDER, NULL);
+	/* The application owns us, so this is not a reference */
+	self->application = application;
+	if (backend)
+		self->backend = g_object_ref (backend);
+
+	return self;
+}
+
+gboolean
+classlimit_search_provider_register (ClasslimitSearchProvider  *self,
+                                     GDBusConnection           *connection,
+                                     const char                *object_path,
+                                     GError                   **error)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SEARCH_PROVIDER (self), FALSE);
+	g_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), FALSE);
+	g_return_val_if_fail (object_path != NULL, FALSE);
+
+	return g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->skeleton),
+	                                         connection, object_path, error);
+}
+
+void
+classlimit_search_provider_unregister (ClasslimitSearchProvider *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_SEARCH_PROVIDER (self));
+
+	g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (self->skeleton));
+}
+
+/* Maps or builds the index ahead of the first query */
+void
+classlimit_search_provider_warm (ClasslimitSearchProvider *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_SEARCH_PROVIDER (self));
+
+	ensure_index (self);
+}
+
+/* Drops the index and the settings reference; both come back on the
+ * next query.
+ */
+void
+classlimit_search_provider_release (ClasslimitSearchProvider *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_SEARCH_PROVIDER (self));
+
+	release_state (self);
+}
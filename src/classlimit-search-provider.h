@@ -0,0 +1,41 @@
+/* classlimit-search-provider.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define CLASSLIMIT_TYPE_SEARCH_PROVIDER (classlimit_search_provider_get_type())
+
+G_DECLARE_FINAL_TYPE (ClasslimitSearchProvider, classlimit_search_provider, CLASSLIMIT, SEARCH_PROVIDER, GObject)
+
+ClasslimitSearchProvider *classlimit_search_provider_new        (GApplication              *application,
+                                                                 GSettingsBackend          *backend);
+gboolean                  classlimit_search_provider_register   (ClasslimitSearchProvider  *self,
+                                                                 GDBusConnection           *connection,
+                                                                 const char                *object_path,
+                                                                 GError                   **error);
+void                      classlimit_search_provider_unregister (ClasslimitSearchProvider  *self);
+void                      classlimit_search_provider_warm       (ClasslimitSearchProvider  *self);
+void                      classlimit_search_provider_release    (ClasslimitSearchProvider  *self);
+
+G_END_DECLS
@@ -0,0 +1,906 @@
+/* classlimit-subject-row.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+#include <glib/gi18n.h>
+
+#include "classlimit-subject-row.h"
+#include "classlimit-action.h"
+
+/* A whole subject row in one widget: title, subtitle, status glyph and
+ * the skip/remove affordances are drawn in a single snapshot and hit
+ * tested by one click gesture, instead of an AdwActionRow holding a box,
+ * an image and four buttons, each with its own CSS node and tooltip.
+ */
+
+#define PADDING_X        12
+#define PADDING_Y         8
+#define MIN_HEIGHT       56
+#define CONTROL_SIZE     34
+#define ICON_SIZE        16
+#define CONTROL_SPACING   6
+#define STATUS_SPACING   12
+#define MIN_TEXT_WIDTH   48
+
+typedef enum {
+	CONTROL_DECREMENT,
+	CONTROL_INCREMENT,
+	CONTROL_RESET,
+	CONTROL_REMOVE,
+	N_CONTROLS,
+	CONTROL_NONE = N_CONTROLS
+} Control;
+
+typedef enum {
+	ICON_DECREMENT,
+	ICON_INCREMENT,
+	ICON_RESET,
+	ICON_REMOVE,
+	ICON_STATUS_NONE,
+	ICON_STATUS_ERROR,
+	ICON_STATUS_WARNING,
+	ICON_STATUS_OK,
+	N_ICONS
+} Icon;
+
+static const char *icon_names[N_ICONS] = {
+	[ICON_DECREMENT]      = "list-remove-symbolic",
+	[ICON_INCREMENT]      = "list-add-symbolic",
+	[ICON_RESET]          = "edit-clear-all-symbolic",
+	[ICON_REMOVE]         = "user-trash-symbolic",
+	[ICON_STATUS_NONE]    = "view-statistics-symbolic",
+	[ICON_STATUS_ERROR]   = "dialog-error-symbolic",
+	[ICON_STATUS_WARNING] = "dialog-warning-symbolic",
+	[ICON_STATUS_OK]      = "emblem-ok-symbolic",
+};
+
+static const ClasslimitActionKind control_actions[N_CONTROLS] = {
+	[CONTROL_DECREMENT] = CLASSLIMIT_ACTION_SKIP_DECREMENT,
+	[CONTROL_INCREMENT] = CLASSLIMIT_ACTION_SKIP_INCREMENT,
+	[CONTROL_RESET]     = CLASSLIMIT_ACTION_SKIP_RESET,
+	[CONTROL_REMOVE]    = CLASSLIMIT_ACTION_REMOVE,
+};
+
+/* What assistive technologies see of one drawn control: a button with
+ * a label and bounds inside the row, but no widget of its own.
+ */
+#define CLASSLIMIT_TYPE_SUBJECT_ROW_CONTROL (classlimit_subject_row_control_get_type ())
+G_DECLARE_FINAL_TYPE (ClasslimitSubjectRowControl, classlimit_subject_row_control, CLASSLIMIT, SUBJECT_ROW_CONTROL, GObject)
+
+struct _ClasslimitSubjectRow
+{
+	GtkWidget          parent_instance;
+
+	ClasslimitSubject *subject;
+	gulong             notify_id;
+
+	PangoLayout       *title_layout;
+	PangoLayout       *subtitle_layout;
+	GtkIconPaintable  *icons[N_ICONS];
+	Icon               status_icon;
+
+	graphene_rect_t    text_rect;
+	graphene_rect_t    status_rect;
+	graphene_rect_t    control_rects[N_CONTROLS];
+	Control            hovered;
+	Control            pressed;
+
+	ClasslimitSubjectRowControl *controls[N_CONTROLS];
+};
+
+struct _ClasslimitSubjectRowControl
+{
+	GObject               parent_instance;
+
+	/* Unowned, the row owns us and clears this on dispose */
+	ClasslimitSubjectRow *row;
+	Control               control;
+	GtkATContext         *at_context;
+};
+
+static void classlimit_subject_row_accessible_init         (GtkAccessibleInterface *iface);
+static void classlimit_subject_row_control_accessible_init (GtkAccessibleInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (ClasslimitSubjectRow, classlimit_subject_row, GTK_TYPE_WIDGET,
+                               G_IMPLEMENT_INTERFACE (GTK_TYPE_ACCESSIBLE, classlimit_subject_row_accessible_init))
+G_DEFINE_FINAL_TYPE_WITH_CODE (ClasslimitSubjectRowControl, classlimit_subject_row_control, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (GTK_TYPE_ACCESSIBLE, classlimit_subject_row_control_accessible_init))
+
+enum {
+	PROP_0,
+	PROP_SUBJECT,
+	N_PROPS
+};
+
+enum {
+	SUBJECT_ACTION,
+	N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+static const char *
+control_tooltip (Control control)
+{
+	switch (control) {
+	case CONTROL_DECREMENT:
+		return _("Decrease skip count");
+	case CONTROL_INCREMENT:
+		return _("Increase skip count");
+	case CONTROL_RESET:
+		return _("Reset skip count");
+	case CONTROL_REMOVE:
+		return _("Remove subject");
+	case N_CONTROLS:
+	default:
+		return NULL;
+	}
+}
+
+static Control
+control_at (ClasslimitSubjectRow *self,
+            double                x,
+            double                y)
+{
+	graphene_point_t point = GRAPHENE_POINT_INIT (x, y);
+	guint i;
+
+	for (i = 0; i < N_CONTROLS; i++) {
+		if (graphene_rect_contains_point (&self->control_rects[i], &point))
+			return i;
+	}
+
+	return CONTROL_NONE;
+}
+
+enum {
+	CONTROL_PROP_0,
+	CONTROL_PROP_ACCESSIBLE_ROLE,
+};
+
+static GtkATContext *
+control_get_at_context (GtkAccessible *accessible)
+{
+	ClasslimitSubjectRowControl *self = CLASSLIMIT_SUBJECT_ROW_CONTROL (accessible);
+
+	if (self->at_context == NULL) {
+		GdkDisplay *display = self->row ? gtk_widget_get_display (GTK_WIDGET (self->row))
+		                                : gdk_display_get_default ();
+
+		self->at_context = gtk_at_context_create (GTK_ACCESSIBLE_ROLE_BUTTON, accessible, display);
+		if (self->at_context == NULL)
+			return NULL;
+	}
+
+	return g_object_ref (self->at_context);
+}
+
+static gboolean
+control_get_platform_state (GtkAccessible              *accessible,
+                            GtkAccessiblePlatformState  state)
+{
+	return FALSE;
+}
+
+static GtkAccessible *
+control_get_accessible_parent (GtkAccessible *accessible)
+{
+	ClasslimitSubjectRowControl *self = CLASSLIMIT_SUBJECT_ROW_CONTROL (accessible);
+
+	return self->row ? g_object_ref (GTK_ACCESSIBLE (self->row)) : NULL;
+}
+
+static GtkAccessible *
+control_get_first_accessible_child (GtkAccessible *accessible)
+{
+	return NULL;
+}
+
+static GtkAccessible *
+control_get_next_accessible_sibling (GtkAccessible *accessible)
+{
+	ClasslimitSubjectRowControl *self = CLASSLIMIT_SUBJECT_ROW_CONTROL (accessible);
+
+	if (self->row == NULL || self->control + 1 >= N_CONTROLS)
+		return NULL;
+
+	return g_object_ref (GTK_ACCESSIBLE (self->row->controls[self->control + 1]));
+}
+
+/* Relative to the row, like a child widget's */
+static gboolean
+control_get_bounds (GtkAccessible *accessible,
+                    int           *x,
+                    int           *y,
+                    int           *width,
+                    int           *height)
+{
+	ClasslimitSubjectRowControl *self = CLASSLIMIT_SUBJECT_ROW_CONTROL (accessible);
+	const graphene_rect_t *rect;
+
+	if (self->row == NULL || gtk_widget_get_width (GTK_WIDGET (self->row)) == 0)
+		return FALSE;
+
+	rect = &self->row->control_rects[self->control];
+	*x = rect->origin.x;
+	*y = rect->origin.y;
+	*width = rect->size.width;
+	*height = rect->size.height;
+
+	return TRUE;
+}
+
+static void
+classlimit_subject_row_control_accessible_init (GtkAccessibleInterface *iface)
+{
+	iface->get_at_context = control_get_at_context;
+	iface->get_platform_state = control_get_platform_state;
+	iface->get_accessible_parent = control_get_accessible_parent;
+	iface->get_first_accessible_child = control_get_first_accessible_child;
+	iface->get_next_accessible_sibling = control_get_next_accessible_sibling;
+	iface->get_bounds = control_get_bounds;
+}
+
+static void
+classlimit_subject_row_control_dispose (GObject *object)
+{
+	ClasslimitSubjectRowControl *self = CLASSLIMIT_SUBJECT_ROW_CONTROL (object);
+
+	g_clear_object (&self->at_context);
+
+	G_OBJECT_CLASS (classlimit_subject_row_control_parent_class)->dispose (object);
+}
+
+static void
+classlimit_subject_row_control_get_property (GObject    *object,
+                                             guint       prop_id,
+                                             GValue     *value,
+                                             GParamSpec *pspec)
+{
+	switch (prop_id) {
+	case CONTROL_PROP_ACCESSIBLE_ROLE:
+		g_value_set_enum (value, GTK_ACCESSIBLE_ROLE_BUTTON);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_subject_row_control_set_property (GObject      *object,
+                                             guint         prop_id,
+                                             const GValue *value,
+                                             GParamSpec   *pspec)
+{
+	switch (prop_id) {
+	case CONTROL_PROP_ACCESSIBLE_ROLE:
+		/* Always a button */
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_subject_row_control_class_init (ClasslimitSubjectRowControlClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = classlimit_subject_row_control_dispose;
+	object_class->get_property = classlimit_subject_row_control_get_property;
+	object_class->set_property = classlimit_subject_row_control_set_property;
+
+	g_object_class_override_property (object_class, CONTROL_PROP_ACCESSIBLE_ROLE, "accessible-role");
+}
+
+static void
+classlimit_subject_row_control_init (ClasslimitSubjectRowControl *self)
+{
+}
+
+static ClasslimitSubjectRowControl *
+control_new (ClasslimitSubjectRow *row,
+             Control               control)
+{
+	static const char *shortcuts[N_CONTROLS] = {
+		[CONTROL_DECREMENT] = "minus",
+		[CONTROL_INCREMENT] = "plus",
+		[CONTROL_RESET]     = "r",
+		[CONTROL_REMOVE]    = "Delete",
+	};
+	ClasslimitSubjectRowControl *self = g_object_new (CLASSLIMIT_TYPE_SUBJECT_ROW_CONTROL, NULL);
+
+	self->row = row;
+	self->control = control;
+	gtk_accessible_update_property (GTK_ACCESSIBLE (self),
+	                                GTK_ACCESSIBLE_PROPERTY_LABEL, control_tooltip (control),
+	                                GTK_ACCESSIBLE_PROPERTY_KEY_SHORTCUTS, shortcuts[control],
+	                                -1);
+
+	return self;
+}
+
+/* The controls are the row's only accessible children */
+static GtkAccessible *
+classlimit_subject_row_get_first_accessible_child (GtkAccessible *accessible)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (accessible);
+
+	if (self->controls[0] == NULL)
+		return NULL;
+
+	return g_object_ref (GTK_ACCESSIBLE (self->controls[0]));
+}
+
+static void
+classlimit_subject_row_accessible_init (GtkAccessibleInterface *iface)
+{
+	iface->get_first_accessible_child = classlimit_subject_row_get_first_accessible_child;
+}
+
+static void
+update_text (ClasslimitSubjectRow *self)
+{
+	char subtitle[128] = "";
+	Icon status_icon = ICON_STATUS_NONE;
+
+	if (self->subject) {
+		int weekly_hours = classlimit_subject_get_weekly_hours (self->subject);
+		int current_skips = classlimit_subject_get_current_skips (self->subject);
+		int allowed_skips = classlimit_subject_get_allowed_skips (self->subject);
+		int remaining = classlimit_subject_get_remaining (self->subject);
+
+		if (allowed_skips > 0)
+			g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d • Remaining: %d"), weekly_hours, current_skips, remaining);
+		else if (current_skips > 0)
+			g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d"), weekly_hours, current_skips);
+		else
+			g_snprintf (subtitle, sizeof subtitle, _("%d h/week"), weekly_hours);
+
+		if (allowed_skips == 0)
+			status_icon = ICON_STATUS_NONE;
+		else if (remaining < 0)
+			status_icon = ICON_STATUS_ERROR;
+		else if (remaining <= 2)
+			status_icon = ICON_STATUS_WARNING;
+		else
+			status_icon = ICON_STATUS_OK;
+	}
+
+	pango_layout_set_text (self->title_layout,
+		self->subject ? classlimit_subject_get_name (self->subject) : "", -1);
+	pango_layout_set_text (self->subtitle_layout, subtitle, -1);
+	self->status_icon = status_icon;
+
+	gtk_accessible_update_property (GTK_ACCESSIBLE (self),
+	                                GTK_ACCESSIBLE_PROPERTY_LABEL,
+	                                self->subject ? classlimit_subject_get_name (self->subject) : "",
+	                                GTK_ACCESSIBLE_PROPERTY_DESCRIPTION, subtitle,
+	                                -1);
+
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static void
+create_layouts (ClasslimitSubjectRow *self)
+{
+	PangoAttrList *attrs;
+
+	g_clear_object (&self->title_layout);
+	g_clear_object (&self->subtitle_layout);
+
+	self->title_layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), NULL);
+	pango_layout_set_ellipsize (self->title_layout, PANGO_ELLIPSIZE_END);
+
+	attrs = pango_attr_list_new ();
+	pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_SMALL));
+	self->subtitle_layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), NULL);
+	pango_layout_set_attributes (self->subtitle_layout, attrs);
+	pango_layout_set_ellipsize (self->subtitle_layout, PANGO_ELLIPSIZE_END);
+	pango_attr_list_unref (attrs);
+
+	update_text (self);
+}
+
+static void
+clear_icons (ClasslimitSubjectRow *self)
+{
+	guint i;
+
+	for (i = 0; i < N_ICONS; i++)
+		g_clear_object (&self->icons[i]);
+}
+
+static GdkPaintable *
+get_icon (ClasslimitSubjectRow *self,
+          Icon                  icon)
+{
+	/* The icon theme caches lookups, so rows end up sharing paintables */
+	if (self->icons[icon] == NULL) {
+		GtkIconTheme *theme = gtk_icon_theme_get_for_display (gtk_widget_get_display (GTK_WIDGET (self)));
+
+		self->icons[icon] = gtk_icon_theme_lookup_icon (theme, icon_names[icon], NULL, ICON_SIZE,
+		                                                gtk_widget_get_scale_factor (GTK_WIDGET (self)),
+		                                                gtk_widget_get_direction (GTK_WIDGET (self)),
+		                                                0);
+	}
+
+	return GDK_PAINTABLE (self->icons[icon]);
+}
+
+static void
+on_subject_notify (ClasslimitSubjectRow *self)
+{
+	update_text (self);
+}
+
+static void
+snapshot_icon (ClasslimitSubjectRow  *self,
+               GtkSnapshot           *snapshot,
+               Icon                   icon,
+               const graphene_rect_t *rect,
+               const GdkRGBA         *color)
+{
+	GdkPaintable *paintable = get_icon (self, icon);
+
+	gtk_snapshot_save (snapshot);
+	gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (
+		rect->origin.x + (rect->size.width - ICON_SIZE) / 2,
+		rect->origin.y + (rect->size.height - ICON_SIZE) / 2));
+	if (GTK_IS_SYMBOLIC_PAINTABLE (paintable))
+		gtk_symbolic_paintable_snapshot_symbolic (GTK_SYMBOLIC_PAINTABLE (paintable), snapshot,
+		                                          ICON_SIZE, ICON_SIZE, color, 1);
+	else
+		gdk_paintable_snapshot (paintable, snapshot, ICON_SIZE, ICON_SIZE);
+	gtk_snapshot_restore (snapshot);
+}
+
+static void
+classlimit_subject_row_snapshot (GtkWidget   *widget,
+                                 GtkSnapshot *snapshot)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (widget);
+	GdkRGBA color;
+	GdkRGBA dim;
+	int title_height;
+	int subtitle_height;
+	guint i;
+
+	gtk_widget_get_color (widget, &color);
+	dim = color;
+	dim.alpha *= 0.55;
+
+	/* Title and subtitle, vertically centred as a block */
+	pango_layout_get_pixel_size (self->title_layout, NULL, &title_height);
+	pango_layout_get_pixel_size (self->subtitle_layout, NULL, &subtitle_height);
+
+	gtk_snapshot_save (snapshot);
+	gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (
+		self->text_rect.origin.x,
+		self->text_rect.origin.y + (self->text_rect.size.height - title_height - subtitle_height) / 2));
+	gtk_snapshot_append_layout (snapshot, self->title_layout, &color);
+	gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (0, title_height));
+	gtk_snapshot_append_layout (snapshot, self->subtitle_layout, &dim);
+	gtk_snapshot_restore (snapshot);
+
+	snapshot_icon (self, snapshot, self->status_icon, &self->status_rect, &dim);
+
+	/* Flat-button style feedback for the control under the pointer */
+	for (i = 0; i < N_CONTROLS; i++) {
+		if (i == self->hovered || i == self->pressed) {
+			GskRoundedRect clip;
+			GdkRGBA highlight = color;
+
+			highlight.alpha *= i == self->pressed ? 0.16 : 0.08;
+			gsk_rounded_rect_init_from_rect (&clip, &self->control_rects[i], 6);
+			gtk_snapshot_push_rounded_clip (snapshot, &clip);
+			gtk_snapshot_append_color (snapshot, &highlight, &self->control_rects[i]);
+			gtk_snapshot_pop (snapshot);
+		}
+
+		snapshot_icon (self, snapshot, ICON_DECREMENT + i, &self->control_rects[i], &color);
+	}
+}
+
+static void
+classlimit_subject_row_measure (GtkWidget      *widget,
+                                GtkOrientation  orientation,
+                                int             for_size,
+                                int            *minimum,
+                                int            *natural,
+                                int            *minimum_baseline,
+                                int            *natural_baseline)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (widget);
+	int controls_width = ICON_SIZE + STATUS_SPACING + N_CONTROLS * CONTROL_SIZE + CONTROL_SPACING;
+
+	if (orientation == GTK_ORIENTATION_HORIZONTAL) {
+		PangoRectangle title, subtitle;
+
+		pango_layout_set_width (self->title_layout, -1);
+		pango_layout_set_width (self->subtitle_layout, -1);
+		pango_layout_get_pixel_extents (self->title_layout, NULL, &title);
+		pango_layout_get_pixel_extents (self->subtitle_layout, NULL, &subtitle);
+
+		*minimum = 2 * PADDING_X + STATUS_SPACING + controls_width + MIN_TEXT_WIDTH;
+		*natural = 2 * PADDING_X + STATUS_SPACING + controls_width + MAX (title.width, subtitle.width);
+		*natural = MAX (*natural, *minimum);
+	} else {
+		int title_height, subtitle_height;
+
+		pango_layout_get_pixel_size (self->title_layout, NULL, &title_height);
+		pango_layout_get_pixel_size (self->subtitle_layout, NULL, &subtitle_height);
+		*minimum = *natural = MAX (MIN_HEIGHT, 2 * PADDING_Y + title_height + subtitle_height);
+	}
+}
+
+static void
+classlimit_subject_row_size_allocate (GtkWidget *widget,
+                                      int        width,
+                                      int        height,
+                                      int        baseline)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (widget);
+	gboolean rtl = gtk_widget_get_direction (widget) == GTK_TEXT_DIR_RTL;
+	double control_y = (height - CONTROL_SIZE) / 2.0;
+	double x = width - PADDING_X;
+	double text_width;
+	int i;
+
+	/* Laid out end to start: remove, then the linked skip controls */
+	for (i = N_CONTROLS - 1; i >= 0; i--) {
+		x -= CONTROL_SIZE;
+		graphene_rect_init (&self->control_rects[i], x, control_y, CONTROL_SIZE, CONTROL_SIZE);
+		if (i == CONTROL_REMOVE)
+			x -= CONTROL_SPACING;
+	}
+	x -= STATUS_SPACING + ICON_SIZE;
+	graphene_rect_init (&self->status_rect, x, (height - ICON_SIZE) / 2.0, ICON_SIZE, ICON_SIZE);
+
+	text_width = MAX (x - STATUS_SPACING - PADDING_X, 0);
+	graphene_rect_init (&self->text_rect, PADDING_X, PADDING_Y, text_width, MAX (height - 2 * PADDING_Y, 0));
+	pango_layout_set_width (self->title_layout, text_width * PANGO_SCALE);
+	pango_layout_set_width (self->subtitle_layout, text_width * PANGO_SCALE);
+
+	if (rtl) {
+		self->status_rect.origin.x = width - self->status_rect.origin.x - self->status_rect.size.width;
+		self->text_rect.origin.x = width - self->text_rect.origin.x - self->text_rect.size.width;
+		for (i = 0; i < N_CONTROLS; i++)
+			self->control_rects[i].origin.x = width - self->control_rects[i].origin.x - CONTROL_SIZE;
+	}
+}
+
+static gboolean
+classlimit_subject_row_query_tooltip (GtkWidget  *widget,
+                                      int         x,
+                                      int         y,
+                                      gboolean    keyboard_tooltip,
+                                      GtkTooltip *tooltip)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (widget);
+	Control control = control_at (self, x, y);
+
+	if (keyboard_tooltip || control == CONTROL_NONE)
+		return FALSE;
+
+	gtk_tooltip_set_text (tooltip, control_tooltip (control));
+	gtk_tooltip_set_tip_area (tooltip, &(GdkRectangle) {
+		self->control_rects[control].origin.x, self->control_rects[control].origin.y,
+		CONTROL_SIZE, CONTROL_SIZE });
+
+	return TRUE;
+}
+
+static void
+classlimit_subject_row_css_changed (GtkWidget         *widget,
+                                    GtkCssStyleChange *change)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (widget);
+
+	GTK_WIDGET_CLASS (classlimit_subject_row_parent_class)->css_changed (widget, change);
+
+	/* Fonts or the icon theme may have changed under us */
+	create_layouts (self);
+	clear_icons (self);
+	gtk_widget_queue_resize (widget);
+}
+
+static void
+classlimit_subject_row_direction_changed (GtkWidget        *widget,
+                                          GtkTextDirection  previous_direction)
+{
+	clear_icons (CLASSLIMIT_SUBJECT_ROW (widget));
+	gtk_widget_queue_allocate (widget);
+}
+
+static void
+set_hovered (ClasslimitSubjectRow *self,
+             Control               control)
+{
+	if (self->hovered == control)
+		return;
+
+	self->hovered = control;
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static void
+on_motion (GtkEventControllerMotion *controller,
+           double                    x,
+           double                    y,
+           ClasslimitSubjectRow     *self)
+{
+	set_hovered (self, control_at (self, x, y));
+}
+
+static void
+on_leave (GtkEventControllerMotion *controller,
+          ClasslimitSubjectRow     *self)
+{
+	set_hovered (self, CONTROL_NONE);
+}
+
+static void
+on_pressed (GtkGestureClick      *gesture,
+            int                   n_press,
+            double                x,
+            double                y,
+            ClasslimitSubjectRow *self)
+{
+	self->pressed = control_at (self, x, y);
+	if (self->pressed == CONTROL_NONE)
+		return;
+
+	/* Keep the list from treating control clicks as row activation */
+	gtk_gesture_set_state (GTK_GESTURE (gesture), GTK_EVENT_SEQUENCE_CLAIMED);
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static void
+on_released (GtkGestureClick      *gesture,
+             int                   n_press,
+             double                x,
+             double                y,
+             ClasslimitSubjectRow *self)
+{
+	Control pressed = self->pressed;
+
+	self->pressed = CONTROL_NONE;
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+
+	if (pressed != CONTROL_NONE && pressed == control_at (self, x, y) && self->subject)
+		g_signal_emit (self, signals[SUBJECT_ACTION], 0, (guint) control_actions[pressed]);
+}
+
+static void
+on_cancel (GtkGesture           *gesture,
+           GdkEventSequence     *sequence,
+           ClasslimitSubjectRow *self)
+{
+	self->pressed = CONTROL_NONE;
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+/* Keyboard equivalents of the drawn controls, see the class bindings */
+static void
+row_action_activated (GtkWidget  *widget,
+                      const char *action_name,
+                      GVariant   *parameter)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (widget);
+	ClasslimitActionKind kind;
+
+	if (self->subject == NULL)
+		return;
+
+	if (g_str_equal (action_name, "row.increment"))
+		kind = CLASSLIMIT_ACTION_SKIP_INCREMENT;
+	else if (g_str_equal (action_name, "row.decrement"))
+		kind = CLASSLIMIT_ACTION_SKIP_DECREMENT;
+	else if (g_str_equal (action_name, "row.reset"))
+		kind = CLASSLIMIT_ACTION_SKIP_RESET;
+	else
+		kind = CLASSLIMIT_ACTION_REMOVE;
+
+	g_signal_emit (self, signals[SUBJECT_ACTION], 0, (guint) kind);
+}
+
+static void
+classlimit_subject_row_dispose (GObject *object)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (object);
+	guint i;
+
+	classlimit_subject_row_set_subject (self, NULL);
+	for (i = 0; i < N_CONTROLS; i++) {
+		if (self->controls[i])
+			self->controls[i]->row = NULL;
+		g_clear_object (&self->controls[i]);
+	}
+	g_clear_object (&self->title_layout);
+	g_clear_object (&self->subtitle_layout);
+	clear_icons (self);
+
+	G_OBJECT_CLASS (classlimit_subject_row_parent_class)->dispose (object);
+}
+
+static void
+classlimit_subject_row_get_property (GObject    *object,
+                                     guint       prop_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (object);
+
+	switch (prop_id) {
+	case PROP_SUBJECT:
+		g_value_set_object (value, self->subject);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_subject_row_set_property (GObject      *object,
+                                     guint         prop_id,
+                                     const GValue *value,
+                                     GParamSpec   *pspec)
+{
+	ClasslimitSubjectRow *self = CLASSLIMIT_SUBJECT_ROW (object);
+
+	switch (prop_id) {
+	case PROP_SUBJECT:
+		classlimit_subject_row_set_subject (self, g_value_get_object (value));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_subject_row_class_init (ClasslimitSubjectRowClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+	object_class->dispose = classlimit_subject_row_dispose;
+	object_class->get_property = classlimit_subject_row_get_property;
+	object_class->set_property = classlimit_subject_row_set_property;
+
+	widget_class->snapshot = classlimit_subject_row_snapshot;
+	widget_class->measure = classlimit_subject_row_measure;
+	widget_class->size_allocate = classlimit_subject_row_size_allocate;
+	widget_class->query_tooltip = classlimit_subject_row_query_tooltip;
+	widget_class->css_changed = classlimit_subject_row_css_changed;
+	widget_class->direction_changed = classlimit_subject_row_direction_changed;
+
+	properties [PROP_SUBJECT] =
+		g_param_spec_object ("subject", NULL, NULL,
+		                     CLASSLIMIT_TYPE_SUBJECT,
+		                     (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_properties (object_class, N_PROPS, properties);
+
+	/**
+	 * ClasslimitSubjectRow::subject-action:
+	 * @kind: the #ClasslimitActionKind the user asked for
+	 *
+	 * Emitted when one of the skip or remove controls is clicked, or
+	 * triggered from the keyboard.
+	 */
+	signals [SUBJECT_ACTION] =
+		g_signal_new ("subject-action",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 1, G_TYPE_UINT);
+
+	gtk_widget_class_install_action (widget_class, "row.increment", NULL, row_action_activated);
+	gtk_widget_class_install_action (widget_class, "row.decrement", NULL, row_action_activated);
+	gtk_widget_class_install_action (widget_class, "row.reset", NULL, row_action_activated);
+	gtk_widget_class_install_action (widget_class, "row.remove", NULL, row_action_activated);
+
+	gtk_widget_class_add_binding_action (widget_class, GDK_KEY_plus, 0, "row.increment", NULL);
+	gtk_widget_class_add_binding_action (widget_class, GDK_KEY_equal, 0, "row.increment", NULL);
+	gtk_widget_class_add_binding_action (widget_class, GDK_KEY_KP_Add, 0, "row.increment", NULL);
+	gtk_widget_class_add_binding_action (widget_class, GDK_KEY_minus, 0, "row.decrement", NULL);
+	gtk_widget_class_add_binding_action (widget_class, GDK_KEY_KP_Subtract, 0, "row.decrement", NULL);
+	gtk_widget_class_add_binding_action (widget_class, GDK_KEY_r, 0, "row.reset", NULL);
+	gtk_widget_class_add_binding_action (widget_class, GDK_KEY_Delete, 0, "row.remove", NULL);
+	gtk_widget_class_add_binding_action (widget_class, GDK_KEY_KP_Delete, 0, "row.remove", NULL);
+
+	gtk_widget_class_set_css_name (widget_class, "subjectrow");
+	gtk_widget_class_set_accessible_role (widget_class, GTK_ACCESSIBLE_ROLE_GROUP);
+}
+
+static void
+classlimit_subject_row_init (ClasslimitSubjectRow *self)
+{
+	GtkGesture *click;
+	GtkEventController *motion;
+	guint i;
+
+	self->hovered = CONTROL_NONE;
+	self->pressed = CONTROL_NONE;
+
+	gtk_widget_set_focusable (GTK_WIDGET (self), TRUE);
+	gtk_widget_set_has_tooltip (GTK_WIDGET (self), TRUE);
+
+	click = gtk_gesture_click_new ();
+	gtk_gesture_single_set_button (GTK_GESTURE_SINGLE (click), GDK_BUTTON_PRIMARY);
+	g_signal_connect (click, "pressed", G_CALLBACK (on_pressed), self);
+	g_signal_connect (click, "released", G_CALLBACK (on_released), self);
+	g_signal_connect (click, "cancel", G_CALLBACK (on_cancel), self);
+	gtk_widget_add_controller (GTK_WIDGET (self), GTK_EVENT_CONTROLLER (click));
+
+	motion = gtk_event_controller_motion_new ();
+	g_signal_connect (motion, "enter", G_CALLBACK (on_motion), self);
+	g_signal_connect (motion, "motion", G_CALLBACK (on_motion), self);
+	g_signal_connect (motion, "leave", G_CALLBACK (on_leave), self);
+	gtk_widget_add_controller (GTK_WIDGET (self), motion);
+
+	gtk_accessible_update_property (GTK_ACCESSIBLE (self),
+	                                GTK_ACCESSIBLE_PROPERTY_KEY_SHORTCUTS, "plus minus r Delete",
+	                                -1);
+	for (i = 0; i < N_CONTROLS; i++)
+		self->controls[i] = control_new (self, i);
+
+	create_layouts (self);
+}
+
+GtkWidget *
+classlimit_subject_row_new (void)
+{
+	return g_object_new (CLASSLIMIT_TYPE_SUBJECT_ROW, NULL);
+}
+
+ClasslimitSubject *
+classlimit_subject_row_get_subject (ClasslimitSubjectRow *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT_ROW (self), NULL);
+
+	return self->subject;
+}
+
+void
+classlimit_subject_row_set_subject (ClasslimitSubjectRow *self,
+                                    ClasslimitSubject    *subject)
+{
+	g_return_if_fail (CLASSLIMIT_IS_SUBJECT_ROW (self));
+	g_return_if_fail (!subject || CLASSLIMIT_IS_SUBJECT (subject));
+
+	if (self->subject == subject)
+		return;
+
+	if (self->subject)
+		g_clear_signal_handler (&self->notify_id, self->subject);
+	g_set_object (&self->subject, subject);
+	if (self->subject)
+		self->notify_id = g_signal_connect_object (self->subject, "notify",
+		                                           G_CALLBACK (on_subject_notify), self,
+		                                           G_CONNECT_SWAPPED);
+
+	/* Only a longer title changes our size, everything else is a redraw */
+	update_text (self);
+	gtk_widget_queue_resize (GTK_WIDGET (self));
+	g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_SUBJECT]);
+}
@@ -0,0 +1,38 @@
+/* classlimit-subject-row.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include "classlimit-subject.h"
+
+G_BEGIN_DECLS
+
+#define CLASSLIMIT_TYPE_SUBJECT_ROW (classlimit_subject_row_get_type())
+
+G_DECLARE_FINAL_TYPE (ClasslimitSubjectRow, classlimit_subject_row, CLASSLIMIT, SUBJECT_ROW, GtkWidget)
+
+GtkWidget         *classlimit_subject_row_new         (void);
+ClasslimitSubject *classlimit_subject_row_get_subject (ClasslimitSubjectRow *self);
+void               classlimit_subject_row_set_subject (ClasslimitSubjectRow *self,
+                                                       ClasslimitSubject    *subject);
+
+G_END_DECLS
@@ -0,0 +1,318 @@
+/* classlimit-subject.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "classlimit-subject.h"
+
+struct _ClasslimitSubject
+{
+	GObject parent_instance;
+
+	char *name;
+	char *collate_key;
+	int   weekly_hours;
+	int   current_skips;
+	int   total_classes;
+	int   allowed_skips;
+
+	/* Rule the roster resolved for this subject, see classlimit-policy.h */
+	guint policy;
+
+	/* Whether total_classes/allowed_skips match the current inputs */
+	guint results_valid : 1;
+};
+
+G_DEFINE_FINAL_TYPE (ClasslimitSubject, classlimit_subject, G_TYPE_OBJECT)
+
+enum {
+	PROP_0,
+	PROP_NAME,
+	PROP_WEEKLY_HOURS,
+	PROP_CURRENT_SKIPS,
+	PROP_TOTAL_CLASSES,
+	PROP_ALLOWED_SKIPS,
+	N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+ClasslimitSubject *
+classlimit_subject_new (const char *name,
+                        int         weekly_hours)
+{
+	g_return_val_if_fail (name != NULL, NULL);
+
+	return g_object_new (CLASSLIMIT_TYPE_SUBJECT,
+	                     "name", name,
+	                     "weekly-hours", MAX (weekly_hours, 0),
+	                     NULL);
+}
+
+static void
+classlimit_subject_finalize (GObject *object)
+{
+	ClasslimitSubject *self = (ClasslimitSubject *)object;
+
+	g_free (self->name);
+	g_free (self->collate_key);
+
+	G_OBJECT_CLASS (classlimit_subject_parent_class)->finalize (object);
+}
+
+static void
+classlimit_subject_get_property (GObject    *object,
+                                 guint       prop_id,
+                                 GValue     *value,
+                                 GParamSpec *pspec)
+{
+	ClasslimitSubject *self = CLASSLIMIT_SUBJECT (object);
+
+	switch (prop_id) {
+	case PROP_NAME:
+		g_value_set_string (value, self->name);
+		break;
+	case PROP_WEEKLY_HOURS:
+		g_value_set_int (value, self->weekly_hours);
+		break;
+	case PROP_CURRENT_SKIPS:
+		g_value_set_int (value, self->current_skips);
+		break;
+	case PROP_TOTAL_CLASSES:
+		g_value_set_int (value, self->total_classes);
+		break;
+	case PROP_ALLOWED_SKIPS:
+		g_value_set_int (value, self->allowed_skips);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_subject_set_property (GObject      *object,
+                                 guint         prop_id,
+                                 const GValue *value,
+                                 GParamSpec   *pspec)
+{
+	ClasslimitSubject *self = CLASSLIMIT_SUBJECT (object);
+
+	switch (prop_id) {
+	case PROP_NAME:
+		self->name = g_value_dup_string (value);
+		break;
+	case PROP_WEEKLY_HOURS:
+		classlimit_subject_set_weekly_hours (self, g_value_get_int (value));
+		break;
+	case PROP_CURRENT_SKIPS:
+		classlimit_subject_set_current_skips (self, g_value_get_int (value));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_subject_class_init (ClasslimitSubjectClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = classlimit_subject_finalize;
+	object_class->get_property = classlimit_subject_get_property;
+	object_class->set_property = classlimit_subject_set_property;
+
+	properties [PROP_NAME] =
+		g_param_spec_string ("name", NULL, NULL,
+		                     NULL,
+		                     (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+	properties [PROP_WEEKLY_HOURS] =
+		g_param_spec_int ("weekly-hours", NULL, NULL,
+		                  0, G_MAXINT, 0,
+		                  (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+	properties [PROP_CURRENT_SKIPS] =
+		g_param_spec_int ("current-skips", NULL, NULL,
+		                  0, G_MAXINT, 0,
+		                  (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+	properties [PROP_TOTAL_CLASSES] =
+		g_param_spec_int ("total-classes", NULL, NULL,
+		                  0, G_MAXINT, 0,
+		                  (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	properties [PROP_ALLOWED_SKIPS] =
+		g_param_spec_int ("allowed-skips", NULL, NULL,
+		                  0, G_MAXINT, 0,
+		                  (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+classlimit_subject_init (ClasslimitSubject *self)
+{
+}
+
+const char *
+classlimit_subject_get_name (ClasslimitSubject *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (self), NULL);
+
+	return self->name;
+}
+
+/* Sorting by name compares these with strcmp(). Names are construct-only
+ * and LC_COLLATE is fixed at startup, so a key never goes stale.
+ */
+const char *
+classlimit_subject_get_collate_key (ClasslimitSubject *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (self), NULL);
+
+	if (self->collate_key == NULL)
+		self->collate_key = g_utf8_collate_key (self->name, -1);
+
+	return self->collate_key;
+}
+
+int
+classlimit_subject_get_weekly_hours (ClasslimitSubject *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (self), 0);
+
+	return self->weekly_hours;
+}
+
+void
+classlimit_subject_set_weekly_hours (ClasslimitSubject *self,
+                                     int                weekly_hours)
+{
+	g_return_if_fail (CLASSLIMIT_IS_SUBJECT (self));
+
+	weekly_hours = MAX (weekly_hours, 0);
+	if (self->weekly_hours == weekly_hours)
+		return;
+
+	self->weekly_hours = weekly_hours;
+	self->results_valid = FALSE;
+	g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_WEEKLY_HOURS]);
+}
+
+int
+classlimit_subject_get_current_skips (ClasslimitSubject *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (self), 0);
+
+	return self->current_skips;
+}
+
+void
+classlimit_subject_set_current_skips (ClasslimitSubject *self,
+                                      int                current_skips)
+{
+	g_return_if_fail (CLASSLIMIT_IS_SUBJECT (self));
+
+	current_skips = MAX (current_skips, 0);
+	if (self->current_skips == current_skips)
+		return;
+
+	self->current_skips = current_skips;
+	g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_CURRENT_SKIPS]);
+}
+
+int
+classlimit_subject_get_total_classes (ClasslimitSubject *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (self), 0);
+
+	return self->total_classes;
+}
+
+int
+classlimit_subject_get_allowed_skips (ClasslimitSubject *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (self), 0);
+
+	return self->allowed_skips;
+}
+
+void
+classlimit_subject_set_results (ClasslimitSubject *self,
+                                int                total_classes,
+                                int                allowed_skips)
+{
+	g_return_if_fail (CLASSLIMIT_IS_SUBJECT (self));
+
+	self->results_valid = TRUE;
+	g_object_freeze_notify (G_OBJECT (self));
+	if (self->total_classes != total_classes) {
+		self->total_classes = total_classes;
+		g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_TOTAL_CLASSES]);
+	}
+	if (self->allowed_skips != allowed_skips) {
+		self->allowed_skips = allowed_skips;
+		g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_ALLOWED_SKIPS]);
+	}
+	g_object_thaw_notify (G_OBJECT (self));
+}
+
+gboolean
+classlimit_subject_get_results_valid (ClasslimitSubject *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (self), FALSE);
+
+	return self->results_valid;
+}
+
+/* Marks the results as needing a recalculation without touching the
+ * values, so views keep showing the last ones until then.
+ */
+void
+classlimit_subject_invalidate_results (ClasslimitSubject *self)
+{
+	g_return_if_fail (CLASSLIMIT_IS_SUBJECT (self));
+
+	self->results_valid = FALSE;
+}
+
+int
+classlimit_subject_get_remaining (ClasslimitSubject *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (self), 0);
+
+	return self->allowed_skips - self->current_skips;
+}
+
+guint
+classlimit_subject_get_policy (ClasslimitSubject *self)
+{
+	g_return_val_if_fail (CLASSLIMIT_IS_SUBJECT (self), 0);
+
+	return self->policy;
+}
+
+/* Set by the roster whenever the policies change; results only need
+ * recomputing if the rule behind the new index differs from the old one.
+ */
+void
+classlimit_subject_set_policy (ClasslimitSubject *self,
+                               guint              policy)
+{
+	g_return_if_fail (CLASSLIMIT_IS_SUBJECT (self));
+
+	self->policy = policy;
+}
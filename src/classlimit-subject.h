@@ -0,0 +1,53 @@
+/* classlimit-subject.h
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define CLASSLIMIT_TYPE_SUBJECT (classlimit_subject_get_type())
+
+G_DECLARE_FINAL_TYPE (ClasslimitSubject, classlimit_subject, CLASSLIMIT, SUBJECT, GObject)
+
+ClasslimitSubject *classlimit_subject_new                (const char        *name,
+                                                          int                weekly_hours);
+const char        *classlimit_subject_get_name           (ClasslimitSubject *self);
+const char        *classlimit_subject_get_collate_key    (ClasslimitSubject *self);
+int                classlimit_subject_get_weekly_hours   (ClasslimitSubject *self);
+void               classlimit_subject_set_weekly_hours   (ClasslimitSubject *self,
+                                                          int                weekly_hours);
+int                classlimit_subject_get_current_skips  (ClasslimitSubject *self);
+void               classlimit_subject_set_current_skips  (ClasslimitSubject *self,
+                                                          int                current_skips);
+int                classlimit_subject_get_total_classes  (ClasslimitSubject *self);
+int                classlimit_subject_get_allowed_skips  (ClasslimitSubject *self);
+void               classlimit_subject_set_results        (ClasslimitSubject *self,
+                                                          int                total_classes,
+                                                          int                allowed_skips);
+gboolean           classlimit_subject_get_results_valid  (ClasslimitSubject *self);
+void               classlimit_subject_invalidate_results (ClasslimitSubject *self);
+int                classlimit_subject_get_remaining      (ClasslimitSubject *self);
+guint              classlimit_subject_get_policy         (ClasslimitSubject *self);
+void               classlimit_subject_set_policy         (ClasslimitSubject *self,
+                                                          guint              policy);
+
+G_END_DECLS
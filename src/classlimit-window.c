@@ -20,9 +20,38 @@
 
 #include "config.h"
 #include <glib/gi18n.h>
-#include <json-glib/json-glib.h>
 
 #include "classlimit-window.h"
+#include "classlimit-action.h"
+#include "classlimit-application.h"
+#include "classlimit-archive.h"
+#include "classlimit-chart.h"
+#include "classlimit-csv.h"
+#include "classlimit-frame-monitor.h"
+#include "classlimit-history.h"
+#include "classlimit-importer.h"
+#include "classlimit-profiler.h"
+#include "classlimit-recorder.h"
+#include "classlimit-roster.h"
+#include "classlimit-subject-row.h"
+
+typedef enum {
+	SORT_ADDED,
+	SORT_NAME,
+	SORT_HOURS,
+	SORT_ALLOWANCE,
+	SORT_REMAINING,
+	N_SORT_KEYS
+} SortKey;
+
+/* Values of the sort-by key, in the order of the sort dropdown */
+static const char *sort_key_names[N_SORT_KEYS] = {
+	[SORT_ADDED]     = "added",
+	[SORT_NAME]      = "name",
+	[SORT_HOURS]     = "hours",
+	[SORT_ALLOWANCE] = "allowance",
+	[SORT_REMAINING] = "remaining",
+};
 
 struct _ClasslimitWindow
 {
@@ -30,17 +59,74 @@ struct _ClasslimitWindow
 
 	/* Template widgets */
 	AdwViewStack   *view_stack;
-	GtkListBox     *subjects_list;
+	GtkListView    *subjects_list;
+	GtkDropDown    *sort_dropdown;
+	GtkRevealer    *import_revealer;
+	GtkProgressBar *import_progress;
+	GtkRevealer    *selection_revealer;
+	GtkLabel       *selection_label;
+	GtkSpinButton  *bulk_skips_spin;
+	GtkSpinButton  *bulk_hours_spin;
 	GtkEntry       *subject_name_entry;
 	GtkSpinButton  *subject_hours_spin;
 	GtkButton      *add_subject_button;
 	GtkSpinButton  *percent_spin;
 	GtkSpinButton  *weeks_spin;
 	GtkSpinButton  *session_hours_spin;
+	GtkListBox     *policies_list;
+	AdwEntryRow    *policy_name_entry;
+	AdwEntryRow    *policy_subjects_entry;
+	AdwSpinRow     *policy_attendance_spin;
+	AdwSpinRow     *policy_session_hours_spin;
+	AdwSpinRow     *policy_weeks_spin;
+	AdwEntryRow    *csv_name_entry;
+	AdwEntryRow    *csv_hours_entry;
+	AdwEntryRow    *csv_skips_entry;
+	AdwEntryRow    *csv_delimiter_entry;
 	GtkButton      *calculate_button;
 	GtkStack       *results_stack;
 	GtkListBox     *results_list;
 	GtkWidget      *results_page;
+	GtkDropDown    *history_series_dropdown;
+	ClasslimitChart *history_chart;
+	AdwViewStackPage *debug_stack_page;
+	GtkListBox     *debug_list;
+	GtkButton      *debug_reset_button;
+
+	/* Debug statistics page */
+	GtkWidget      *debug_rows[CLASSLIMIT_N_PROBES];
+	GtkWidget      *debug_frames_row;
+	guint           debug_refresh_id;
+
+	/* Opt-in frame timing, see CLASSLIMIT_FRAME_TRACE */
+	ClasslimitFrameMonitor *frame_monitor;
+	char                   *frame_trace_path;
+
+	/* Opt-in action log, owned by the application */
+	ClasslimitRecorder *recorder;
+
+	/* Model, shared with every other window */
+	ClasslimitRoster *roster;
+	GtkSortListModel *sort_model;
+	GtkSorter      *sorter;
+	SortKey         sort_key;
+	GtkSelectionModel *selection;
+
+	/* Folder import in progress, if any */
+	ClasslimitImporter *importer;
+	GCancellable   *import_cancellable;
+	char           *import_location;
+
+	/* Policies the list on the settings page was built from */
+	GVariant       *shown_policies;
+
+	/* History page; the chart has been fed the first history_fed
+	 * samples of history_series.
+	 */
+	ClasslimitHistory *history;
+	GtkStringList  *history_series_names;
+	guint           history_series;
+	guint           history_fed;
 
 	/* Settings */
 	GSettings      *settings;
@@ -48,23 +134,47 @@ struct _ClasslimitWindow
 
 G_DEFINE_FINAL_TYPE (ClasslimitWindow, classlimit_window, ADW_TYPE_APPLICATION_WINDOW)
 
-static void recalc_results (ClasslimitWindow *self);
+enum {
+	PROP_0,
+	PROP_ROSTER,
+	N_PROPS
+};
 
-typedef struct {
-	gchar *name;
-	int weekly_hours;
-	int current_skips;
-	int total_classes;
-	int allowed_skips;
-} Subject;
+static GParamSpec *properties [N_PROPS];
+
+static void recalc_results (ClasslimitWindow *self);
 
-static void subject_free (Subject *s) {
-	if (!s) return;
-	g_free (s->name);
-	g_free (s);
+/* Every user-visible change to the model goes through here so it can be
+ * recorded for replay and attributed in the frame trace.
+ */
+static void
+record_action (ClasslimitWindow *self, ClasslimitAction *action)
+{
+	if (self->recorder)
+		classlimit_recorder_log (self->recorder, action);
+	if (self->frame_monitor)
+		classlimit_frame_monitor_mark_action (self->frame_monitor,
+			classlimit_action_kind_to_string (action->kind));
 }
 
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(Subject, subject_free)
+/* Failures are only logged unless the caller asks for the error */
+static gboolean
+perform_action (ClasslimitWindow *self, ClasslimitAction *action, ClasslimitTotals *totals, GError **error)
+{
+	g_autoptr(GError) local_error = NULL;
+
+	record_action (self, action);
+
+	if (!classlimit_action_apply (action, self->roster, totals, &local_error)) {
+		if (error)
+			g_propagate_error (error, g_steal_pointer (&local_error));
+		else
+			g_warning ("Failed to %s: %s", classlimit_action_kind_to_string (action->kind), local_error->message);
+		return FALSE;
+	}
+
+	return TRUE;
+}
 
 static gboolean
 animate_row_opacity (gpointer data)
@@ -81,177 +191,264 @@ animate_row_opacity (gpointer data)
 }
 
 static void
-on_remove_subject_clicked (GtkButton *b, gpointer user_data)
+on_subject_action (ClasslimitSubjectRow *row, guint kind, gpointer user_data)
 {
 	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
-	GtkWidget *row = gtk_widget_get_ancestor (GTK_WIDGET (b), GTK_TYPE_LIST_BOX_ROW);
-	GtkWidget *parent;
-	if (!row)
+	ClasslimitSubject *s = classlimit_subject_row_get_subject (row);
+	ClasslimitAction action = { .kind = kind };
+
+	/* Rows are recycled, so resolve the position only when it is needed */
+	if (!s || !classlimit_roster_find (self->roster, s, &action.position))
 		return;
-	parent = gtk_widget_get_parent (row);
-	if (GTK_IS_LIST_BOX (parent)) {
-		gtk_list_box_remove (GTK_LIST_BOX (parent), row);
-		/* Auto-recalculate after removal if currently on results page */
-		if (adw_view_stack_get_visible_child (self->view_stack) == self->results_page)
-			recalc_results (self);
+
+	perform_action (self, &action, NULL, NULL);
+
+	/* Auto-recalculate after removal if currently on results page */
+	if (kind == CLASSLIMIT_ACTION_REMOVE &&
+	    adw_view_stack_get_visible_child (self->view_stack) == self->results_page)
+		recalc_results (self);
+}
+
+static void
+setup_subject_row (GtkSignalListItemFactory *factory, GtkListItem *item, gpointer user_data)
+{
+	GtkWidget *row = classlimit_subject_row_new ();
+
+	/* The row handles its own keyboard shortcuts, so it takes the focus */
+	gtk_list_item_set_focusable (item, FALSE);
+	gtk_list_item_set_activatable (item, FALSE);
+	g_signal_connect (row, "subject-action", G_CALLBACK (on_subject_action), user_data);
+	gtk_list_item_set_child (item, row);
+}
+
+static void
+bind_subject_row (GtkSignalListItemFactory *factory, GtkListItem *item, gpointer user_data)
+{
+	classlimit_subject_row_set_subject (CLASSLIMIT_SUBJECT_ROW (gtk_list_item_get_child (item)),
+		gtk_list_item_get_item (item));
+}
+
+static void
+unbind_subject_row (GtkSignalListItemFactory *factory, GtkListItem *item, gpointer user_data)
+{
+	classlimit_subject_row_set_subject (CLASSLIMIT_SUBJECT_ROW (gtk_list_item_get_child (item)), NULL);
+}
+
+/* Names compare by cached collation key, so sorting never calls into
+ * the full collation algorithm after the first time a name is seen.
+ * Other keys fall back to the name for ties.
+ */
+static int
+compare_subjects (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	ClasslimitSubject *sa = (ClasslimitSubject *) a;
+	ClasslimitSubject *sb = (ClasslimitSubject *) b;
+	int x = 0, y = 0;
+
+	switch (self->sort_key) {
+	case SORT_HOURS:
+		x = classlimit_subject_get_weekly_hours (sa);
+		y = classlimit_subject_get_weekly_hours (sb);
+		break;
+	case SORT_ALLOWANCE:
+		x = classlimit_subject_get_allowed_skips (sa);
+		y = classlimit_subject_get_allowed_skips (sb);
+		break;
+	case SORT_REMAINING:
+		x = classlimit_subject_get_remaining (sa);
+		y = classlimit_subject_get_remaining (sb);
+		break;
+	case SORT_ADDED:
+	case SORT_NAME:
+	case N_SORT_KEYS:
+	default:
+		break;
 	}
+
+	if (x != y)
+		return x < y ? GTK_ORDERING_SMALLER : GTK_ORDERING_LARGER;
+
+	return gtk_ordering_from_cmpfunc (strcmp (classlimit_subject_get_collate_key (sa),
+	                                          classlimit_subject_get_collate_key (sb)));
 }
 
 static void
-on_skip_increment_clicked (GtkButton *b, gpointer user_data)
+set_sort_key (ClasslimitWindow *self, SortKey sort_key)
 {
-	GtkWidget *row = gtk_widget_get_ancestor (GTK_WIDGET (b), GTK_TYPE_LIST_BOX_ROW);
-	Subject *s;
-	GtkWidget *status_image;
-	char subtitle[128];
-	int remaining;
-	
-	if (!row) return;
-	s = g_object_get_data (G_OBJECT (row), "subject");
-	if (!s) return;
-	
-	s->current_skips++;
-	
-	remaining = s->allowed_skips - s->current_skips;
-	if (s->allowed_skips > 0)
-		g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d • Remaining: %d"), s->weekly_hours, s->current_skips, remaining);
-	else
-		g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d"), s->weekly_hours, s->current_skips);
-	adw_action_row_set_subtitle (ADW_ACTION_ROW (row), subtitle);
-	status_image = g_object_get_data (G_OBJECT (row), "status-image");
-	if (GTK_IS_WIDGET (status_image)) {
-		if (s->allowed_skips == 0)
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "view-statistics-symbolic");
-		else if (remaining < 0)
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "dialog-error-symbolic");
-		else if (remaining <= 2)
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "dialog-warning-symbolic");
-		else
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "emblem-ok-symbolic");
+	if (self->sort_key == sort_key)
+		return;
+
+	self->sort_key = sort_key;
+
+	/* Without a sorter the model passes the roster order straight through */
+	if (sort_key == SORT_ADDED) {
+		gtk_sort_list_model_set_sorter (self->sort_model, NULL);
+	} else if (gtk_sort_list_model_get_sorter (self->sort_model) == NULL) {
+		gtk_sort_list_model_set_sorter (self->sort_model, self->sorter);
+	} else {
+		gtk_sorter_changed (self->sorter, GTK_SORTER_CHANGE_DIFFERENT);
 	}
+
+	gtk_drop_down_set_selected (self->sort_dropdown, sort_key);
 }
 
 static void
-on_skip_decrement_clicked (GtkButton *b, gpointer user_data)
+on_sort_setting_changed (ClasslimitWindow *self)
 {
-	GtkWidget *row = gtk_widget_get_ancestor (GTK_WIDGET (b), GTK_TYPE_LIST_BOX_ROW);
-	Subject *s;
-	GtkWidget *status_image;
-	char subtitle[128];
-	int remaining;
-	
-	if (!row) return;
-	s = g_object_get_data (G_OBJECT (row), "subject");
-	if (!s) return;
-	
-	if (s->current_skips > 0)
-		s->current_skips--;
-	
-	remaining = s->allowed_skips - s->current_skips;
-	if (s->allowed_skips > 0)
-		g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d • Remaining: %d"), s->weekly_hours, s->current_skips, remaining);
-	else
-		g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d"), s->weekly_hours, s->current_skips);
-	adw_action_row_set_subtitle (ADW_ACTION_ROW (row), subtitle);
-	status_image = g_object_get_data (G_OBJECT (row), "status-image");
-	if (GTK_IS_WIDGET (status_image)) {
-		if (s->allowed_skips == 0)
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "view-statistics-symbolic");
-		else if (remaining < 0)
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "dialog-error-symbolic");
-		else if (remaining <= 2)
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "dialog-warning-symbolic");
-		else
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "emblem-ok-symbolic");
+	g_autofree char *value = g_settings_get_string (self->settings, "sort-by");
+	guint i;
+
+	for (i = 0; i < N_SORT_KEYS; i++) {
+		if (g_str_equal (value, sort_key_names[i])) {
+			set_sort_key (self, i);
+			break;
+		}
 	}
 }
 
 static void
-on_skip_reset_clicked (GtkButton *b, gpointer user_data)
+on_sort_selected (ClasslimitWindow *self)
 {
-	GtkWidget *row = gtk_widget_get_ancestor (GTK_WIDGET (b), GTK_TYPE_LIST_BOX_ROW);
-	Subject *s;
-	GtkWidget *status_image;
-	char subtitle[128];
-	
-	if (!row) return;
-	s = g_object_get_data (G_OBJECT (row), "subject");
-	if (!s) return;
-	
-	s->current_skips = 0;
-	
-	if (s->allowed_skips > 0)
-		g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d • Remaining: %d"), s->weekly_hours, s->current_skips, s->allowed_skips);
-	else
-		g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d"), s->weekly_hours, s->current_skips);
-	adw_action_row_set_subtitle (ADW_ACTION_ROW (row), subtitle);
-	status_image = g_object_get_data (G_OBJECT (row), "status-image");
-	if (GTK_IS_WIDGET (status_image)) {
-		if (s->allowed_skips == 0)
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "view-statistics-symbolic");
-		else
-			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "emblem-ok-symbolic");
+	guint selected = gtk_drop_down_get_selected (self->sort_dropdown);
+
+	if (selected < N_SORT_KEYS)
+		g_settings_set_string (self->settings, "sort-by", sort_key_names[selected]);
+}
+
+/* Selection positions follow the sorted view, the roster wants its own */
+static GArray *
+get_selected_positions (ClasslimitWindow *self)
+{
+	g_autoptr(GtkBitset) selected = gtk_selection_model_get_selection (self->selection);
+	g_autoptr(GHashTable) subjects = NULL;
+	GArray *positions = g_array_sized_new (FALSE, FALSE, sizeof (guint), (guint) gtk_bitset_get_size (selected));
+	GtkBitsetIter iter;
+	guint position;
+	guint n_items;
+	guint i;
+
+	if (!gtk_bitset_iter_init_first (&iter, selected, &position))
+		return positions;
+
+	/* Bitsets iterate in ascending order, as the roster expects */
+	if (gtk_sort_list_model_get_sorter (self->sort_model) == NULL) {
+		do
+			g_array_append_val (positions, position);
+		while (gtk_bitset_iter_next (&iter, &position));
+		return positions;
+	}
+
+	/* One pass over the roster instead of a search per subject */
+	subjects = g_hash_table_new (NULL, NULL);
+	do {
+		g_autoptr(ClasslimitSubject) s = g_list_model_get_item (G_LIST_MODEL (self->sort_model), position);
+
+		g_hash_table_add (subjects, s);
+	} while (gtk_bitset_iter_next (&iter, &position));
+
+	n_items = g_list_model_get_n_items (G_LIST_MODEL (self->roster));
+	for (i = 0; i < n_items; i++) {
+		if (g_hash_table_contains (subjects, classlimit_roster_get_subject (self->roster, i)))
+			g_array_append_val (positions, i);
 	}
+
+	return positions;
 }
 
-static GtkWidget *
-create_subject_row (Subject *s, ClasslimitWindow *self)
-{
-	GtkWidget *row = adw_action_row_new ();
-	GtkWidget *controls;
-	GtkWidget *btn_minus;
-	GtkWidget *btn_plus;
-	GtkWidget *btn_reset;
-	GtkWidget *remove_btn;
-	GtkWidget *status_image;
-	char subtitle[64];
-
-	adw_preferences_row_set_title (ADW_PREFERENCES_ROW (row), s->name);
-	g_snprintf (subtitle, sizeof subtitle, _("%d h/week"), s->weekly_hours);
-	adw_action_row_set_subtitle (ADW_ACTION_ROW (row), subtitle);
-
-	/* Status indicator (updated after calculation) */
-	status_image = gtk_image_new_from_icon_name ("view-statistics-symbolic");
-	gtk_widget_add_css_class (status_image, "dim-label");
-	adw_action_row_add_suffix (ADW_ACTION_ROW (row), status_image);
-
-	/* Linked controls for skip tracking */
-	controls = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
-	gtk_widget_add_css_class (controls, "linked");
-
-	btn_minus = gtk_button_new_from_icon_name ("list-remove-symbolic");
-	gtk_widget_set_tooltip_text (btn_minus, _("Decrease skip count"));
-	gtk_widget_add_css_class (btn_minus, "flat");
-	adw_action_row_add_suffix (ADW_ACTION_ROW (row), controls);
-	gtk_box_append (GTK_BOX (controls), btn_minus);
-
-	btn_plus = gtk_button_new_from_icon_name ("list-add-symbolic");
-	gtk_widget_set_tooltip_text (btn_plus, _("Increase skip count"));
-	gtk_widget_add_css_class (btn_plus, "flat");
-	gtk_box_append (GTK_BOX (controls), btn_plus);
-
-	btn_reset = gtk_button_new_from_icon_name ("edit-clear-all-symbolic");
-	gtk_widget_set_tooltip_text (btn_reset, _("Reset skip count"));
-	gtk_widget_add_css_class (btn_reset, "flat");
-	gtk_box_append (GTK_BOX (controls), btn_reset);
-
-	/* Remove button at the end */
-	remove_btn = gtk_button_new_from_icon_name ("user-trash-symbolic");
-	gtk_widget_set_tooltip_text (remove_btn, _("Remove subject"));
-	gtk_widget_add_css_class (remove_btn, "flat");
-	adw_action_row_add_suffix (ADW_ACTION_ROW (row), remove_btn);
-
-	/* Data attachments */
-	g_object_set_data_full (G_OBJECT (row), "subject", s, (GDestroyNotify) subject_free);
-	g_object_set_data (G_OBJECT (row), "status-image", status_image);
-
-	/* Signals */
-	g_signal_connect (remove_btn, "clicked", G_CALLBACK (on_remove_subject_clicked), self);
-	g_signal_connect (btn_plus, "clicked", G_CALLBACK (on_skip_increment_clicked), self);
-	g_signal_connect (btn_minus, "clicked", G_CALLBACK (on_skip_decrement_clicked), self);
-	g_signal_connect (btn_reset, "clicked", G_CALLBACK (on_skip_reset_clicked), self);
-
-	return row;
+/* Selects and scrolls to the subject at a roster position, wherever the
+ * sorting put it
+ */
+static void
+on_show_subject_action (GSimpleAction *simple_action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	guint position = g_variant_get_uint32 (parameter);
+	ClasslimitSubject *subject;
+	guint n_items;
+	guint i;
+
+	n_items = g_list_model_get_n_items (G_LIST_MODEL (self->roster));
+	if (position >= n_items)
+		return;
+
+	if (gtk_sort_list_model_get_sorter (self->sort_model) != NULL) {
+		subject = classlimit_roster_get_subject (self->roster, position);
+		for (i = 0; i < n_items; i++) {
+			g_autoptr(ClasslimitSubject) s = g_list_model_get_item (G_LIST_MODEL (self->sort_model), i);
+
+			if (s == subject)
+				break;
+		}
+		if (i == n_items)
+			return;
+		position = i;
+	}
+
+	adw_view_stack_set_visible_child_name (self->view_stack, "subjects");
+	gtk_list_view_scroll_to (self->subjects_list, position,
+	                         GTK_LIST_SCROLL_SELECT | GTK_LIST_SCROLL_FOCUS, NULL);
+}
+
+static void
+update_selection_bar (ClasslimitWindow *self)
+{
+	g_autoptr(GtkBitset) selected = gtk_selection_model_get_selection (self->selection);
+	guint n_selected = (guint) gtk_bitset_get_size (selected);
+	g_autofree char *text = NULL;
+
+	gtk_revealer_set_reveal_child (self->selection_revealer, n_selected > 0);
+	if (n_selected == 0)
+		return;
+
+	text = g_strdup_printf (ngettext ("%u subject selected", "%u subjects selected", n_selected), n_selected);
+	gtk_label_set_label (self->selection_label, text);
+}
+
+static void
+on_unselect_all_action (GSimpleAction *simple_action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+
+	gtk_selection_model_unselect_all (self->selection);
+}
+
+/* However many subjects are selected, this is one action: one roster
+ * transaction, one save, one items-changed and at most one recalculation.
+ */
+static void
+on_bulk_action (GSimpleAction *simple_action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	const char *name = g_action_get_name (G_ACTION (simple_action));
+	ClasslimitAction action = { 0 };
+
+	if (g_str_equal (name, "bulk-add-skips")) {
+		action.kind = CLASSLIMIT_ACTION_BULK_ADD_SKIPS;
+		action.value = gtk_spin_button_get_value_as_int (self->bulk_skips_spin);
+	} else if (g_str_equal (name, "bulk-reset-skips")) {
+		action.kind = CLASSLIMIT_ACTION_BULK_RESET_SKIPS;
+	} else if (g_str_equal (name, "bulk-set-hours")) {
+		action.kind = CLASSLIMIT_ACTION_BULK_SET_HOURS;
+		action.value = gtk_spin_button_get_value_as_int (self->bulk_hours_spin);
+	} else {
+		action.kind = CLASSLIMIT_ACTION_BULK_REMOVE;
+	}
+
+	action.positions = get_selected_positions (self);
+	if (action.positions->len == 0) {
+		classlimit_action_clear (&action);
+		return;
+	}
+
+	perform_action (self, &action, NULL, NULL);
+
+	/* Keep visible results in step with the new allowances */
+	if ((action.kind == CLASSLIMIT_ACTION_BULK_SET_HOURS || action.kind == CLASSLIMIT_ACTION_BULK_REMOVE) &&
+	    adw_view_stack_get_visible_child (self->view_stack) == self->results_page)
+		recalc_results (self);
+
+	classlimit_action_clear (&action);
 }
 
 static void
@@ -259,24 +456,19 @@ on_add_subject_clicked (GtkButton *btn, gpointer user_data)
 {
 	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
 	const char *name = gtk_editable_get_text (GTK_EDITABLE (self->subject_name_entry));
+	ClasslimitAction action = { 0 };
 	int hours;
-	g_autoptr(Subject) s;
-	GtkWidget *row;
 	
 	if (!name || !*name) return;
 	hours = gtk_spin_button_get_value_as_int (self->subject_hours_spin);
 	if (hours <= 0) return;
 
-	s = g_new0 (Subject, 1);
-	s->name = g_strdup (name);
-	s->weekly_hours = hours;
-	s->current_skips = 0;
-	s->total_classes = 0;
-	s->allowed_skips = 0;
-	row = create_subject_row (s, self);
-	/* ownership of s transferred to row data */
-	g_steal_pointer (&s);
-	gtk_list_box_append (self->subjects_list, row);
+	action.kind = CLASSLIMIT_ACTION_ADD;
+	action.value = hours;
+	action.text = g_strdup (name);
+	perform_action (self, &action, NULL, NULL);
+	classlimit_action_clear (&action);
+
 	gtk_editable_set_text (GTK_EDITABLE (self->subject_name_entry), "");
 	gtk_spin_button_set_value (self->subject_hours_spin, 0);
 	gtk_widget_grab_focus (GTK_WIDGET (self->subject_name_entry));
@@ -285,112 +477,77 @@ on_add_subject_clicked (GtkButton *btn, gpointer user_data)
 static void
 clear_results (ClasslimitWindow *self)
 {
+	gint64 begin = classlimit_profiler_begin ();
+	guint n_rows = 0;
 	GtkWidget *child = gtk_widget_get_first_child (GTK_WIDGET (self->results_list));
 	while (child) {
 		GtkWidget *next = gtk_widget_get_next_sibling (child);
 		gtk_list_box_remove (self->results_list, child);
 		child = next;
+		n_rows++;
 	}
+	classlimit_profiler_end (CLASSLIMIT_PROBE_CLEAR_RESULTS, begin, n_rows);
 }
 
+/* Builds the Results page from the subjects' current results */
 static void
-recalc_results (ClasslimitWindow *self)
+populate_results (ClasslimitWindow *self, const ClasslimitTotals *totals)
 {
-	GtkWidget *row;
-	int weeks;
-	int required_pct;
-	int allowed_pct;
-	int total_allowed_all = 0;
-	int total_classes_all = 0;
-	int session_hours;
-	
-	/* Add subtle animation when recalculating */
-	gtk_widget_set_sensitive (GTK_WIDGET (self->calculate_button), FALSE);
-	
+	/* The session length all subjects are counted in, 0 if they differ */
+	int session_hours = -1;
+	guint n_rows;
+	guint i;
+
 	clear_results (self);
-	weeks = gtk_spin_button_get_value_as_int (self->weeks_spin);
-	required_pct = gtk_spin_button_get_value_as_int (self->percent_spin); /* attendance required */
-	session_hours = gtk_spin_button_get_value_as_int (self->session_hours_spin);
-	if (required_pct < 1) required_pct = 1;
-	if (session_hours < 1) session_hours = 1;
-	allowed_pct = 100 - required_pct; /* absence percentage allowed */
-
-	for (row = gtk_widget_get_first_child (GTK_WIDGET (self->subjects_list));
-		 row != NULL;
-		 row = gtk_widget_get_next_sibling (row)) {
-		Subject *s = g_object_get_data (G_OBJECT (row), "subject");
+	n_rows = g_list_model_get_n_items (G_LIST_MODEL (self->roster));
+
+	for (i = 0; i < n_rows; i++) {
+		ClasslimitSubject *s = classlimit_roster_get_subject (self->roster, i);
 		GtkWidget *result_row;
-		char buf[256];
+		GtkWidget *status_image;
 		char detail[128];
-		int total_classes, allowed_skip, total_sessions, allowed_skip_sessions;
-		int remaining;
+		int remaining = classlimit_subject_get_remaining (s);
+		int subject_session_hours = classlimit_roster_get_rule (self->roster, s)->session_hours;
 
-		if (!s) continue;
-		total_classes = s->weekly_hours * weeks;
-		allowed_skip = (total_classes * allowed_pct) / 100; /* floor */
-		total_sessions = total_classes / session_hours;
-		allowed_skip_sessions = allowed_skip / session_hours;
-
-		/* Store calculated values */
-		s->total_classes = total_classes;
-		s->allowed_skips = (session_hours > 1) ? allowed_skip_sessions : allowed_skip;
-		remaining = s->allowed_skips - s->current_skips;
+		if (session_hours != subject_session_hours)
+			session_hours = session_hours < 0 ? subject_session_hours : 0;
 
 		result_row = adw_action_row_new ();
-		g_snprintf (buf, sizeof buf, _("%s"), s->name);
-		adw_preferences_row_set_title (ADW_PREFERENCES_ROW (result_row), buf);
-		if (session_hours > 1)
-			g_snprintf (detail, sizeof detail, _("%d sessions allowed • %d total sessions"), allowed_skip_sessions, total_sessions);
+		adw_preferences_row_set_title (ADW_PREFERENCES_ROW (result_row), classlimit_subject_get_name (s));
+		/* A policy may count this subject in different units */
+		if (subject_session_hours > 1)
+			g_snprintf (detail, sizeof detail, _("%d sessions allowed • %d total sessions"),
+				classlimit_subject_get_allowed_skips (s), classlimit_subject_get_total_classes (s) / subject_session_hours);
 		else
-			g_snprintf (detail, sizeof detail, _("%d classes allowed • %d total classes"), allowed_skip, total_classes);
+			g_snprintf (detail, sizeof detail, _("%d classes allowed • %d total classes"),
+				classlimit_subject_get_allowed_skips (s), classlimit_subject_get_total_classes (s));
 		adw_action_row_set_subtitle (ADW_ACTION_ROW (result_row), detail);
-		GtkWidget *status_image = gtk_image_new_from_icon_name ("emblem-ok-symbolic");
+		status_image = gtk_image_new_from_icon_name ("emblem-ok-symbolic");
 		if (remaining < 0)
 			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "dialog-error-symbolic");
 		else if (remaining <= 2)
 			gtk_image_set_from_icon_name (GTK_IMAGE (status_image), "dialog-warning-symbolic");
 		adw_action_row_add_suffix (ADW_ACTION_ROW (result_row), status_image);
 		gtk_list_box_append (self->results_list, result_row);
-
-		/* Update subject row subtitle + status */
-		{
-			char subbuf[128];
-			GtkWidget *subject_status = g_object_get_data (G_OBJECT (row), "status-image");
-			if (s->allowed_skips > 0)
-				g_snprintf (subbuf, sizeof subbuf, _("%d h/week • Skipped: %d • Remaining: %d"), s->weekly_hours, s->current_skips, remaining);
-			else
-				g_snprintf (subbuf, sizeof subbuf, _("%d h/week"), s->weekly_hours);
-			adw_action_row_set_subtitle (ADW_ACTION_ROW (row), subbuf);
-			if (GTK_IS_WIDGET (subject_status)) {
-				if (remaining < 0)
-					gtk_image_set_from_icon_name (GTK_IMAGE (subject_status), "dialog-error-symbolic");
-				else if (remaining <= 2)
-					gtk_image_set_from_icon_name (GTK_IMAGE (subject_status), "dialog-warning-symbolic");
-				else
-					gtk_image_set_from_icon_name (GTK_IMAGE (subject_status), "emblem-ok-symbolic");
-			}
-		}
-
-		total_allowed_all += allowed_skip;
-		total_classes_all += total_classes;
 	}
-	if (total_classes_all > 0) {
+	if (totals->total_classes > 0) {
 		char summary[256];
 		GtkWidget *summary_row;
 		GtkWidget *summary_box;
 		GtkWidget *lbl_sum;
 		GtkWidget *lbl_sum_detail;
-		int total_sessions_all;
-		int allowed_sessions_all;
 		char detail[128];
 		
-		total_sessions_all = total_classes_all / session_hours;
-		allowed_sessions_all = total_allowed_all / session_hours;
-		
+		/* Policies with different session lengths only add up in hours */
 		if (session_hours > 1) {
-			g_snprintf (summary, sizeof summary, _("Total: %d sessions allowed to skip"), allowed_sessions_all);
+			g_snprintf (summary, sizeof summary, _("Total: %d sessions allowed to skip"), totals->allowed_sessions);
+			g_snprintf (detail, sizeof detail, _("Out of %d total sessions"), totals->total_sessions);
+		} else if (session_hours == 1) {
+			g_snprintf (summary, sizeof summary, _("Total: %d classes allowed to skip"), totals->allowed_skips);
+			g_snprintf (detail, sizeof detail, _("Out of %d total classes"), totals->total_classes);
 		} else {
-			g_snprintf (summary, sizeof summary, _("Total: %d classes allowed to skip"), total_allowed_all);
+			g_snprintf (summary, sizeof summary, _("Total: %d hours allowed to skip"), totals->allowed_skips);
+			g_snprintf (detail, sizeof detail, _("Out of %d total hours"), totals->total_classes);
 		}
 		
 		summary_row = gtk_list_box_row_new();
@@ -399,13 +556,6 @@ recalc_results (ClasslimitWindow *self)
 		gtk_label_set_xalign (GTK_LABEL (lbl_sum), 0.0);
 		gtk_widget_add_css_class (lbl_sum, "title-3");
 		
-		if (session_hours > 1) {
-			g_snprintf (detail, sizeof detail, _("Out of %d total sessions (%d%% attendance required)"), 
-				total_sessions_all, required_pct);
-		} else {
-			g_snprintf (detail, sizeof detail, _("Out of %d total classes (%d%% attendance required)"), 
-				total_classes_all, required_pct);
-		}
 		lbl_sum_detail = gtk_label_new (detail);
 		gtk_label_set_xalign (GTK_LABEL (lbl_sum_detail), 0.0);
 		gtk_widget_add_css_class (lbl_sum_detail, "caption");
@@ -415,12 +565,45 @@ recalc_results (ClasslimitWindow *self)
 		gtk_list_box_row_set_child (GTK_LIST_BOX_ROW (summary_row), summary_box);
 		gtk_list_box_prepend (self->results_list, summary_row);
 	}
-	/* Show results list on results page */
 	gtk_stack_set_visible_child (self->results_stack, GTK_WIDGET (self->results_list));
+}
+
+static void
+show_empty_results (ClasslimitWindow *self)
+{
+	clear_results (self);
+	gtk_stack_set_visible_child (self->results_stack, gtk_widget_get_first_child (GTK_WIDGET (self->results_stack)));
+}
+
+/* Any window may calculate, every window shows the results */
+static void
+on_roster_calculated (ClasslimitWindow *self)
+{
+	ClasslimitTotals totals;
+
+	if (classlimit_roster_get_totals (self->roster, &totals))
+		populate_results (self, &totals);
+}
+
+static void
+recalc_results (ClasslimitWindow *self)
+{
+	ClasslimitAction action = { .kind = CLASSLIMIT_ACTION_CALCULATE };
+	gint64 begin = classlimit_profiler_begin ();
+	
+	/* Add subtle animation when recalculating */
+	gtk_widget_set_sensitive (GTK_WIDGET (self->calculate_button), FALSE);
+	
+	perform_action (self, &action, NULL, NULL);
+
+	/* Show results list on results page */
 	adw_view_stack_set_visible_child (self->view_stack, self->results_page);
 	
 	/* Re-enable button after calculation */
 	gtk_widget_set_sensitive (GTK_WIDGET (self->calculate_button), TRUE);
+
+	classlimit_profiler_end (CLASSLIMIT_PROBE_CALCULATE, begin,
+		g_list_model_get_n_items (G_LIST_MODEL (self->roster)));
 }
 
 static void
@@ -430,106 +613,195 @@ on_calculate_clicked (GtkButton *btn, gpointer user_data)
 }
 
 static void
-save_subjects_to_settings (ClasslimitWindow *self)
+on_parameter_changed (GtkSpinButton *spin, gpointer user_data)
 {
-	GVariantBuilder builder;
-	GtkWidget *row;
-
-	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(siii)"));
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	ClasslimitAction action = { 0 };
 
-	for (row = gtk_widget_get_first_child (GTK_WIDGET (self->subjects_list));
-		 row != NULL;
-		 row = gtk_widget_get_next_sibling (row)) {
-		Subject *s = g_object_get_data (G_OBJECT (row), "subject");
-		if (!s) continue;
-		g_variant_builder_add (&builder, "(siii)", 
-			s->name, s->weekly_hours, s->current_skips, s->allowed_skips);
-	}
+	if (spin == self->percent_spin)
+		action.kind = CLASSLIMIT_ACTION_SET_ATTENDANCE;
+	else if (spin == self->weeks_spin)
+		action.kind = CLASSLIMIT_ACTION_SET_WEEKS;
+	else
+		action.kind = CLASSLIMIT_ACTION_SET_SESSION_HOURS;
+	action.value = gtk_spin_button_get_value_as_int (spin);
 
-	g_settings_set_value (self->settings, "subjects", g_variant_builder_end (&builder));
-	g_settings_set_int (self->settings, "required-attendance", 
-		gtk_spin_button_get_value_as_int (self->percent_spin));
-	g_settings_set_int (self->settings, "total-weeks", 
-		gtk_spin_button_get_value_as_int (self->weeks_spin));
-	g_settings_set_int (self->settings, "session-hours", 
-		gtk_spin_button_get_value_as_int (self->session_hours_spin));
+	/* Auto-save on changes */
+	perform_action (self, &action, NULL, NULL);
 }
 
+/* Pushes the roster parameters into the spin buttons without echoing
+ * them back as user actions.
+ */
 static void
-load_subjects_from_settings (ClasslimitWindow *self)
+sync_parameters_from_roster (ClasslimitWindow *self)
 {
-	GVariant *subjects_var = g_settings_get_value (self->settings, "subjects");
-	GVariantIter iter;
-	const gchar *name;
-	gint weekly_hours, current_skips, allowed_skips;
+	GtkSpinButton *spins[] = { self->percent_spin, self->weeks_spin, self->session_hours_spin };
+	guint i;
 
-	g_variant_iter_init (&iter, subjects_var);
-	while (g_variant_iter_next (&iter, "(siii)", &name, &weekly_hours, &current_skips, &allowed_skips)) {
-		Subject *s;
-		GtkWidget *row;
-		
-		s = g_new0 (Subject, 1);
-		s->name = g_strdup (name);
-		s->weekly_hours = weekly_hours;
-		s->current_skips = current_skips;
-		s->allowed_skips = allowed_skips;
-		row = create_subject_row (s, self);
-		gtk_list_box_append (self->subjects_list, row);
-		
-		/* Initialize subtitle with current skip state */
-		{
-			char subtitle[128];
-			if (s->allowed_skips > 0) {
-				int remaining = s->allowed_skips - s->current_skips;
-				g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d • Remaining: %d"), weekly_hours, current_skips, remaining);
-			} else {
-				g_snprintf (subtitle, sizeof subtitle, _("%d h/week • Skipped: %d"), weekly_hours, current_skips);
-			}
-			adw_action_row_set_subtitle (ADW_ACTION_ROW (row), subtitle);
-			GtkWidget *status = g_object_get_data (G_OBJECT (row), "status-image");
-			if (GTK_IS_WIDGET (status)) {
-				if (s->allowed_skips == 0)
-					gtk_image_set_from_icon_name (GTK_IMAGE (status), "view-statistics-symbolic");
-				else
-					gtk_image_set_from_icon_name (GTK_IMAGE (status), "emblem-ok-symbolic");
-			}
-		}
-	}
-	g_variant_unref (subjects_var);
+	for (i = 0; i < G_N_ELEMENTS (spins); i++)
+		g_signal_handlers_block_by_func (spins[i], on_parameter_changed, self);
 
 	gtk_spin_button_set_value (self->percent_spin, 
-		g_settings_get_int (self->settings, "required-attendance"));
+		classlimit_roster_get_required_attendance (self->roster));
 	gtk_spin_button_set_value (self->weeks_spin, 
-		g_settings_get_int (self->settings, "total-weeks"));
+		classlimit_roster_get_total_weeks (self->roster));
 	gtk_spin_button_set_value (self->session_hours_spin, 
-		g_settings_get_int (self->settings, "session-hours"));
+		classlimit_roster_get_session_hours (self->roster));
+
+	for (i = 0; i < G_N_ELEMENTS (spins); i++)
+		g_signal_handlers_unblock_by_func (spins[i], on_parameter_changed, self);
+}
+
+static char *
+describe_policy (const char *subjects,
+                 int         required_attendance,
+                 int         session_hours,
+                 int         total_weeks)
+{
+	GString *str = g_string_new (subjects);
+
+	if (required_attendance > 0)
+		g_string_append_printf (str, _(" • %d%% attendance"), required_attendance);
+	if (session_hours > 1)
+		g_string_append_printf (str, _(" • %d-hour sessions"), session_hours);
+	else if (session_hours == 1)
+		g_string_append (str, _(" • counted in hours"));
+	if (total_weeks > 0)
+		g_string_append_printf (str, _(" • %d weeks"), total_weeks);
+
+	return g_string_free (str, FALSE);
+}
+
+/* Rebuilds the policy rows, which only happens when the policies
+ * themselves change, not on every roster edit.
+ */
+static void
+sync_policies_from_roster (ClasslimitWindow *self)
+{
+	GVariant *policies = classlimit_roster_get_policies (self->roster);
+	GtkWidget *child;
+	GVariantIter iter;
+	const char *name, *subjects;
+	int required_attendance, session_hours, total_weeks;
+	guint index = 0;
+
+	if (self->shown_policies && g_variant_equal (self->shown_policies, policies))
+		return;
+
+	g_clear_pointer (&self->shown_policies, g_variant_unref);
+	self->shown_policies = g_variant_ref (policies);
+
+	while ((child = gtk_widget_get_first_child (GTK_WIDGET (self->policies_list))))
+		gtk_list_box_remove (self->policies_list, child);
+
+	g_variant_iter_init (&iter, policies);
+	while (g_variant_iter_next (&iter, "(&s&siii)", &name, &subjects,
+	                            &required_attendance, &session_hours, &total_weeks)) {
+		g_autofree char *subtitle = describe_policy (subjects, required_attendance, session_hours, total_weeks);
+		GtkWidget *row = adw_action_row_new ();
+		GtkWidget *remove = gtk_button_new_from_icon_name ("user-trash-symbolic");
+
+		adw_preferences_row_set_use_markup (ADW_PREFERENCES_ROW (row), FALSE);
+		adw_preferences_row_set_title (ADW_PREFERENCES_ROW (row), name);
+		adw_action_row_set_subtitle (ADW_ACTION_ROW (row), subtitle);
+
+		gtk_widget_set_valign (remove, GTK_ALIGN_CENTER);
+		gtk_widget_set_tooltip_text (remove, _("Remove Policy"));
+		gtk_widget_add_css_class (remove, "flat");
+		gtk_actionable_set_action_name (GTK_ACTIONABLE (remove), "win.remove-policy");
+		gtk_actionable_set_action_target (GTK_ACTIONABLE (remove), "u", index++);
+		adw_action_row_add_suffix (ADW_ACTION_ROW (row), remove);
+
+		gtk_list_box_append (self->policies_list, row);
+	}
+
+	gtk_widget_set_visible (GTK_WIDGET (self->policies_list), index > 0);
 }
 
 static void
-on_reset_all_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+set_policies (ClasslimitWindow *self,
+              GVariant         *policies)
+{
+	g_autoptr(GVariant) owned = g_variant_ref_sink (policies);
+	ClasslimitAction action = { .kind = CLASSLIMIT_ACTION_SET_POLICIES };
+
+	action.text = g_variant_print (owned, FALSE);
+	perform_action (self, &action, NULL, NULL);
+	classlimit_action_clear (&action);
+}
+
+static void
+on_add_policy_action (GSimpleAction *simple_action, GVariant *parameter, gpointer user_data)
 {
 	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
-	
-	/* Clear all subjects */
-	GtkWidget *child = gtk_widget_get_first_child (GTK_WIDGET (self->subjects_list));
-	while (child) {
-		GtkWidget *next = gtk_widget_get_next_sibling (child);
-		gtk_list_box_remove (self->subjects_list, child);
-		child = next;
+	g_autofree char *name = g_strstrip (g_strdup (gtk_editable_get_text (GTK_EDITABLE (self->policy_name_entry))));
+	g_autofree char *subjects = g_strstrip (g_strdup (gtk_editable_get_text (GTK_EDITABLE (self->policy_subjects_entry))));
+	GVariant *policies = classlimit_roster_get_policies (self->roster);
+	GVariantBuilder builder;
+	gsize i;
+
+	if (*subjects == '\0')
+		return;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssiii)"));
+	for (i = 0; i < g_variant_n_children (policies); i++) {
+		g_autoptr(GVariant) policy = g_variant_get_child_value (policies, i);
+
+		g_variant_builder_add_value (&builder, policy);
+	}
+	g_variant_builder_add (&builder, "(ssiii)", *name ? name : subjects, subjects,
+		(int) adw_spin_row_get_value (self->policy_attendance_spin),
+		(int) adw_spin_row_get_value (self->policy_session_hours_spin),
+		(int) adw_spin_row_get_value (self->policy_weeks_spin));
+	set_policies (self, g_variant_builder_end (&builder));
+
+	gtk_editable_set_text (GTK_EDITABLE (self->policy_name_entry), "");
+	gtk_editable_set_text (GTK_EDITABLE (self->policy_subjects_entry), "");
+}
+
+static void
+on_remove_policy_action (GSimpleAction *simple_action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	GVariant *policies = classlimit_roster_get_policies (self->roster);
+	guint index = g_variant_get_uint32 (parameter);
+	GVariantBuilder builder;
+	gsize i;
+
+	if (index >= g_variant_n_children (policies))
+		return;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssiii)"));
+	for (i = 0; i < g_variant_n_children (policies); i++) {
+		g_autoptr(GVariant) policy = g_variant_get_child_value (policies, i);
+
+		if (i != index)
+			g_variant_builder_add_value (&builder, policy);
 	}
+	set_policies (self, g_variant_builder_end (&builder));
+}
+
+static void
+on_roster_changed (ClasslimitWindow *self)
+{
+	sync_parameters_from_roster (self);
+	sync_policies_from_roster (self);
+	if (g_list_model_get_n_items (G_LIST_MODEL (self->roster)) == 0)
+		show_empty_results (self);
+}
+
+static void
+on_reset_all_action (GSimpleAction *simple_action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	ClasslimitAction action = { .kind = CLASSLIMIT_ACTION_RESET_ALL };
 	
-	/* Clear results */
-	clear_results (self);
-	gtk_stack_set_visible_child (self->results_stack, gtk_widget_get_first_child (GTK_WIDGET (self->results_stack)));
+	/* Clear all subjects, reset parameters to defaults and save; the
+	 * changed handler takes care of the spins and results.
+	 */
+	perform_action (self, &action, NULL, NULL);
 	adw_view_stack_set_visible_child_name (self->view_stack, "subjects");
-	
-	/* Reset spin buttons to defaults */
-	gtk_spin_button_set_value (self->percent_spin, 80);
-	gtk_spin_button_set_value (self->weeks_spin, 15);
-	gtk_spin_button_set_value (self->session_hours_spin, 1);
-	
-	/* Save empty state */
-	save_subjects_to_settings (self);
 }
 
 static void
@@ -551,11 +823,10 @@ on_export_save_callback (GObject *source, GAsyncResult *result, gpointer user_da
 	GtkFileDialog *dialog = GTK_FILE_DIALOG (source);
 	GError *error = NULL;
 	GFile *file = gtk_file_dialog_save_finish (dialog, result, &error);
-	JsonBuilder *builder;
-	JsonNode *root;
-	JsonGenerator *gen;
+	GBytes *bytes;
 	gchar *json_data;
-	GtkWidget *row;
+	gsize length;
+	gint64 begin;
 	
 	if (!file) {
 		if (error && !g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_DISMISSED))
@@ -564,52 +835,19 @@ on_export_save_callback (GObject *source, GAsyncResult *result, gpointer user_da
 		return;
 	}
 	
-	/* Build JSON */
-	builder = json_builder_new ();
-	json_builder_begin_object (builder);
-	json_builder_set_member_name (builder, "version");
-	json_builder_add_int_value (builder, 1);
-	json_builder_set_member_name (builder, "required_attendance");
-	json_builder_add_int_value (builder, gtk_spin_button_get_value_as_int (self->percent_spin));
-	json_builder_set_member_name (builder, "total_weeks");
-	json_builder_add_int_value (builder, gtk_spin_button_get_value_as_int (self->weeks_spin));
-	json_builder_set_member_name (builder, "session_hours");
-	json_builder_add_int_value (builder, gtk_spin_button_get_value_as_int (self->session_hours_spin));
-	json_builder_set_member_name (builder, "subjects");
-	json_builder_begin_array (builder);
+	begin = classlimit_profiler_begin ();
 	
-	for (row = gtk_widget_get_first_child (GTK_WIDGET (self->subjects_list));
-		 row != NULL; row = gtk_widget_get_next_sibling (row)) {
-		Subject *s = g_object_get_data (G_OBJECT (row), "subject");
-		if (!s) continue;
-		
-		json_builder_begin_object (builder);
-		json_builder_set_member_name (builder, "name");
-		json_builder_add_string_value (builder, s->name);
-		json_builder_set_member_name (builder, "weekly_hours");
-		json_builder_add_int_value (builder, s->weekly_hours);
-		json_builder_set_member_name (builder, "current_skips");
-		json_builder_add_int_value (builder, s->current_skips);
-		json_builder_end_object (builder);
-	}
-	
-	json_builder_end_array (builder);
-	json_builder_end_object (builder);
-	
-	root = json_builder_get_root (builder);
-	gen = json_generator_new ();
-	json_generator_set_root (gen, root);
-	json_generator_set_pretty (gen, TRUE);
-	json_data = json_generator_to_data (gen, NULL);
-	
-	g_file_replace_contents_async (file, json_data, strlen (json_data),
+	/* The bytes keep the JSON alive until the async write is done */
+	json_data = classlimit_roster_export_json (self->roster, &length);
+	bytes = g_bytes_new_take (json_data, length);
+	g_file_replace_contents_bytes_async (file, bytes,
 		NULL, FALSE, G_FILE_CREATE_NONE, NULL, on_export_finished, NULL);
 	
-	g_free (json_data);
-	json_node_free (root);
-	g_object_unref (gen);
-	g_object_unref (builder);
+	g_bytes_unref (bytes);
 	g_object_unref (file);
+
+	classlimit_profiler_end (CLASSLIMIT_PROBE_EXPORT, begin,
+		g_list_model_get_n_items (G_LIST_MODEL (self->roster)));
 }
 
 static void
@@ -632,14 +870,8 @@ on_import_open_callback (GObject *source, GAsyncResult *result, gpointer user_da
 	GtkFileDialog *dialog = GTK_FILE_DIALOG (source);
 	GError *error = NULL;
 	GFile *file = gtk_file_dialog_open_finish (dialog, result, &error);
-	gchar *contents = NULL;
-	gsize length;
-	JsonParser *parser;
-	JsonNode *root;
-	JsonObject *obj;
-	JsonArray *subjects;
-	guint i;
-	GtkWidget *child;
+	ClasslimitAction action = { .kind = CLASSLIMIT_ACTION_IMPORT };
+	gint64 begin;
 	
 	if (!file) {
 		if (error && !g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_DISMISSED))
@@ -648,64 +880,381 @@ on_import_open_callback (GObject *source, GAsyncResult *result, gpointer user_da
 		return;
 	}
 	
-	if (!g_file_load_contents (file, NULL, &contents, &length, NULL, &error)) {
-		g_warning ("Failed to read file: %s", error->message);
-		g_error_free (error);
-		g_object_unref (file);
+	begin = classlimit_profiler_begin ();
+	
+	/* Replace subjects and parameters with the file contents, then save */
+	action.text = g_file_peek_path (file) ? g_strdup (g_file_peek_path (file)) : g_file_get_uri (file);
+	perform_action (self, &action, NULL, NULL);
+	
+	classlimit_action_clear (&action);
+	g_object_unref (file);
+
+	classlimit_profiler_end (CLASSLIMIT_PROBE_IMPORT, begin,
+		g_list_model_get_n_items (G_LIST_MODEL (self->roster)));
+}
+
+static void
+on_import_progress (ClasslimitWindow *self)
+{
+	ClasslimitImporter *importer = self->importer;
+	guint n_files = classlimit_importer_get_n_files (importer);
+	guint n_done = classlimit_importer_get_n_done (importer);
+	g_autofree char *text = NULL;
+
+	/* The total is only known once the whole folder has been listed */
+	if (n_files == 0 && !classlimit_importer_is_enumerated (importer)) {
+		gtk_progress_bar_pulse (self->import_progress);
+		gtk_progress_bar_set_text (self->import_progress, _("Looking for files…"));
 		return;
 	}
-	
-	parser = json_parser_new ();
-	if (!json_parser_load_from_data (parser, contents, length, &error)) {
-		g_warning ("Failed to parse JSON: %s", error->message);
-		g_error_free (error);
-		g_free (contents);
-		g_object_unref (parser);
-		g_object_unref (file);
+
+	if (classlimit_importer_is_enumerated (importer))
+		text = g_strdup_printf (_("Imported %u of %u files"), n_done, n_files);
+	else
+		text = g_strdup_printf (_("Imported %u of %u files found so far"), n_done, n_files);
+
+	gtk_progress_bar_set_fraction (self->import_progress, n_files > 0 ? (double) n_done / n_files : 0.0);
+	gtk_progress_bar_set_text (self->import_progress, text);
+}
+
+static void
+show_import_errors (ClasslimitWindow *self,
+                    GPtrArray        *errors)
+{
+	g_autoptr(GString) body = g_string_new (NULL);
+	AdwDialog *dialog;
+	guint i;
+
+	/* Enough to find the broken files without an endless dialog */
+	for (i = 0; i < MIN (errors->len, 20); i++) {
+		if (i > 0)
+			g_string_append_c (body, '\n');
+		g_string_append (body, g_ptr_array_index (errors, i));
+	}
+	if (errors->len > 20) {
+		g_string_append_c (body, '\n');
+		g_string_append_printf (body, ngettext ("…and %u more file",
+		                                        "…and %u more files", errors->len - 20),
+		                        errors->len - 20);
+	}
+
+	dialog = adw_alert_dialog_new (_("Some Files Could Not Be Imported"), body->str);
+	adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "close", _("_Close"));
+	adw_dialog_present (dialog, GTK_WIDGET (self));
+}
+
+static void
+on_import_folder_finished (GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	g_autoptr(ClasslimitWindow) self = CLASSLIMIT_WINDOW (user_data);
+	ClasslimitImporter *importer = CLASSLIMIT_IMPORTER (source);
+	GPtrArray *errors = classlimit_importer_get_errors (importer);
+	g_autoptr(GError) error = NULL;
+
+	ClasslimitAction action = { .kind = CLASSLIMIT_ACTION_IMPORT_FOLDER };
+	gboolean completed;
+
+	completed = classlimit_importer_run_finish (importer, result, &error);
+	if (!completed && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_ptr_array_add (errors, g_strdup (error->message));
+
+	/* The window was closed in the meantime, nothing left to update */
+	if (self->importer != importer)
 		return;
+
+	/* Recorded only now, after the last merge, which is where the
+	 * replayer runs the whole import. One that stopped short is
+	 * recorded as the roster it left behind instead.
+	 */
+	if (self->recorder && completed) {
+		action.text = g_steal_pointer (&self->import_location);
+		classlimit_recorder_log (self->recorder, &action);
+	} else if (self->recorder) {
+		g_autoptr(GVariant) change = g_variant_ref_sink (g_variant_new ("(iiim@a(siii)m@a(ssiii))", -1, -1, -1,
+			classlimit_roster_get_records (self->roster), NULL));
+
+		action.kind = CLASSLIMIT_ACTION_MERGE;
+		action.text = g_variant_print (change, FALSE);
+		classlimit_recorder_log (self->recorder, &action);
 	}
-	
-	root = json_parser_get_root (parser);
-	obj = json_node_get_object (root);
-	
-	/* Clear existing subjects */
-	child = gtk_widget_get_first_child (GTK_WIDGET (self->subjects_list));
-	while (child) {
-		GtkWidget *next = gtk_widget_get_next_sibling (child);
-		gtk_list_box_remove (self->subjects_list, child);
-		child = next;
+	classlimit_action_clear (&action);
+
+	g_signal_handlers_disconnect_by_data (importer, self);
+	g_clear_object (&self->importer);
+	g_clear_object (&self->import_cancellable);
+	g_clear_pointer (&self->import_location, g_free);
+	g_simple_action_set_enabled (G_SIMPLE_ACTION (g_action_map_lookup_action (G_ACTION_MAP (self), "import-folder")), TRUE);
+	gtk_revealer_set_reveal_child (self->import_revealer, FALSE);
+
+	if (errors->len > 0)
+		show_import_errors (self, errors);
+
+	if (adw_view_stack_get_visible_child (self->view_stack) == self->results_page)
+		recalc_results (self);
+}
+
+static void
+on_import_folder_callback (GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	GtkFileDialog *dialog = GTK_FILE_DIALOG (source);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) folder = gtk_file_dialog_select_folder_finish (dialog, result, &error);
+
+	if (!folder) {
+		if (error && !g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_DISMISSED))
+			g_warning ("Folder import cancelled or failed: %s", error->message);
+		return;
 	}
-	
-	/* Load settings */
-	if (json_object_has_member (obj, "required_attendance"))
-		gtk_spin_button_set_value (self->percent_spin, json_object_get_int_member (obj, "required_attendance"));
-	if (json_object_has_member (obj, "total_weeks"))
-		gtk_spin_button_set_value (self->weeks_spin, json_object_get_int_member (obj, "total_weeks"));
-	if (json_object_has_member (obj, "session_hours"))
-		gtk_spin_button_set_value (self->session_hours_spin, json_object_get_int_member (obj, "session_hours"));
-	
-	/* Load subjects */
-	subjects = json_object_get_array_member (obj, "subjects");
-	for (i = 0; i < json_array_get_length (subjects); i++) {
-		JsonObject *subj_obj = json_array_get_object_element (subjects, i);
-		Subject *s = g_new0 (Subject, 1);
-		GtkWidget *row;
-		s->name = g_strdup (json_object_get_string_member (subj_obj, "name"));
-		s->weekly_hours = json_object_get_int_member (subj_obj, "weekly_hours");
-		s->current_skips = json_object_has_member (subj_obj, "current_skips") ? 
-			json_object_get_int_member (subj_obj, "current_skips") : 0;
-		s->allowed_skips = 0;
-		s->total_classes = 0;
-		
-		row = create_subject_row (s, self);
-		gtk_list_box_append (self->subjects_list, row);
+
+	if (self->importer)
+		return;
+
+	/* Merged asynchronously here and recorded once done, see
+	 * on_import_folder_finished(); classlimit_action_apply() runs the
+	 * same import to completion.
+	 */
+	self->import_location = g_file_peek_path (folder) ? g_strdup (g_file_peek_path (folder)) : g_file_get_uri (folder);
+	if (self->frame_monitor)
+		classlimit_frame_monitor_mark_action (self->frame_monitor,
+			classlimit_action_kind_to_string (CLASSLIMIT_ACTION_IMPORT_FOLDER));
+
+	/* One folder at a time */
+	g_simple_action_set_enabled (G_SIMPLE_ACTION (g_action_map_lookup_action (G_ACTION_MAP (self), "import-folder")), FALSE);
+	self->importer = classlimit_importer_new (self->roster, folder);
+	self->import_cancellable = g_cancellable_new ();
+	g_signal_connect_swapped (self->importer, "progress",
+		G_CALLBACK (on_import_progress), self);
+
+	gtk_progress_bar_set_fraction (self->import_progress, 0.0);
+	on_import_progress (self);
+	gtk_revealer_set_reveal_child (self->import_revealer, TRUE);
+
+	classlimit_importer_run_async (self->importer, self->import_cancellable,
+		on_import_folder_finished, g_object_ref (self));
+}
+
+static void
+on_import_folder_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	g_autoptr(GtkFileDialog) dialog = gtk_file_dialog_new ();
+
+	gtk_file_dialog_set_title (dialog, _("Import Folder"));
+	gtk_file_dialog_select_folder (dialog, GTK_WINDOW (self), NULL,
+		on_import_folder_callback, self);
+}
+
+static void
+on_cancel_import_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+
+	if (self->import_cancellable)
+		g_cancellable_cancel (self->import_cancellable);
+}
+
+/* Anything import or export can't use falls back to a comma */
+static char
+get_csv_delimiter (ClasslimitWindow *self)
+{
+	g_autofree char *delimiter = g_settings_get_string (self->settings, "csv-delimiter");
+
+	if (g_str_equal (delimiter, "\\t") || g_ascii_strcasecmp (delimiter, "tab") == 0)
+		return '\t';
+
+	return classlimit_csv_delimiter_is_valid (delimiter[0]) ? delimiter[0] : ',';
+}
+
+typedef struct {
+	GFile               *file;
+	ClasslimitCsvColumns columns;
+	ClasslimitAction     action;
+	gint64               begin;
+} CsvImport;
+
+static void
+csv_import_free (CsvImport *import)
+{
+	g_clear_object (&import->file);
+	classlimit_csv_columns_clear (&import->columns);
+	classlimit_action_clear (&import->action);
+	g_free (import);
+}
+
+static void
+show_error (ClasslimitWindow *self,
+            const char       *heading,
+            const char       *message)
+{
+	AdwDialog *dialog = adw_alert_dialog_new (heading, message);
+
+	adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "close", _("_Close"));
+	adw_dialog_present (dialog, GTK_WIDGET (self));
+}
+
+/* Worker thread; the file is mapped, not read, when it is local */
+static void
+load_csv_thread (GTask        *task,
+                 gpointer      source_object,
+                 gpointer      task_data,
+                 GCancellable *cancellable)
+{
+	CsvImport *import = task_data;
+	GError *error = NULL;
+	GPtrArray *subjects = classlimit_csv_load (import->file, &import->columns, cancellable, &error);
+
+	if (subjects)
+		g_task_return_pointer (task, subjects, (GDestroyNotify) g_ptr_array_unref);
+	else
+		g_task_return_error (task, error);
+}
+
+/* Back on the main thread: the parsed subjects go in as one transaction,
+ * and the action is only recorded now, where it lands among the others,
+ * so a replay sees it in the same order.
+ */
+static void
+on_csv_loaded (GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (source);
+	CsvImport *import = g_task_get_task_data (G_TASK (result));
+	g_autoptr(GPtrArray) subjects = NULL;
+	g_autoptr(GError) error = NULL;
+
+	subjects = g_task_propagate_pointer (G_TASK (result), &error);
+
+	/* Closed while the file was being read */
+	if (self->roster == NULL)
+		return;
+
+	if (subjects == NULL) {
+		show_error (self, _("Could Not Import CSV"), error->message);
+		return;
 	}
-	
-	save_subjects_to_settings (self);
-	
-	g_free (contents);
-	g_object_unref (parser);
-	g_object_unref (file);
+
+	record_action (self, &import->action);
+	classlimit_roster_begin (self->roster);
+	classlimit_roster_set_subjects (self->roster, (ClasslimitSubject **) subjects->pdata, subjects->len);
+	classlimit_roster_commit (self->roster);
+
+	classlimit_profiler_end (CLASSLIMIT_PROBE_IMPORT, import->begin, subjects->len);
+}
+
+static void
+on_import_csv_open_callback (GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = gtk_file_dialog_open_finish (GTK_FILE_DIALOG (source), result, &error);
+	g_autoptr(GTask) task = NULL;
+	g_autofree char *location = NULL;
+	g_autoptr(GVariant) spec = NULL;
+	CsvImport *import;
+
+	if (!file) {
+		if (error && !g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_DISMISSED))
+			g_warning ("CSV import cancelled or failed: %s", error->message);
+		return;
+	}
+
+	import = g_new0 (CsvImport, 1);
+	import->begin = classlimit_profiler_begin ();
+	import->file = g_object_ref (file);
+	import->columns.name = g_settings_get_string (self->settings, "csv-name-column");
+	import->columns.weekly_hours = g_settings_get_string (self->settings, "csv-hours-column");
+	import->columns.current_skips = g_settings_get_string (self->settings, "csv-skips-column");
+	import->columns.delimiter = get_csv_delimiter (self);
+
+	/* The column mapping goes into the action, so a replay reads the
+	 * file the same way whatever the settings are by then.
+	 */
+	location = g_file_peek_path (file) ? g_strdup (g_file_peek_path (file)) : g_file_get_uri (file);
+	spec = g_variant_ref_sink (g_variant_new ("(ssss)", location, import->columns.name,
+	                                          import->columns.weekly_hours, import->columns.current_skips));
+	import->action.kind = CLASSLIMIT_ACTION_IMPORT_CSV;
+	import->action.text = g_variant_print (spec, FALSE);
+	import->action.value = import->columns.delimiter;
+
+	/* Parsed off the main thread, so even huge exports never freeze the window */
+	task = g_task_new (self, NULL, on_csv_loaded, NULL);
+	g_task_set_source_tag (task, on_import_csv_open_callback);
+	g_task_set_task_data (task, import, (GDestroyNotify) csv_import_free);
+	g_task_run_in_thread (task, load_csv_thread);
+}
+
+static GListModel *
+csv_filters (void)
+{
+	GListStore *filters = g_list_store_new (GTK_TYPE_FILE_FILTER);
+	g_autoptr(GtkFileFilter) csv = gtk_file_filter_new ();
+	g_autoptr(GtkFileFilter) all = gtk_file_filter_new ();
+
+	gtk_file_filter_set_name (csv, _("CSV Files"));
+	gtk_file_filter_add_mime_type (csv, "text/csv");
+	gtk_file_filter_add_suffix (csv, "csv");
+	gtk_file_filter_add_suffix (csv, "tsv");
+	gtk_file_filter_set_name (all, _("All Files"));
+	gtk_file_filter_add_pattern (all, "*");
+	g_list_store_append (filters, csv);
+	g_list_store_append (filters, all);
+
+	return G_LIST_MODEL (filters);
+}
+
+static void
+on_import_csv_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	g_autoptr(GtkFileDialog) dialog = gtk_file_dialog_new ();
+	g_autoptr(GListModel) filters = csv_filters ();
+
+	gtk_file_dialog_set_title (dialog, _("Import CSV"));
+	gtk_file_dialog_set_filters (dialog, filters);
+	gtk_file_dialog_open (dialog, GTK_WINDOW (self), NULL,
+		on_import_csv_open_callback, self);
+}
+
+static void
+on_export_csv_save_callback (GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = gtk_file_dialog_save_finish (GTK_FILE_DIALOG (source), result, &error);
+	g_autoptr(GBytes) bytes = NULL;
+	char *csv_data;
+	gsize length;
+	gint64 begin;
+
+	if (!file) {
+		if (error && !g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_DISMISSED))
+			g_warning ("CSV export cancelled or failed: %s", error->message);
+		return;
+	}
+
+	begin = classlimit_profiler_begin ();
+
+	csv_data = classlimit_csv_export (self->roster, get_csv_delimiter (self), &length);
+	bytes = g_bytes_new_take (csv_data, length);
+	g_file_replace_contents_bytes_async (file, bytes,
+		NULL, FALSE, G_FILE_CREATE_NONE, NULL, on_export_finished, NULL);
+
+	classlimit_profiler_end (CLASSLIMIT_PROBE_EXPORT, begin,
+		g_list_model_get_n_items (G_LIST_MODEL (self->roster)));
+}
+
+static void
+on_export_csv_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	g_autoptr(GtkFileDialog) dialog = gtk_file_dialog_new ();
+	g_autoptr(GListModel) filters = csv_filters ();
+
+	gtk_file_dialog_set_title (dialog, _("Export CSV"));
+	gtk_file_dialog_set_filters (dialog, filters);
+	gtk_file_dialog_set_initial_name (dialog, "classlimit-subjects.csv");
+	gtk_file_dialog_save (dialog, GTK_WINDOW (self), NULL,
+		on_export_csv_save_callback, self);
 }
 
 static void
@@ -721,23 +1270,508 @@ on_import_action (GSimpleAction *action, GVariant *parameter, gpointer user_data
 }
 
 static void
-classlimit_window_class_init (ClasslimitWindowClass *klass)
+on_paste_text_ready (GObject *source, GAsyncResult *result, gpointer user_data)
 {
-	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+	g_autoptr(ClasslimitWindow) self = user_data;
+	ClasslimitAction action = { .kind = CLASSLIMIT_ACTION_PASTE };
+	g_autoptr(GError) error = NULL;
 
-	gtk_widget_class_set_template_from_resource (widget_class, "/com/tomasps/classlimit/classlimit-window.ui");
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, view_stack);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, subjects_list);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, subject_name_entry);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, subject_hours_spin);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, add_subject_button);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, percent_spin);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, weeks_spin);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, session_hours_spin);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, calculate_button);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, results_stack);
-	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, results_list);
-    gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, results_page);
+	action.text = gdk_clipboard_read_text_finish (GDK_CLIPBOARD (source), result, &error);
+
+	/* Closed while the clipboard owner was answering */
+	if (self->roster == NULL) {
+		classlimit_action_clear (&action);
+		return;
+	}
+
+	if (action.text == NULL || !perform_action (self, &action, NULL, NULL)) {
+		show_error (self, _("Nothing to Paste"),
+			_("Copy lines with a subject name and its weekly hours, separated by a tab, semicolon or comma."));
+		classlimit_action_clear (&action);
+		return;
+	}
+	classlimit_action_clear (&action);
+
+	/* Added in one go, so the results are brought up to date once */
+	if (adw_view_stack_get_visible_child (self->view_stack) == self->results_page)
+		recalc_results (self);
+}
+
+static void
+on_paste_subjects_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	GdkClipboard *clipboard = gtk_widget_get_clipboard (GTK_WIDGET (self));
+
+	gdk_clipboard_read_text_async (clipboard, NULL, on_paste_text_ready, g_object_ref (self));
+}
+
+static void
+on_link_open_callback (GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autofree char *uri = NULL;
+
+	file = gtk_file_dialog_open_finish (GTK_FILE_DIALOG (source), result, &error);
+	if (file == NULL) {
+		if (!g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_DISMISSED))
+			g_warning ("Failed to choose a file to link: %s", error->message);
+		return;
+	}
+
+	/* The application follows the setting and starts watching the file */
+	uri = g_file_get_uri (file);
+	g_settings_set_string (self->settings, "linked-file", uri);
+}
+
+static void
+on_link_file_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	g_autoptr(GtkFileDialog) dialog = gtk_file_dialog_new ();
+
+	gtk_file_dialog_set_title (dialog, _("Link to File"));
+	gtk_file_dialog_open (dialog, GTK_WINDOW (self), NULL,
+		on_link_open_callback, self);
+}
+
+static void
+on_unlink_file_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+
+	g_settings_set_string (self->settings, "linked-file", "");
+}
+
+static void
+on_linked_file_changed (ClasslimitWindow *self)
+{
+	g_autofree char *uri = g_settings_get_string (self->settings, "linked-file");
+
+	g_simple_action_set_enabled (G_SIMPLE_ACTION (g_action_map_lookup_action (G_ACTION_MAP (self), "unlink-file")),
+		*uri != '\0');
+}
+
+/* Latest semesters the averages in Past Semesters are taken over */
+#define RECENT_SEMESTERS 8
+
+typedef struct {
+	ClasslimitWindow *self;
+	gboolean          start_over;
+} ArchiveRequest;
+
+static void
+on_semester_archived (GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	ArchiveRequest *request = user_data;
+	g_autoptr(ClasslimitWindow) self = request->self;
+	gboolean start_over = request->start_over;
+	g_autoptr(GError) error = NULL;
+
+	g_free (request);
+
+	if (!classlimit_archive_append_finish (CLASSLIMIT_ARCHIVE (source), result, &error)) {
+		if (self->roster != NULL)
+			show_error (self, _("Could Not Archive Semester"), error->message);
+		else
+			g_warning ("Failed to archive semester: %s", error->message);
+		return;
+	}
+
+	/* Only once the semester is safely on disk */
+	if (start_over && self->roster != NULL) {
+		ClasslimitAction action = { .kind = CLASSLIMIT_ACTION_RESET_ALL };
+
+		perform_action (self, &action, NULL, NULL);
+		adw_view_stack_set_visible_child_name (self->view_stack, "subjects");
+	}
+}
+
+static void
+on_archive_response (AdwAlertDialog *dialog, const char *response, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	GtkEditable *entry = GTK_EDITABLE (adw_alert_dialog_get_extra_child (dialog));
+	GtkApplication *app = gtk_window_get_application (GTK_WINDOW (self));
+	ArchiveRequest *request;
+
+	if (g_str_equal (response, "cancel"))
+		return;
+
+	request = g_new0 (ArchiveRequest, 1);
+	request->self = g_object_ref (self);
+	request->start_over = g_str_equal (response, "start-over");
+	classlimit_archive_append_async (classlimit_application_get_archive (CLASSLIMIT_APPLICATION (app)),
+		gtk_editable_get_text (entry), self->roster, self->history, NULL, on_semester_archived, request);
+}
+
+static void
+on_archive_name_changed (GtkEditable *entry, AdwAlertDialog *dialog)
+{
+	gboolean has_name = *gtk_editable_get_text (entry) != '\0';
+
+	adw_alert_dialog_set_response_enabled (dialog, "archive", has_name);
+	adw_alert_dialog_set_response_enabled (dialog, "start-over", has_name);
+}
+
+static void
+on_archive_semester_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	g_autoptr(GDateTime) now = g_date_time_new_now_local ();
+	g_autofree char *name = g_date_time_format (now, "%B %Y");
+	AdwDialog *dialog;
+	GtkWidget *entry;
+
+	dialog = adw_alert_dialog_new (_("Archive Semester?"),
+		_("The subjects, settings and skip history are kept in the archive, where they can be compared with later semesters."));
+	adw_alert_dialog_add_responses (ADW_ALERT_DIALOG (dialog),
+	                                "cancel", _("_Cancel"),
+	                                "start-over", _("Archive and _Start Over"),
+	                                "archive", _("_Archive"),
+	                                NULL);
+	adw_alert_dialog_set_response_appearance (ADW_ALERT_DIALOG (dialog), "start-over", ADW_RESPONSE_DESTRUCTIVE);
+	adw_alert_dialog_set_response_appearance (ADW_ALERT_DIALOG (dialog), "archive", ADW_RESPONSE_SUGGESTED);
+	adw_alert_dialog_set_default_response (ADW_ALERT_DIALOG (dialog), "archive");
+	adw_alert_dialog_set_close_response (ADW_ALERT_DIALOG (dialog), "cancel");
+
+	entry = gtk_entry_new ();
+	gtk_editable_set_text (GTK_EDITABLE (entry), name);
+	gtk_entry_set_activates_default (GTK_ENTRY (entry), TRUE);
+	adw_alert_dialog_set_extra_child (ADW_ALERT_DIALOG (dialog), entry);
+	g_signal_connect (entry, "changed", G_CALLBACK (on_archive_name_changed), dialog);
+
+	g_signal_connect (dialog, "response", G_CALLBACK (on_archive_response), self);
+	adw_dialog_present (dialog, GTK_WIDGET (self));
+}
+
+/* Fills in a semester the first time it is expanded, so only the
+ * semesters looked at are ever inflated.
+ */
+static void
+on_semester_expanded (AdwExpanderRow *expander, GParamSpec *pspec, ClasslimitArchive *archive)
+{
+	guint semester = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (expander), "semester"));
+	g_autoptr(GHashTable) n_changes = NULL;
+	g_autoptr(GVariant) subjects = NULL;
+	g_autoptr(GVariant) history = NULL;
+	g_autoptr(GVariant) data = NULL;
+	g_autoptr(GError) error = NULL;
+	GVariantIter iter;
+	const char *name;
+	GVariant *samples;
+	int weekly_hours, current_skips, allowed_skips;
+
+	if (!adw_expander_row_get_expanded (expander) || g_object_get_data (G_OBJECT (expander), "filled"))
+		return;
+	g_object_set_data (G_OBJECT (expander), "filled", GINT_TO_POINTER (TRUE));
+
+	n_changes = g_hash_table_new (g_str_hash, g_str_equal);
+	data = classlimit_archive_read (archive, semester, &error);
+	if (data == NULL) {
+		GtkWidget *row = adw_action_row_new ();
+
+		adw_preferences_row_set_use_markup (ADW_PREFERENCES_ROW (row), FALSE);
+		adw_preferences_row_set_title (ADW_PREFERENCES_ROW (row), error->message);
+		adw_expander_row_add_row (expander, row);
+		return;
+	}
+
+	/* Series are keyed by subject name, the total has none */
+	history = g_variant_get_child_value (data, 2);
+	g_variant_iter_init (&iter, history);
+	while (g_variant_iter_loop (&iter, "(&s@a(xii))", &name, &samples))
+		g_hash_table_insert (n_changes, (gpointer) name, GSIZE_TO_POINTER (g_variant_n_children (samples)));
+
+	subjects = g_variant_get_child_value (data, 0);
+	g_variant_iter_init (&iter, subjects);
+	while (g_variant_iter_next (&iter, "(&siii)", &name, &weekly_hours, &current_skips, &allowed_skips)) {
+		GtkWidget *row = adw_action_row_new ();
+		guint changes = GPOINTER_TO_SIZE (g_hash_table_lookup (n_changes, name));
+		g_autofree char *subtitle = NULL;
+
+		subtitle = g_strdup_printf (ngettext ("%d of %d skips used, %u change recorded",
+		                                      "%d of %d skips used, %u changes recorded", changes),
+		                            current_skips, allowed_skips, changes);
+		adw_preferences_row_set_use_markup (ADW_PREFERENCES_ROW (row), FALSE);
+		adw_preferences_row_set_title (ADW_PREFERENCES_ROW (row), name);
+		adw_action_row_set_subtitle (ADW_ACTION_ROW (row), subtitle);
+		adw_expander_row_add_row (expander, row);
+	}
+}
+
+static GtkWidget *
+build_averages_group (ClasslimitArchive *archive)
+{
+	guint n_semesters = MIN (classlimit_archive_get_n_semesters (archive), RECENT_SEMESTERS);
+	g_autoptr(GArray) summaries = classlimit_archive_summarize (archive, RECENT_SEMESTERS);
+	g_autofree char *description = NULL;
+	GtkWidget *group = adw_preferences_group_new ();
+	guint i;
+
+	description = g_strdup_printf (ngettext ("Skips per subject in the last semester",
+	                                         "Skips per subject over the last %u semesters", n_semesters),
+	                               n_semesters);
+	adw_preferences_group_set_title (ADW_PREFERENCES_GROUP (group), _("Averages"));
+	adw_preferences_group_set_description (ADW_PREFERENCES_GROUP (group), description);
+
+	for (i = 0; i < summaries->len; i++) {
+		const ClasslimitArchiveSummary *summary = &g_array_index (summaries, ClasslimitArchiveSummary, i);
+		GtkWidget *row = adw_action_row_new ();
+		g_autofree char *subtitle = NULL;
+
+		subtitle = g_strdup_printf (ngettext ("%.1f skips on average, at most %d, taken once",
+		                                      "%.1f skips on average, at most %d, taken %u times",
+		                                      summary->n_semesters),
+		                            summary->average_skips, summary->max_skips, summary->n_semesters);
+		adw_preferences_row_set_use_markup (ADW_PREFERENCES_ROW (row), FALSE);
+		adw_preferences_row_set_title (ADW_PREFERENCES_ROW (row), summary->name);
+		adw_action_row_set_subtitle (ADW_ACTION_ROW (row), subtitle);
+		adw_preferences_group_add (ADW_PREFERENCES_GROUP (group), row);
+	}
+
+	return group;
+}
+
+static GtkWidget *
+build_semesters_group (ClasslimitArchive *archive)
+{
+	GtkWidget *group = adw_preferences_group_new ();
+	guint i = classlimit_archive_get_n_semesters (archive);
+
+	adw_preferences_group_set_title (ADW_PREFERENCES_GROUP (group), _("Semesters"));
+
+	/* Latest first; only the index is read until one is expanded */
+	while (i-- > 0) {
+		g_autoptr(GDateTime) time = g_date_time_new_from_unix_local (classlimit_archive_get_time (archive, i) / G_USEC_PER_SEC);
+		guint n_subjects = classlimit_archive_get_n_subjects (archive, i);
+		g_autofree char *date = g_date_time_format (time, "%x");
+		g_autofree char *subtitle = NULL;
+		GtkWidget *row = adw_expander_row_new ();
+
+		subtitle = g_strdup_printf (ngettext ("Archived %s, %u subject", "Archived %s, %u subjects", n_subjects),
+		                            date, n_subjects);
+		adw_preferences_row_set_use_markup (ADW_PREFERENCES_ROW (row), FALSE);
+		adw_preferences_row_set_title (ADW_PREFERENCES_ROW (row), classlimit_archive_get_name (archive, i));
+		adw_expander_row_set_subtitle (ADW_EXPANDER_ROW (row), subtitle);
+		g_object_set_data (G_OBJECT (row), "semester", GUINT_TO_POINTER (i));
+		g_signal_connect_object (row, "notify::expanded", G_CALLBACK (on_semester_expanded), archive, 0);
+		adw_preferences_group_add (ADW_PREFERENCES_GROUP (group), row);
+	}
+
+	return group;
+}
+
+static void
+on_past_semesters_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	GtkApplication *app = gtk_window_get_application (GTK_WINDOW (self));
+	ClasslimitArchive *archive = classlimit_application_get_archive (CLASSLIMIT_APPLICATION (app));
+	AdwDialog *dialog = adw_dialog_new ();
+	GtkWidget *view = adw_toolbar_view_new ();
+	GtkWidget *content;
+
+	if (classlimit_archive_get_n_semesters (archive) == 0) {
+		content = adw_status_page_new ();
+		adw_status_page_set_icon_name (ADW_STATUS_PAGE (content), "document-open-recent-symbolic");
+		adw_status_page_set_title (ADW_STATUS_PAGE (content), _("No Past Semesters"));
+		adw_status_page_set_description (ADW_STATUS_PAGE (content),
+			_("Archive a semester from the main menu to compare it with the next ones"));
+	} else {
+		content = adw_preferences_page_new ();
+		adw_preferences_page_add (ADW_PREFERENCES_PAGE (content),
+			ADW_PREFERENCES_GROUP (build_averages_group (archive)));
+		adw_preferences_page_add (ADW_PREFERENCES_PAGE (content),
+			ADW_PREFERENCES_GROUP (build_semesters_group (archive)));
+	}
+
+	adw_toolbar_view_add_top_bar (ADW_TOOLBAR_VIEW (view), adw_header_bar_new ());
+	adw_toolbar_view_set_content (ADW_TOOLBAR_VIEW (view), content);
+	adw_dialog_set_title (dialog, _("Past Semesters"));
+	adw_dialog_set_content_width (dialog, 480);
+	adw_dialog_set_content_height (dialog, 600);
+	adw_dialog_set_child (dialog, view);
+	adw_dialog_present (dialog, GTK_WIDGET (self));
+}
+
+static void
+refresh_debug_page (ClasslimitWindow *self)
+{
+	guint i;
+
+	for (i = 0; i < CLASSLIMIT_N_PROBES; i++) {
+		ClasslimitProbeStats stats;
+		char subtitle[256];
+
+		classlimit_profiler_get_stats (i, &stats);
+		g_snprintf (subtitle, sizeof subtitle,
+			"%" G_GUINT64_FORMAT " calls • %.2f ms total • p99 %.2f ms • %" G_GUINT64_FORMAT " rows",
+			stats.calls, stats.total_usec / 1000.0, stats.p99_usec / 1000.0, stats.rows);
+		adw_action_row_set_subtitle (ADW_ACTION_ROW (self->debug_rows[i]), subtitle);
+	}
+
+	if (self->frame_monitor) {
+		guint n_frames, n_long, n_dropped;
+		char subtitle[128];
+
+		classlimit_frame_monitor_get_summary (self->frame_monitor, &n_frames, &n_long, &n_dropped);
+		g_snprintf (subtitle, sizeof subtitle, "%u frames • %u long • %u dropped",
+			n_frames, n_long, n_dropped);
+		adw_action_row_set_subtitle (ADW_ACTION_ROW (self->debug_frames_row), subtitle);
+	}
+}
+
+static gboolean
+refresh_debug_page_cb (gpointer user_data)
+{
+	refresh_debug_page (CLASSLIMIT_WINDOW (user_data));
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+on_visible_child_changed (ClasslimitWindow *self)
+{
+	gboolean showing_debug = g_strcmp0 (adw_view_stack_get_visible_child_name (self->view_stack), "debug") == 0;
+
+	/* Only poll the counters while somebody is looking at them */
+	if (showing_debug && self->debug_refresh_id == 0) {
+		refresh_debug_page (self);
+		self->debug_refresh_id = g_timeout_add_seconds (1, refresh_debug_page_cb, self);
+	} else if (!showing_debug) {
+		g_clear_handle_id (&self->debug_refresh_id, g_source_remove);
+	}
+}
+
+static void
+on_debug_reset_clicked (GtkButton *btn, gpointer user_data)
+{
+	classlimit_profiler_reset ();
+	refresh_debug_page (CLASSLIMIT_WINDOW (user_data));
+}
+
+static void
+on_toggle_debug_action (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (user_data);
+	GVariant *state = g_action_get_state (G_ACTION (action));
+	gboolean visible = !g_variant_get_boolean (state);
+
+	g_variant_unref (state);
+	g_simple_action_set_state (action, g_variant_new_boolean (visible));
+	adw_view_stack_page_set_visible (self->debug_stack_page, visible);
+	if (visible)
+		adw_view_stack_set_visible_child_name (self->view_stack, "debug");
+}
+
+static void
+feed_history (ClasslimitWindow *self)
+{
+	const ClasslimitHistorySample *samples;
+	guint n_samples;
+	guint i;
+
+	samples = classlimit_history_get_samples (self->history, self->history_series, &n_samples);
+	for (i = self->history_fed; i < n_samples; i++) {
+		classlimit_chart_append (self->history_chart, CLASSLIMIT_CHART_LINE_SKIPS,
+		                         samples[i].time, samples[i].skips);
+		classlimit_chart_append (self->history_chart, CLASSLIMIT_CHART_LINE_REMAINING,
+		                         samples[i].time, samples[i].remaining);
+	}
+	self->history_fed = n_samples;
+}
+
+static void
+on_history_series_selected (ClasslimitWindow *self)
+{
+	guint selected = gtk_drop_down_get_selected (self->history_series_dropdown);
+
+	if (selected == GTK_INVALID_LIST_POSITION)
+		return;
+
+	self->history_series = selected;
+	self->history_fed = 0;
+	classlimit_chart_clear (self->history_chart);
+	feed_history (self);
+}
+
+static void
+on_history_appended (ClasslimitWindow  *self,
+                     guint              series,
+                     ClasslimitHistory *history)
+{
+	guint n_series = classlimit_history_get_n_series (history);
+	guint i;
+
+	/* Subjects seen for the first time get their own entry */
+	for (i = g_list_model_get_n_items (G_LIST_MODEL (self->history_series_names)); i < n_series; i++)
+		gtk_string_list_append (self->history_series_names, classlimit_history_get_series_name (history, i));
+
+	/* Only the new samples, the chart's pyramid grows in place */
+	if (series == self->history_series)
+		feed_history (self);
+}
+
+static void
+setup_history (ClasslimitWindow *self)
+{
+	guint n_series = classlimit_history_get_n_series (self->history);
+	guint i;
+
+	self->history_series_names = gtk_string_list_new (NULL);
+	gtk_string_list_append (self->history_series_names, _("All Subjects"));
+	for (i = CLASSLIMIT_HISTORY_AGGREGATE + 1; i < n_series; i++)
+		gtk_string_list_append (self->history_series_names, classlimit_history_get_series_name (self->history, i));
+
+	gtk_drop_down_set_model (self->history_series_dropdown, G_LIST_MODEL (self->history_series_names));
+	g_signal_connect_swapped (self->history_series_dropdown, "notify::selected",
+		G_CALLBACK (on_history_series_selected), self);
+	on_history_series_selected (self);
+
+	g_signal_connect_object (self->history, "appended",
+		G_CALLBACK (on_history_appended), self, G_CONNECT_SWAPPED);
+}
+
+static void
+classlimit_window_dispose (GObject *object)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (object);
+
+	g_signal_handlers_disconnect_by_func (self->view_stack, on_visible_child_changed, self);
+	g_clear_handle_id (&self->debug_refresh_id, g_source_remove);
+	if (self->importer) {
+		g_cancellable_cancel (self->import_cancellable);
+		g_signal_handlers_disconnect_by_data (self->importer, self);
+		g_clear_object (&self->importer);
+		g_clear_object (&self->import_cancellable);
+	}
+	g_clear_pointer (&self->import_location, g_free);
+	if (self->selection) {
+		g_signal_handlers_disconnect_by_data (self->selection, self);
+		g_clear_object (&self->selection);
+	}
+	g_clear_object (&self->sorter);
+	g_clear_pointer (&self->shown_policies, g_variant_unref);
+	g_clear_object (&self->roster);
+	if (self->history) {
+		g_signal_handlers_disconnect_by_data (self->history, self);
+		g_clear_object (&self->history);
+	}
+	g_clear_object (&self->history_series_names);
+	g_clear_object (&self->settings);
+
+	if (self->frame_monitor) {
+		g_autoptr(GError) error = NULL;
+
+		if (!classlimit_frame_monitor_write_trace (self->frame_monitor, self->frame_trace_path, &error))
+			g_warning ("Failed to write frame trace: %s", error->message);
+		g_clear_pointer (&self->frame_monitor, classlimit_frame_monitor_free);
+	}
+	g_clear_pointer (&self->frame_trace_path, g_free);
+
+	G_OBJECT_CLASS (classlimit_window_parent_class)->dispose (object);
 }
 
 static void
@@ -773,32 +1807,261 @@ show_onboarding_if_needed (ClasslimitWindow *self)
 	g_object_unref (builder);
 }
 
+/* Every window writes its own trace, so "frames.json" becomes
+ * "frames-1.json" for the first window and so on.
+ */
+static char *
+get_frame_trace_path (ClasslimitWindow *self)
+{
+	const char *path = g_getenv ("CLASSLIMIT_FRAME_TRACE");
+	const char *file_name = strrchr (path, G_DIR_SEPARATOR);
+	const char *extension;
+	guint id = gtk_application_window_get_id (GTK_APPLICATION_WINDOW (self));
+
+	file_name = file_name ? file_name + 1 : path;
+	extension = strrchr (file_name, '.');
+	if (extension == NULL || extension == file_name)
+		return g_strdup_printf ("%s-%u", path, id);
+
+	return g_strdup_printf ("%.*s-%u%s", (int) (extension - path), path, id, extension);
+}
+
+static void
+classlimit_window_constructed (GObject *object)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (object);
+	GtkApplication *app;
+	GtkListItemFactory *factory;
+	ClasslimitTotals totals;
+
+	G_OBJECT_CLASS (classlimit_window_parent_class)->constructed (object);
+
+	app = gtk_window_get_application (GTK_WINDOW (self));
+	g_assert (CLASSLIMIT_IS_APPLICATION (app));
+	g_assert (self->roster != NULL);
+	self->settings = g_object_ref (classlimit_application_get_settings (CLASSLIMIT_APPLICATION (app)));
+	self->history = g_object_ref (classlimit_application_get_history (CLASSLIMIT_APPLICATION (app)));
+	/* Action log for classlimit-replay, shared with the other windows */
+	self->recorder = classlimit_application_get_recorder (CLASSLIMIT_APPLICATION (app));
+	/* Window ids are only handed out once the window joins the application */
+	if (self->frame_monitor)
+		self->frame_trace_path = get_frame_trace_path (self);
+
+	/* Rows follow the shared roster and only the visible ones are ever
+	 * realized. The selection is per window.
+	 */
+	factory = gtk_signal_list_item_factory_new ();
+	g_signal_connect (factory, "setup", G_CALLBACK (setup_subject_row), self);
+	g_signal_connect (factory, "bind", G_CALLBACK (bind_subject_row), self);
+	g_signal_connect (factory, "unbind", G_CALLBACK (unbind_subject_row), self);
+	gtk_list_view_set_factory (self->subjects_list, factory);
+
+	/* The sort model sits between the roster and the selection, so
+	 * selection positions are view positions, not roster ones.
+	 */
+	self->sorter = GTK_SORTER (gtk_custom_sorter_new (compare_subjects, self, NULL));
+	self->sort_model = gtk_sort_list_model_new (g_object_ref (G_LIST_MODEL (self->roster)), NULL);
+	self->selection = GTK_SELECTION_MODEL (gtk_multi_selection_new (G_LIST_MODEL (self->sort_model)));
+	gtk_list_view_set_model (self->subjects_list, self->selection);
+	g_object_unref (factory);
+
+	on_sort_setting_changed (self);
+	g_settings_bind (self->settings, "csv-name-column", self->csv_name_entry, "text", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind (self->settings, "csv-hours-column", self->csv_hours_entry, "text", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind (self->settings, "csv-skips-column", self->csv_skips_entry, "text", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind (self->settings, "csv-delimiter", self->csv_delimiter_entry, "text", G_SETTINGS_BIND_DEFAULT);
+	g_signal_connect_object (self->settings, "changed::sort-by",
+		G_CALLBACK (on_sort_setting_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object (self->settings, "changed::linked-file",
+		G_CALLBACK (on_linked_file_changed), self, G_CONNECT_SWAPPED);
+	on_linked_file_changed (self);
+	g_signal_connect_swapped (self->sort_dropdown, "notify::selected",
+		G_CALLBACK (on_sort_selected), self);
+
+	/* Removals shrink the selection without a selection-changed */
+	g_signal_connect_swapped (self->selection, "selection-changed",
+		G_CALLBACK (update_selection_bar), self);
+	g_signal_connect_swapped (self->selection, "items-changed",
+		G_CALLBACK (update_selection_bar), self);
+
+	sync_parameters_from_roster (self);
+	sync_policies_from_roster (self);
+
+	/* Results of an earlier calculation, if their inputs still match */
+	if (classlimit_roster_get_totals (self->roster, &totals))
+		populate_results (self, &totals);
+
+	g_signal_connect_object (self->roster, "changed",
+		G_CALLBACK (on_roster_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object (self->roster, "calculated",
+		G_CALLBACK (on_roster_calculated), self, G_CONNECT_SWAPPED);
+
+	setup_history (self);
+
+	/* Show onboarding if this is first launch */
+	g_idle_add_once ((GSourceOnceFunc) show_onboarding_if_needed, self);
+}
+
+static void
+classlimit_window_get_property (GObject    *object,
+                                guint       prop_id,
+                                GValue     *value,
+                                GParamSpec *pspec)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (object);
+
+	switch (prop_id) {
+	case PROP_ROSTER:
+		g_value_set_object (value, self->roster);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_window_set_property (GObject      *object,
+                                guint         prop_id,
+                                const GValue *value,
+                                GParamSpec   *pspec)
+{
+	ClasslimitWindow *self = CLASSLIMIT_WINDOW (object);
+
+	switch (prop_id) {
+	case PROP_ROSTER:
+		self->roster = g_value_dup_object (value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+classlimit_window_class_init (ClasslimitWindowClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+	object_class->constructed = classlimit_window_constructed;
+	object_class->dispose = classlimit_window_dispose;
+	object_class->get_property = classlimit_window_get_property;
+	object_class->set_property = classlimit_window_set_property;
+
+	properties [PROP_ROSTER] =
+		g_param_spec_object ("roster", NULL, NULL,
+		                     CLASSLIMIT_TYPE_ROSTER,
+		                     (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_properties (object_class, N_PROPS, properties);
+
+	g_type_ensure (CLASSLIMIT_TYPE_CHART);
+
+	gtk_widget_class_set_template_from_resource (widget_class, "/com/tomasps/classlimit/classlimit-window.ui");
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, view_stack);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, subjects_list);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, sort_dropdown);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, import_revealer);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, import_progress);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, selection_revealer);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, selection_label);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, bulk_skips_spin);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, bulk_hours_spin);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, subject_name_entry);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, subject_hours_spin);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, add_subject_button);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, percent_spin);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, weeks_spin);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, session_hours_spin);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, policies_list);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, policy_name_entry);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, policy_subjects_entry);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, policy_attendance_spin);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, policy_session_hours_spin);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, policy_weeks_spin);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, csv_name_entry);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, csv_hours_entry);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, csv_skips_entry);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, csv_delimiter_entry);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, calculate_button);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, results_stack);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, results_list);
+    gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, results_page);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, history_series_dropdown);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, history_chart);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, debug_stack_page);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, debug_list);
+	gtk_widget_class_bind_template_child (widget_class, ClasslimitWindow, debug_reset_button);
+}
+
+static const GActionEntry selection_actions[] = {
+	{ "unselect-all", on_unselect_all_action },
+	{ "show-subject", on_show_subject_action, "u" },
+	{ "bulk-add-skips", on_bulk_action },
+	{ "bulk-reset-skips", on_bulk_action },
+	{ "bulk-set-hours", on_bulk_action },
+	{ "bulk-remove", on_bulk_action },
+};
+
+static const GActionEntry import_actions[] = {
+	{ "import-csv", on_import_csv_action },
+	{ "export-csv", on_export_csv_action },
+	{ "import-folder", on_import_folder_action },
+	{ "cancel-import", on_cancel_import_action },
+	{ "paste-subjects", on_paste_subjects_action },
+	{ "archive-semester", on_archive_semester_action },
+	{ "past-semesters", on_past_semesters_action },
+	{ "link-file", on_link_file_action },
+	{ "unlink-file", on_unlink_file_action },
+};
+
+static const GActionEntry policy_actions[] = {
+	{ "add-policy", on_add_policy_action },
+	{ "remove-policy", on_remove_policy_action, "u" },
+};
+
 static void
 classlimit_window_init (ClasslimitWindow *self)
 {
 	GSimpleAction *reset_action;
 	GSimpleAction *export_action;
 	GSimpleAction *import_action;
+	GSimpleAction *debug_action;
+	gboolean debug_enabled = classlimit_profiler_debug_enabled ();
+	guint i;
 
 	gtk_widget_init_template (GTK_WIDGET (self));
 	
-	/* Initialize GSettings */
-	self->settings = g_settings_new ("com.tomasps.classlimit");
+	/* Debug statistics page, hidden unless CLASSLIMIT_DEBUG is set */
+	for (i = 0; i < CLASSLIMIT_N_PROBES; i++) {
+		self->debug_rows[i] = adw_action_row_new ();
+		adw_preferences_row_set_title (ADW_PREFERENCES_ROW (self->debug_rows[i]),
+			classlimit_profiler_probe_name (i));
+		gtk_list_box_append (self->debug_list, self->debug_rows[i]);
+	}
+	adw_view_stack_page_set_visible (self->debug_stack_page, debug_enabled);
 	
-	/* Load saved data */
-	load_subjects_from_settings (self);
+	/* Frame timing, written out as a trace when the window goes away */
+	if (g_getenv ("CLASSLIMIT_FRAME_TRACE")) {
+		self->frame_monitor = classlimit_frame_monitor_new (GTK_WIDGET (self));
+		self->debug_frames_row = adw_action_row_new ();
+		adw_preferences_row_set_title (ADW_PREFERENCES_ROW (self->debug_frames_row), "frames");
+		gtk_list_box_append (self->debug_list, self->debug_frames_row);
+	}
+	g_signal_connect_swapped (self->view_stack, "notify::visible-child",
+		G_CALLBACK (on_visible_child_changed), self);
+	g_signal_connect (self->debug_reset_button, "clicked", G_CALLBACK (on_debug_reset_clicked), self);
 	
 	/* Connect signals */
 	g_signal_connect (self->add_subject_button, "clicked", G_CALLBACK (on_add_subject_clicked), self);
 	g_signal_connect (self->calculate_button, "clicked", G_CALLBACK (on_calculate_clicked), self);
 	
 	/* Auto-save on changes */
-	g_signal_connect_swapped (self->percent_spin, "value-changed", 
-		G_CALLBACK (save_subjects_to_settings), self);
-	g_signal_connect_swapped (self->weeks_spin, "value-changed", 
-		G_CALLBACK (save_subjects_to_settings), self);
-	g_signal_connect_swapped (self->session_hours_spin, "value-changed", 
-		G_CALLBACK (save_subjects_to_settings), self);
+	g_signal_connect (self->percent_spin, "value-changed", 
+		G_CALLBACK (on_parameter_changed), self);
+	g_signal_connect (self->weeks_spin, "value-changed", 
+		G_CALLBACK (on_parameter_changed), self);
+	g_signal_connect (self->session_hours_spin, "value-changed", 
+		G_CALLBACK (on_parameter_changed), self);
 	
 	/* Add actions */
 	reset_action = g_simple_action_new ("reset-all", NULL);
@@ -813,6 +2076,20 @@ classlimit_window_init (ClasslimitWindow *self)
 	g_signal_connect (import_action, "activate", G_CALLBACK (on_import_action), self);
 	g_action_map_add_action (G_ACTION_MAP (self), G_ACTION (import_action));
 	
-	/* Show onboarding if this is first launch */
-	g_idle_add_once ((GSourceOnceFunc) show_onboarding_if_needed, self);
+	g_action_map_add_action_entries (G_ACTION_MAP (self),
+	                                 selection_actions,
+	                                 G_N_ELEMENTS (selection_actions),
+	                                 self);
+	g_action_map_add_action_entries (G_ACTION_MAP (self),
+	                                 import_actions,
+	                                 G_N_ELEMENTS (import_actions),
+	                                 self);
+	g_action_map_add_action_entries (G_ACTION_MAP (self),
+	                                 policy_actions,
+	                                 G_N_ELEMENTS (policy_actions),
+	                                 self);
+
+	debug_action = g_simple_action_new_stateful ("toggle-debug", NULL, g_variant_new_boolean (debug_enabled));
+	g_signal_connect (debug_action, "activate", G_CALLBACK (on_toggle_debug_action), self);
+	g_action_map_add_action (G_ACTION_MAP (self), G_ACTION (debug_action));
 }
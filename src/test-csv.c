@@ -0,0 +1,276 @@
+/* test-csv.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "classlimit-csv.h"
+
+/* The same parser built without vector scanners, see src/meson.build */
+GPtrArray *scalar_csv_parse        (const char                  *data,
+                                    gsize                        length,
+                                    const ClasslimitCsvColumns  *columns,
+                                    GError                     **error);
+GPtrArray *scalar_csv_parse_pasted (const char                  *text,
+                                    gssize                       length,
+                                    guint                       *n_skipped);
+
+static const ClasslimitCsvColumns default_columns = {
+	(char *) "name", (char *) "weekly_hours", (char *) "current_skips", ','
+};
+
+static void
+assert_same_subjects (GPtrArray *vector,
+                      GPtrArray *scalar)
+{
+	guint i;
+
+	g_assert_cmpuint (vector->len, ==, scalar->len);
+	for (i = 0; i < vector->len; i++) {
+		ClasslimitSubject *v = g_ptr_array_index (vector, i);
+		ClasslimitSubject *s = g_ptr_array_index (scalar, i);
+
+		g_assert_cmpstr (classlimit_subject_get_name (v), ==, classlimit_subject_get_name (s));
+		g_assert_cmpint (classlimit_subject_get_weekly_hours (v), ==, classlimit_subject_get_weekly_hours (s));
+		g_assert_cmpint (classlimit_subject_get_current_skips (v), ==, classlimit_subject_get_current_skips (s));
+	}
+}
+
+/* Parses through both scanners from an exact-size copy, so a vector
+ * load past the end shows up under a sanitizer, and returns the result
+ * once both agree. Both must fail the same way if either does.
+ */
+static GPtrArray *
+parse_both (const char                  *data,
+            gsize                        length,
+            const ClasslimitCsvColumns  *columns,
+            GError                     **error)
+{
+	g_autofree char *copy = g_memdup2 (data, length);
+	g_autoptr(GPtrArray) vector = NULL;
+	g_autoptr(GPtrArray) scalar = NULL;
+	g_autoptr(GError) vector_error = NULL;
+	g_autoptr(GError) scalar_error = NULL;
+
+	vector = classlimit_csv_parse (copy, length, columns, &vector_error);
+	scalar = scalar_csv_parse (copy, length, columns, &scalar_error);
+
+	if (vector == NULL || scalar == NULL) {
+		g_assert_null (vector);
+		g_assert_null (scalar);
+		g_assert_error (scalar_error, vector_error->domain, vector_error->code);
+		g_assert_cmpstr (vector_error->message, ==, scalar_error->message);
+		g_propagate_error (error, g_steal_pointer (&vector_error));
+		return NULL;
+	}
+
+	assert_same_subjects (vector, scalar);
+
+	return g_steal_pointer (&vector);
+}
+
+static void
+assert_subject (GPtrArray  *subjects,
+                guint       index,
+                const char *name,
+                int         weekly_hours,
+                int         current_skips)
+{
+	ClasslimitSubject *s;
+
+	g_assert_cmpuint (index, <, subjects->len);
+	s = g_ptr_array_index (subjects, index);
+	g_assert_cmpstr (classlimit_subject_get_name (s), ==, name);
+	g_assert_cmpint (classlimit_subject_get_weekly_hours (s), ==, weekly_hours);
+	g_assert_cmpint (classlimit_subject_get_current_skips (s), ==, current_skips);
+}
+
+static void
+test_crlf (void)
+{
+	static const char data[] =
+		"name,weekly_hours,current_skips\r\n"
+		"Calculus,4,1\r\n"
+		"\r\n"
+		"Art,2,\r\n";
+	g_autoptr(GPtrArray) subjects = NULL;
+	g_autoptr(GError) error = NULL;
+
+	subjects = parse_both (data, strlen (data), &default_columns, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (subjects->len, ==, 2);
+	assert_subject (subjects, 0, "Calculus", 4, 1);
+	assert_subject (subjects, 1, "Art", 2, 0);
+}
+
+static void
+test_bom (void)
+{
+	static const char data[] = "\xef\xbb\xbfname;weekly_hours\nPhysics;5\n";
+	ClasslimitCsvColumns columns = default_columns;
+	g_autoptr(GPtrArray) subjects = NULL;
+	g_autoptr(GError) error = NULL;
+
+	columns.current_skips = NULL;
+	columns.delimiter = ';';
+	subjects = parse_both (data, strlen (data), &columns, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (subjects->len, ==, 1);
+	assert_subject (subjects, 0, "Physics", 5, 0);
+}
+
+static void
+test_quotes (void)
+{
+	static const char data[] =
+		"name,weekly_hours,current_skips\n"
+		"\"Say \"\"hi\"\", then, leave\",3,2\n"
+		"Rock \"n\" Roll,1,0\n"
+		"\"\"\"\",2,1";
+	g_autoptr(GPtrArray) subjects = NULL;
+	g_autoptr(GError) error = NULL;
+
+	subjects = parse_both (data, strlen (data), &default_columns, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (subjects->len, ==, 3);
+	assert_subject (subjects, 0, "Say \"hi\", then, leave", 3, 2);
+	assert_subject (subjects, 1, "Rock \"n\" Roll", 1, 0);
+	assert_subject (subjects, 2, "\"", 2, 1);
+}
+
+/* Names of every length up to three vectors, so the delimiter, a stray
+ * quote and the line break each land in every lane. Padding the header
+ * shifts it all by every offset within a vector.
+ */
+static void
+test_lanes (void)
+{
+	g_autoptr(GString) data = g_string_new ("name,weekly_hours,current_skips\n");
+	g_autoptr(GString) padded = g_string_new (NULL);
+	guint length, offset;
+
+	for (length = 1; length <= 48; length++) {
+		guint i;
+
+		for (i = 0; i < length; i++)
+			g_string_append_c (data, 'a' + i % 26);
+		g_string_append_printf (data, ",%u,%u\n", length, length % 7);
+
+		for (i = 0; i < length; i++)
+			g_string_append_c (data, i > 0 && i == length / 2 ? '"' : 'A' + i % 26);
+		g_string_append_printf (data, ",%u,0\r\n", length);
+	}
+
+	for (offset = 0; offset < 16; offset++) {
+		g_autoptr(GPtrArray) subjects = NULL;
+		g_autoptr(GError) error = NULL;
+
+		g_string_truncate (padded, 0);
+		g_string_append_len (padded, "                ", offset);
+		g_string_append_len (padded, data->str, data->len);
+
+		subjects = parse_both (padded->str, padded->len, &default_columns, &error);
+		g_assert_no_error (error);
+		g_assert_cmpuint (subjects->len, ==, 96);
+		assert_subject (subjects, 94, "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuv", 48, 48 % 7);
+	}
+}
+
+static void
+test_overflow (void)
+{
+	static const char fits[] = "name,weekly_hours,current_skips\nLong,214748364,0\n";
+	static const char too_big[] = "name,weekly_hours,current_skips\nLong,99999999999,0\n";
+	static const char skips_too_big[] = "name,weekly_hours,current_skips\nLong,4,4294967296\n";
+	g_autoptr(GPtrArray) subjects = NULL;
+	g_autoptr(GError) error = NULL;
+
+	subjects = parse_both (fits, strlen (fits), &default_columns, &error);
+	g_assert_no_error (error);
+	assert_subject (subjects, 0, "Long", 214748364, 0);
+	g_clear_pointer (&subjects, g_ptr_array_unref);
+
+	subjects = parse_both (too_big, strlen (too_big), &default_columns, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_null (subjects);
+	g_clear_error (&error);
+
+	subjects = parse_both (skips_too_big, strlen (skips_too_big), &default_columns, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_null (subjects);
+}
+
+static void
+test_unterminated (void)
+{
+	static const char data[] = "name,weekly_hours,current_skips\nFine,1,0\n\"Never closed,2,0\n";
+	g_autoptr(GPtrArray) subjects = NULL;
+	g_autoptr(GError) error = NULL;
+
+	subjects = parse_both (data, strlen (data), &default_columns, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_null (subjects);
+}
+
+static void
+test_pasted (void)
+{
+	static const char text[] =
+		"Subject\tHours\n"
+		"Linear Algebra, II;4\r\n"
+		"\n"
+		"  Art , 2\n"
+		"no hours here\n"
+		"Zero\t0\n"
+		"History\t3";
+	g_autofree char *copy = g_memdup2 (text, strlen (text));
+	g_autoptr(GPtrArray) vector = NULL;
+	g_autoptr(GPtrArray) scalar = NULL;
+	guint vector_skipped, scalar_skipped;
+
+	vector = classlimit_csv_parse_pasted (copy, strlen (text), &vector_skipped);
+	scalar = scalar_csv_parse_pasted (copy, strlen (text), &scalar_skipped);
+	assert_same_subjects (vector, scalar);
+	g_assert_cmpuint (vector_skipped, ==, scalar_skipped);
+
+	g_assert_cmpuint (vector->len, ==, 3);
+	g_assert_cmpuint (vector_skipped, ==, 3);
+	assert_subject (vector, 0, "Linear Algebra, II", 4, 0);
+	assert_subject (vector, 1, "Art", 2, 0);
+	assert_subject (vector, 2, "History", 3, 0);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/csv/crlf", test_crlf);
+	g_test_add_func ("/csv/bom", test_bom);
+	g_test_add_func ("/csv/quotes", test_quotes);
+	g_test_add_func ("/csv/lanes", test_lanes);
+	g_test_add_func ("/csv/overflow", test_overflow);
+	g_test_add_func ("/csv/unterminated", test_unterminated);
+	g_test_add_func ("/csv/pasted", test_pasted);
+
+	return g_test_run ();
+}
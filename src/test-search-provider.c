@@ -0,0 +1,331 @@
+/* test-search-provider.c
+ *
+ * Copyright 2025 Unknown
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#define G_SETTINGS_ENABLE_BACKEND
+#include <gio/gsettingsbackend.h>
+
+#include "classlimit-search-index.h"
+#include "classlimit-search-provider.h"
+
+#define OBJECT_PATH "/com/tomasps/classlimit/SearchProvider"
+
+/* Three subjects where only the first two have cached allowances: one
+ * with skips to spare, one over its limit and one not calculated yet.
+ */
+static GVariant *
+new_subjects (void)
+{
+	return g_variant_ref_sink (g_variant_new_parsed (
+		"[('Linear Algebra', 4, 2, 0), ('Linear Programming', 3, 5, 0), ('Álgebra II', 2, 1, 0)]"));
+}
+
+static GVariant *
+new_results (void)
+{
+	return g_variant_ref_sink (g_variant_new_parsed (
+		"(uint64 1, (0, 0, 0, 0), [(uint64 1, 0, 4), (uint64 2, 0, 3), (uint64 3, 0, 0)])"));
+}
+
+static void
+assert_lookup (ClasslimitSearchIndex *index,
+               const char            *query,
+               const char * const    *expected)
+{
+	g_auto(GStrv) terms = g_strsplit (query, " ", -1);
+	g_auto(GStrv) ids = classlimit_search_index_lookup (index, (const char * const *) terms);
+
+	g_assert_cmpstrv (ids, expected);
+}
+
+static void
+test_index_lookup (void)
+{
+	g_autoptr(GVariant) subjects = new_subjects ();
+	g_autoptr(GVariant) results = new_results ();
+	g_autoptr(ClasslimitSearchIndex) index = classlimit_search_index_new (subjects, results);
+
+	/* Any word may match as a prefix, and every term has to */
+	assert_lookup (index, "lin", (const char * const[]) { "0", "1", NULL });
+	assert_lookup (index, "LIN alg", (const char * const[]) { "0", NULL });
+	assert_lookup (index, "prog linear", (const char * const[]) { "1", NULL });
+	assert_lookup (index, "linear ii", (const char * const[]) { NULL });
+	assert_lookup (index, "algebras", (const char * const[]) { NULL });
+	assert_lookup (index, "", (const char * const[]) { NULL });
+
+	/* Accented names also match their ASCII spelling */
+	assert_lookup (index, "alg", (const char * const[]) { "0", "2", NULL });
+	assert_lookup (index, "álg", (const char * const[]) { "2", NULL });
+}
+
+static void
+test_index_stale (void)
+{
+	g_autoptr(GVariant) subjects = new_subjects ();
+	g_autoptr(GVariant) results = new_results ();
+	g_autoptr(GVariant) renamed = NULL;
+	g_autoptr(GVariant) recalculated = NULL;
+	g_autoptr(ClasslimitSearchIndex) index = NULL;
+	g_autoptr(ClasslimitSearchIndex) loaded = NULL;
+	g_autofree char *path = classlimit_search_index_get_cache_path ();
+	g_autoptr(GError) error = NULL;
+	const char *name;
+	int allowed_skips, remaining;
+
+	loaded = classlimit_search_index_load (path, subjects, results, &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+	g_assert_null (loaded);
+	g_clear_error (&error);
+
+	index = classlimit_search_index_new (subjects, results);
+	g_assert_true (classlimit_search_index_save (index, path, &error));
+	g_assert_no_error (error);
+
+	loaded = classlimit_search_index_load (path, subjects, results, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (loaded);
+	g_assert_true (classlimit_search_index_get_subject (loaded, "1", &name, &allowed_skips, &remaining));
+	g_assert_cmpstr (name, ==, "Linear Programming");
+	g_assert_cmpint (allowed_skips, ==, 3);
+	g_assert_cmpint (remaining, ==, -2);
+	g_assert_false (classlimit_search_index_get_subject (loaded, "3", &name, &allowed_skips, &remaining));
+	g_clear_pointer (&loaded, classlimit_search_index_unref);
+
+	/* A change to either value makes the saved copy useless */
+	renamed = g_variant_ref_sink (g_variant_new_parsed (
+		"[('Linear Algebra', 4, 2, 0), ('Linear Programming', 3, 5, 0), ('Algebra II', 2, 1, 0)]"));
+	loaded = classlimit_search_index_load (path, renamed, results, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+	g_assert_null (loaded);
+	g_clear_error (&error);
+
+	recalculated = g_variant_ref_sink (g_variant_new_parsed (
+		"(uint64 4, (0, 0, 0, 0), [(uint64 1, 0, 4), (uint64 2, 0, 3), (uint64 3, 0, 1)])"));
+	loaded = classlimit_search_index_load (path, subjects, recalculated, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+	g_assert_null (loaded);
+}
+
+static void
+on_call_done (GObject      *source,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+	GAsyncResult **out = user_data;
+
+	*out = g_object_ref (result);
+}
+
+/* The provider answers from this thread's main context, so the call
+ * has to be asynchronous for it to get the chance.
+ */
+static GVariant *
+call_provider (GDBusConnection *connection,
+               const char      *method,
+               GVariant        *parameters,
+               const char      *reply_type)
+{
+	g_autoptr(GAsyncResult) result = NULL;
+	g_autoptr(GError) error = NULL;
+	GVariant *reply;
+
+	g_dbus_connection_call (connection, g_dbus_connection_get_unique_name (connection),
+	                        OBJECT_PATH, "org.gnome.Shell.SearchProvider2", method, parameters,
+	                        G_VARIANT_TYPE (reply_type), G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+	                        on_call_done, &result);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+
+	reply = g_dbus_connection_call_finish (connection, result, &error);
+	g_assert_no_error (error);
+
+	return reply;
+}
+
+static void
+assert_result_set (GDBusConnection    *connection,
+                   const char         *query,
+                   const char * const *expected)
+{
+	g_auto(GStrv) terms = g_strsplit (query, " ", -1);
+	g_autoptr(GVariant) reply = NULL;
+	g_autofree const char **ids = NULL;
+
+	reply = call_provider (connection, "GetInitialResultSet",
+	                       g_variant_new ("(^as)", terms), "(as)");
+	g_variant_get (reply, "(^a&s)", &ids);
+	g_assert_cmpstrv (ids, expected);
+}
+
+static void
+assert_subsearch (GDBusConnection    *connection,
+                  const char * const *previous,
+                  const char         *query,
+                  const char * const *expected)
+{
+	g_auto(GStrv) terms = g_strsplit (query, " ", -1);
+	g_autoptr(GVariant) reply = NULL;
+	g_autofree const char **ids = NULL;
+
+	reply = call_provider (connection, "GetSubsearchResultSet",
+	                       g_variant_new ("(^as^as)", previous, terms), "(as)");
+	g_variant_get (reply, "(^a&s)", &ids);
+	g_assert_cmpstrv (ids, expected);
+}
+
+/* @expected holds an identifier, name and description per result */
+static void
+assert_metas (GDBusConnection    *connection,
+              const char * const *ids,
+              const char * const *expected)
+{
+	g_autoptr(GVariant) reply = NULL;
+	g_autoptr(GVariant) metas = NULL;
+	gsize i;
+
+	reply = call_provider (connection, "GetResultMetas", g_variant_new ("(^as)", ids), "(aa{sv})");
+	metas = g_variant_get_child_value (reply, 0);
+	g_assert_cmpuint (g_variant_n_children (metas), ==, g_strv_length ((char **) expected) / 3);
+
+	for (i = 0; i < g_variant_n_children (metas); i++) {
+		g_autoptr(GVariant) meta = g_variant_get_child_value (metas, i);
+		const char *value;
+
+		g_assert_true (g_variant_lookup (meta, "id", "&s", &value));
+		g_assert_cmpstr (value, ==, expected[i * 3]);
+		g_assert_true (g_variant_lookup (meta, "name", "&s", &value));
+		g_assert_cmpstr (value, ==, expected[i * 3 + 1]);
+		g_assert_true (g_variant_lookup (meta, "description", "&s", &value));
+		g_assert_cmpstr (value, ==, expected[i * 3 + 2]);
+		g_assert_true (g_variant_lookup (meta, "gicon", "&s", &value));
+	}
+}
+
+static void
+on_show_subject (GSimpleAction *action,
+                 GVariant      *parameter,
+                 gpointer       user_data)
+{
+	gint64 *shown = user_data;
+
+	*shown = g_variant_get_uint32 (parameter);
+}
+
+static void
+test_provider (void)
+{
+	g_autoptr(GTestDBus) bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GSettingsBackend) backend = g_memory_settings_backend_new ();
+	g_autoptr(GSettings) settings = NULL;
+	g_autoptr(GApplication) application = NULL;
+	g_autoptr(GSimpleAction) show_subject = g_simple_action_new ("show-subject", G_VARIANT_TYPE_UINT32);
+	g_autoptr(ClasslimitSearchProvider) provider = NULL;
+	g_autoptr(ClasslimitSearchIndex) cached = NULL;
+	g_autoptr(GVariant) subjects = new_subjects ();
+	g_autoptr(GVariant) results = new_results ();
+	g_autoptr(GError) error = NULL;
+	g_autofree char *path = classlimit_search_index_get_cache_path ();
+	gint64 shown = -1;
+
+	g_test_dbus_up (bus);
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	g_assert_no_error (error);
+
+	settings = g_settings_new_with_backend ("com.tomasps.classlimit", backend);
+	g_settings_set_value (settings, "subjects", subjects);
+	g_settings_set_value (settings, "results-cache", results);
+
+	/* Registered, as actions only run then, but without taking the name */
+	application = g_application_new ("com.tomasps.classlimit", G_APPLICATION_NON_UNIQUE);
+	g_signal_connect (show_subject, "activate", G_CALLBACK (on_show_subject), &shown);
+	g_action_map_add_action (G_ACTION_MAP (application), G_ACTION (show_subject));
+	g_assert_true (g_application_register (application, NULL, &error));
+	g_assert_no_error (error);
+	provider = classlimit_search_provider_new (application, backend);
+	g_assert_true (classlimit_search_provider_register (provider, connection, OBJECT_PATH, &error));
+	g_assert_no_error (error);
+
+	assert_result_set (connection, "lin", (const char * const[]) { "0", "1", NULL });
+	assert_result_set (connection, "alg lin", (const char * const[]) { "0", NULL });
+	assert_result_set (connection, "chemistry", (const char * const[]) { NULL });
+
+	assert_subsearch (connection, (const char * const[]) { "0", "1", "2", NULL }, "alg",
+	                  (const char * const[]) { "0", "2", NULL });
+	assert_subsearch (connection, (const char * const[]) { "2", "0", "9", NULL }, "alge",
+	                  (const char * const[]) { "2", "0", NULL });
+
+	assert_metas (connection, (const char * const[]) { "1", "0", "7", "2", NULL },
+	              (const char * const[]) {
+		"1", "Linear Programming", "2 skips over the limit",
+		"0", "Linear Algebra", "2 skips remaining",
+		"2", "Álgebra II", "Allowed skips not calculated yet",
+		NULL
+	});
+
+	/* The index built for the first query is written back for the next
+	 * start, and matches the settings it came from
+	 */
+	while (g_main_context_iteration (NULL, FALSE))
+		;
+	cached = classlimit_search_index_load (path, subjects, results, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (cached);
+
+	/* Edits show up in the next query. The cached results no longer
+	 * line up with the subjects, so allowances come from those.
+	 */
+	g_settings_set_value (settings, "subjects", g_variant_new_parsed (
+		"[('Linear Algebra', 4, 2, 6), ('Linear Programming', 3, 5, 0), ('Álgebra II', 2, 1, 0), ('Statistics', 2, 1, 1)]"));
+	while (g_main_context_iteration (NULL, FALSE))
+		;
+
+	assert_result_set (connection, "stat", (const char * const[]) { "3", NULL });
+	assert_metas (connection, (const char * const[]) { "3", "0", NULL },
+	              (const char * const[]) {
+		"3", "Statistics", "0 skips remaining",
+		"0", "Linear Algebra", "4 skips remaining",
+		NULL
+	});
+
+	/* Opening a result shows that very subject */
+	g_variant_unref (call_provider (connection, "ActivateResult",
+		g_variant_new ("(s^asu)", "2", (const char * const[]) { "alg", NULL }, 0), "()"));
+	g_assert_cmpint (shown, ==, 2);
+
+	classlimit_search_provider_unregister (provider);
+	g_clear_object (&provider);
+	g_clear_object (&connection);
+	g_test_dbus_down (bus);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+	g_test_add_func ("/search-index/lookup", test_index_lookup);
+	g_test_add_func ("/search-index/stale", test_index_stale);
+	g_test_add_func ("/search-provider/dbus", test_provider);
+
+	return g_test_run ();
+}